@@ -0,0 +1,8 @@
+#---------------------------------------------------------------------------------
+# The sources of libuu-core.a: the downloads, the UniStore handling, the scripts and the extraction.
+# None of them draws; what they need from the user interface is in include/utils/platform.hpp.
+# Makefile and host/Makefile include this with CORE_ROOT set to the repository root.
+#---------------------------------------------------------------------------------
+CORE_SOURCES	:=	$(wildcard $(CORE_ROOT)/source/download/*.cpp) \
+			$(addprefix $(CORE_ROOT)/source/store/,meta.cpp store.cpp storeEntry.cpp storeUtils.cpp) \
+			$(addprefix $(CORE_ROOT)/source/utils/,ciaStream.cpp extract.cpp fileBrowse.cpp lang.cpp scriptUtils.cpp stringutils.cpp)
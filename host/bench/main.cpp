@@ -0,0 +1,120 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	The UniStore benchmark on a PC: uu-bench [log]
+	Generates the same UniStores as 'make BENCHMARK=1' in build/bench and runs the same operations on them with libuu-core.a.
+	Only the time gets measured, as the allocator is not wrapped here; so these times are without the allocation tracking of the 3DS benchmark.
+	The results are appended to the log as JSON lines, in the format of the 3DS benchmark, or printed, if no log is given.
+*/
+
+#include "benchmark.hpp"
+#include "queueSystem.hpp"
+#include "storeUtils.hpp"
+
+#include <3ds.h>
+#include <deque>
+#include <stdio.h>
+#include <sys/stat.h>
+
+extern std::deque<std::unique_ptr<Queue>> queueEntries;
+
+static FILE *out = nullptr;
+static int measured = 0; // The entries of the current UniStore.
+
+/*
+	Time an operation and log it.
+
+	const char *op: The operation.
+	const Fn &fn: Const Reference to the operation.
+*/
+template <typename Fn>
+static void measure(const char *op, const Fn &fn) {
+	const u64 start = svcGetSystemTick();
+	fn();
+	const u64 ticks = svcGetSystemTick() - start;
+
+	Benchmark::Write(out, C_V, op, measured, { { "us", ticks * 1000000 / SYSCLOCK_ARM11 } });
+}
+
+int main(int argc, char *argv[]) {
+	out = argc > 1 ? fopen(argv[1], "a") : stdout;
+	if (!out) {
+		fprintf(stderr, "Could not open %s.\n", argv[1]);
+		return 1;
+	}
+
+	mkdir("build", 0777);
+	mkdir("build/bench", 0777);
+
+	for (const int entries : Benchmark::Sizes) {
+		const std::string name = "benchmark-" + std::to_string(entries) + ".unistore";
+		const std::string file = "build/bench/" + name;
+		const std::string metaFile = "build/bench/meta-" + std::to_string(entries) + ".json";
+		measured = entries;
+
+		measure("Generate", [&]() { Benchmark::Generate(entries, file, metaFile); });
+
+		struct stat st;
+		if (stat(file.c_str(), &st) != 0) {
+			fprintf(stderr, "Could not generate %s.\n", file.c_str());
+			return 1;
+		}
+
+		measure("MetaData", [&]() { StoreUtils::meta = std::make_unique<Meta>(metaFile); });
+		measure("LoadFromFile", [&]() { StoreUtils::store = std::make_unique<Store>(file, name); });
+
+		if (StoreUtils::store->GetValid()) {
+			measure("ResetAll", []() { StoreUtils::ResetAll(); });
+			measure("RefreshUpdateAVL", []() { StoreUtils::RefreshUpdateAVL(); });
+
+			for (const auto &sort : Benchmark::Sorts)
+				measure(sort.op, [&]() { StoreUtils::SortEntries(true, sort.type); });
+
+			for (const auto &search : Benchmark::Searches) {
+				StoreUtils::ResetAll();
+				StoreUtils::RefreshUpdateAVL();
+
+				measure(search.op, [&]() { StoreUtils::search(search.query, search.title, search.author, search.category, search.console, search.marks, search.updateAvl, search.isAND); });
+			}
+
+			StoreUtils::ResetAll();
+			measure("AddAllToQueue", []() { StoreUtils::AddAllToQueue(); }); // The host queue only collects the entries.
+			queueEntries.clear();
+
+		} else {
+			Benchmark::Write(out, C_V, "all", entries, { { "skipped", "invalid" } });
+		}
+
+		StoreUtils::entries.clear();
+		StoreUtils::store = nullptr;
+		StoreUtils::meta = nullptr; // Writes the MetaData back.
+		fflush(out);
+	}
+
+	if (out != stdout) fclose(out);
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	The part of libctru, which the download core uses, on top of POSIX.
+	This lets the core (source/download) build with a normal PC toolchain, see host/Makefile.
+	Nothing of this gets used by the 3DS build.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_HOST_3DS_H
+#define _UNIVERSAL_UPDATER_HOST_3DS_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef s32 Result;
+typedef u32 Handle;
+
+typedef enum {
+	MEDIATYPE_NAND = 0,
+	MEDIATYPE_SD = 1,
+	MEDIATYPE_GAME_CARD = 2
+} FS_MediaType;
+
+#define R_SUCCEEDED(res) ((res) >= 0)
+#define R_FAILED(res) ((res) < 0)
+
+#define U64_MAX UINT64_MAX
+
+#define CUR_THREAD_HANDLE 0xFFFF8000
+#define CUR_PROCESS_HANDLE 0xFFFF8001
+
+/* The system tick is a nanosecond clock on the host. */
+#define SYSCLOCK_ARM11 1000000000ULL
+
+static inline u64 hostClock(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static inline u64 svcGetSystemTick() { return hostClock(CLOCK_MONOTONIC); }
+static inline u64 osGetTime() { return hostClock(CLOCK_REALTIME) / 1000000ULL; }
+
+static inline void svcSleepThread(s64 ns) {
+	struct timespec ts = { (time_t)(ns / 1000000000LL), (long)(ns % 1000000000LL) };
+	nanosleep(&ts, nullptr);
+}
+
+static inline Result svcGetThreadPriority(s32 *out, Handle handle) { *out = 0x30; return 0; }
+static inline Result svcFlushProcessDataCache(Handle process, u32 addr, u32 size) { return 0; }
+
+/* There is no SOC service to set up on the host. */
+static inline Result socInit(u32 *context_addr, u32 context_size) { return 0; }
+static inline Result socExit() { return 0; }
+
+/*
+	LightLock, CondVar and LightEvent as atomics with yield-polling.
+	The layouts match libctru, so a LightLock can still be initialized with 1 (unlocked).
+*/
+typedef s32 LightLock;
+typedef s32 CondVar;
+
+static inline void LightLock_Init(LightLock *lock) { __atomic_store_n(lock, 1, __ATOMIC_RELEASE); }
+
+static inline bool LightLock_TryLock(LightLock *lock) {
+	s32 expected = 1;
+	return __atomic_compare_exchange_n(lock, &expected, 0, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void LightLock_Lock(LightLock *lock) {
+	while (!LightLock_TryLock(lock)) sched_yield();
+}
+
+static inline void LightLock_Unlock(LightLock *lock) { __atomic_store_n(lock, 1, __ATOMIC_RELEASE); }
+
+/* A sequence counter; waiters return once it moved, which may wake more than one (spurious wakeups are allowed). */
+static inline void CondVar_Init(CondVar *cv) { __atomic_store_n(cv, 0, __ATOMIC_RELEASE); }
+
+static inline void CondVar_Wait(CondVar *cv, LightLock *lock) {
+	const s32 seq = __atomic_load_n(cv, __ATOMIC_ACQUIRE);
+	LightLock_Unlock(lock);
+	while (__atomic_load_n(cv, __ATOMIC_ACQUIRE) == seq) sched_yield();
+	LightLock_Lock(lock);
+}
+
+static inline void CondVar_Signal(CondVar *cv) { __atomic_add_fetch(cv, 1, __ATOMIC_RELEASE); }
+static inline void CondVar_Broadcast(CondVar *cv) { __atomic_add_fetch(cv, 1, __ATOMIC_RELEASE); }
+
+typedef enum {
+	RESET_ONESHOT = 0,
+	RESET_STICKY = 1,
+	RESET_PULSE = 2
+} ResetType;
+
+typedef struct {
+	s32 state;
+	ResetType type;
+} LightEvent;
+
+static inline void LightEvent_Init(LightEvent *event, ResetType reset_type) {
+	event->type = reset_type;
+	__atomic_store_n(&event->state, 0, __ATOMIC_RELEASE);
+}
+
+static inline void LightEvent_Signal(LightEvent *event) { __atomic_store_n(&event->state, 1, __ATOMIC_RELEASE); }
+static inline void LightEvent_Clear(LightEvent *event) { __atomic_store_n(&event->state, 0, __ATOMIC_RELEASE); }
+
+static inline int LightEvent_TryWait(LightEvent *event) {
+	if (event->type == RESET_STICKY) return __atomic_load_n(&event->state, __ATOMIC_ACQUIRE);
+
+	s32 expected = 1;
+	return __atomic_compare_exchange_n(&event->state, &expected, 0, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void LightEvent_Wait(LightEvent *event) {
+	while (!LightEvent_TryWait(event)) sched_yield();
+}
+
+/* Returns 0 if signaled, 1 on timeout, like libctru. */
+static inline int LightEvent_WaitTimeout(LightEvent *event, s64 timeout_ns) {
+	const u64 end = svcGetSystemTick() + (u64)timeout_ns;
+
+	while (!LightEvent_TryWait(event)) {
+		if (svcGetSystemTick() >= end) return 1;
+		svcSleepThread(1000000); // 1ms.
+	}
+
+	return 0;
+}
+
+/* Threads; priority, core and stack size are ignored. */
+typedef void (*ThreadFunc)(void *);
+
+struct HostThread {
+	pthread_t handle;
+	ThreadFunc entrypoint;
+	void *arg;
+};
+
+typedef HostThread *Thread;
+
+static inline void *hostThreadEntry(void *arg) {
+	Thread thread = (Thread)arg;
+	thread->entrypoint(thread->arg);
+	return nullptr;
+}
+
+static inline Thread threadCreate(ThreadFunc entrypoint, void *arg, size_t stack_size, int prio, int core_id, bool detached) {
+	Thread thread = new HostThread{ {}, entrypoint, arg };
+
+	if (pthread_create(&thread->handle, nullptr, hostThreadEntry, thread) != 0) {
+		delete thread;
+		return nullptr;
+	}
+
+	if (detached) pthread_detach(thread->handle);
+	return thread;
+}
+
+static inline Result threadJoin(Thread thread, u64 timeout_ns) {
+	if (!thread) return 0;
+	return pthread_join(thread->handle, nullptr) == 0 ? 0 : -1;
+}
+
+static inline void threadFree(Thread thread) { delete thread; }
+
+#endif
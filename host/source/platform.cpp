@@ -0,0 +1,106 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	What libuu-core.a needs from the rest of Universal-Updater, for a PC build.
+	"sdmc:/" paths resolve relative to the working directory there.
+*/
+
+#include "cia.hpp"
+#include "download.hpp"
+#include "files.hpp"
+#include "platform.hpp"
+#include "queueSystem.hpp"
+
+#include <ftw.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+namespace QueueSystem { bool CancelCallback = false; int LastElement = 0; };
+
+/* Only collected, there is no queue thread on a PC. */
+std::deque<std::unique_ptr<Queue>> queueEntries;
+
+void QueueSystem::AddToQueue(nlohmann::json obj, const StoreImage &icn, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated, u64 size) {
+	queueEntries.push_back( std::make_unique<Queue>(obj, icn, name, uName, eName, lUpdated, size) );
+}
+
+/* The messages go to the console and every prompt gets confirmed. */
+void Platform::DisplayMsg(const std::string &msg) { printf("%s\n", msg.c_str()); }
+void Platform::WaitMsg(const std::string &msg) { printf("%s\n", msg.c_str()); }
+bool Platform::PromptMsg(const std::string &msg) { printf("%s\n", msg.c_str()); return true; }
+
+void Platform::ShowProgress(const std::string &msg, ProgressBar type) { if (msg != "") printf("%s\n", msg.c_str()); }
+void Platform::HideProgress() { }
+
+bool checkWifiStatus() { return true; }
+
+/* There is no AM service on a PC, so no title can be installed or launched. */
+Result Title::Launch(u64 titleId, FS_MediaType mediaType) { return -1; }
+Result Title::Install(const char *ciaPath, bool updateSelf) { return -1; }
+
+Result Title::InstallStream(ArchiveStream &stream, bool updateSelf, bool &staged) {
+	staged = false;
+	return -1;
+}
+
+Result makeDirs(const char *path) {
+	const std::string dirs = path;
+
+	for (size_t slashpos = dirs.find('/', 1); slashpos != std::string::npos; slashpos = dirs.find('/', slashpos + 1)) {
+		mkdir(dirs.substr(0, slashpos).c_str(), 0777);
+	}
+
+	return 0;
+}
+
+Result removeDirRecursive(const char *path) {
+	return nftw(path, [](const char *file, const struct stat *st, int flag, struct FTW *ftw) { return remove(file); }, 16, FTW_DEPTH | FTW_PHYS) == 0 ? 0 : -1;
+}
+
+Result deleteFile(const char *path) { return remove(path) == 0 ? 0 : -1; }
+
+u64 getAvailableSpace() {
+	struct statvfs st;
+	if (statvfs(".", &st) != 0) return 0;
+	return (u64)st.f_bsize * (u64)st.f_bavail;
+}
+
+/* No accounting on a PC; every query asks the filesystem. */
+void FreeSpace::Sync() { }
+u64 FreeSpace::Available() { return getAvailableSpace(); }
+
+bool FreeSpace::Reserve(u64 size, u64 &reservation) {
+	if (getAvailableSpace() < size) return false;
+
+	reservation += size;
+	return true;
+}
+
+void FreeSpace::Commit(u64 size, u64 &reservation) { reservation -= size < reservation ? size : reservation; }
+void FreeSpace::Release(u64 &reservation) { reservation = 0; }
@@ -0,0 +1,114 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	The stand-in server on its own, for a 3DS built with make STANDIN=http://<this PC>:<port>.
+	Usage: uu-standin [options]
+
+		-p <port>          The port, 8080 by default.
+		-r <directory>     The fixtures, host/fixtures by default.
+		-l <ms>            Latency of every request.
+		-b <bytes/s>       Bandwidth limit.
+		-t <bytes>         Truncate every body after that much.
+		-s <code>          Answer every request with that status.
+		-f <n>             Answer the first n requests of every URL with 503.
+		-a <s>             Retry-After for those.
+		-R <n>             Redirect every request n times.
+		-n                 Don't serve ranges.
+		-c                 Send bodies chunked.
+		-z                 Gzip bodies for clients, which accept it.
+		-g <MiB>           Size of /files/big.bin, 32 MiB by default.
+
+	The query string of a request overrides these, see standinServer.hpp.
+*/
+
+#include "standinServer.hpp"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop = 0;
+static void onSignal(int) { stop = 1; }
+
+int main(int argc, char *argv[]) {
+	StandinFaults faults;
+	std::string root = "fixtures";
+	int port = 8080, option = 0, big = 32;
+
+	while ((option = getopt(argc, argv, "p:r:l:b:t:s:f:a:R:nczg:")) != -1) {
+		switch(option) {
+			case 'p': port = atoi(optarg); break;
+			case 'r': root = optarg; break;
+			case 'l': faults.Latency = strtoul(optarg, nullptr, 10); break;
+			case 'b': faults.Rate = strtoul(optarg, nullptr, 10); break;
+			case 't': faults.Truncate = strtoll(optarg, nullptr, 10); break;
+			case 's': faults.Status = atoi(optarg); break;
+			case 'f': faults.Fail = strtoul(optarg, nullptr, 10); break;
+			case 'a': faults.RetryAfter = strtoul(optarg, nullptr, 10); break;
+			case 'R': faults.Redirect = strtoul(optarg, nullptr, 10); break;
+			case 'n': faults.NoRanges = true; break;
+			case 'c': faults.Chunked = true; break;
+			case 'z': faults.Gzip = true; break;
+			case 'g': big = atoi(optarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-p port] [-r fixtures] [-l ms] [-b bytes/s] [-t bytes] [-s status] [-f n] [-a s] [-R n] [-n] [-c] [-z] [-g MiB]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	StandinServer server;
+	if (server.Start(root, port, faults, false) < 0) {
+		fprintf(stderr, "Could not listen on port %d.\n", port);
+		return 1;
+	}
+
+	/* A large download, which isn't worth keeping in the fixtures. */
+	std::string data((size_t)big << 20, '\0');
+	for (size_t i = 0; i < data.size(); i++) data[i] = (char)(i * 7 + (i >> 8));
+	server.Add("/files/big.bin", data);
+
+	printf("Serving %s on port %d. Build with make STANDIN=http://<this PC>:%d\n", root.c_str(), port, port);
+
+	setvbuf(stdout, nullptr, _IOLBF, 0); // The log shows up right away, also when redirected.
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	size_t logged = 0;
+	while (!stop) {
+		usleep(100000);
+
+		const std::vector<StandinRequest> requests = server.Requests();
+		for (; logged < requests.size(); logged++) {
+			const StandinRequest &request = requests[logged];
+			printf("%s %s%s%s%s\n", request.Method.c_str(), request.Path.c_str(), request.Query != "" ? "?" : "", request.Query.c_str(), request.Range != "" ? (" (" + request.Range + ")").c_str() : "");
+		}
+	}
+
+	server.Stop();
+	return 0;
+}
@@ -0,0 +1,473 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "standinServer.hpp"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define STANDIN_SLICE 0x4000U // The body is sent in slices of at most 16 KiB, so the rate can be kept.
+#define STANDIN_LAST_MODIFIED "Mon, 19 Oct 2026 00:00:00 GMT"
+
+/*
+	Start serving on the given port, 0 for any free one.
+	Returns the port or -1 on failure.
+
+	const std::string &root: Const Reference to the fixture directory.
+	int port: The port.
+	const StandinFaults &faults: Const Reference to the faults of every request.
+	bool local: Only accept connections from this machine. A 3DS on the network needs false.
+*/
+int StandinServer::Start(const std::string &root, int port, const StandinFaults &faults, bool local) {
+	this->root = root;
+	this->faults = faults;
+
+	this->listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (this->listener < 0) return -1;
+
+	const int yes = 1;
+	setsockopt(this->listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+	sockaddr_in addr = { };
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(local ? INADDR_LOOPBACK : INADDR_ANY);
+	addr.sin_port = htons(port);
+
+	socklen_t len = sizeof(addr);
+	if (bind(this->listener, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(this->listener, 64) != 0 || getsockname(this->listener, (sockaddr *)&addr, &len) != 0) {
+		close(this->listener);
+		this->listener = -1;
+		return -1;
+	}
+
+	this->port = ntohs(addr.sin_port);
+	this->running = true;
+	this->acceptThread = std::thread(&StandinServer::AcceptLoop, this);
+	return this->port;
+}
+
+/*
+	Stop serving and wait for the open connections.
+*/
+void StandinServer::Stop() {
+	if (!this->running) return;
+	this->running = false;
+
+	shutdown(this->listener, SHUT_RDWR);
+	close(this->listener);
+	this->listener = -1;
+	this->acceptThread.join();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->idle.wait(lock, [this]() { return this->active == 0; });
+}
+
+/*
+	Serve data from RAM.
+
+	const std::string &path: Const Reference to the path, e.g. /github.com/owner/repo/file.
+	const std::string &data: Const Reference to the data.
+*/
+void StandinServer::Add(const std::string &path, const std::string &data) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	this->files[path] = data;
+}
+
+/*
+	Return the URL of a path on the server.
+
+	const std::string &path: Const Reference to the path.
+*/
+std::string StandinServer::Url(const std::string &path) const {
+	return "http://127.0.0.1:" + std::to_string(this->port) + path;
+}
+
+/*
+	Return all requests so far.
+*/
+std::vector<StandinRequest> StandinServer::Requests() {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	return this->requests;
+}
+
+/*
+	Return, how often a path got requested with a method.
+
+	const std::string &method: Const Reference to the method, e.g. GET.
+	const std::string &path: Const Reference to the path without the query.
+*/
+size_t StandinServer::Count(const std::string &method, const std::string &path) {
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	size_t count = 0;
+	for (const StandinRequest &request : this->requests) {
+		if (request.Method == method && request.Path == path) count++;
+	}
+
+	return count;
+}
+
+/*
+	Return the most requests, which were answered at once.
+*/
+int StandinServer::Connections() {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	return this->connections;
+}
+
+int StandinServer::Peak() {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	return this->peak;
+}
+
+void StandinServer::ClearRequests() {
+	std::lock_guard<std::mutex> guard(this->mutex);
+	this->requests.clear();
+	this->hits.clear();
+	this->peak = this->answering;
+	this->connections = 0;
+}
+
+void StandinServer::AcceptLoop() {
+	while (this->running) {
+		const int client = accept(this->listener, nullptr, nullptr);
+		if (client < 0) continue;
+
+		/* A client, which never sends its request, doesn't keep Stop() waiting. */
+		const timeval timeout = { 5, 0 };
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		{
+			std::lock_guard<std::mutex> guard(this->mutex);
+			this->active++;
+			this->connections++;
+		}
+
+		std::thread([this, client]() {
+			this->Handle(client);
+
+			std::lock_guard<std::mutex> guard(this->mutex);
+			if (--this->active == 0) this->idle.notify_all();
+		}).detach();
+	}
+}
+
+/*
+	Find the data of a path, in RAM or below the root.
+
+	const std::string &path: Const Reference to the path.
+	std::string &data: Output for the data.
+*/
+bool StandinServer::Lookup(const std::string &path, std::string &data) {
+	{
+		std::lock_guard<std::mutex> guard(this->mutex);
+		const auto it = this->files.find(path);
+		if (it != this->files.end()) {
+			data = it->second;
+			return true;
+		}
+	}
+
+	if (this->root == "" || path.find("..") != std::string::npos) return false;
+
+	for (const std::string &candidate : { path, path + ".json", path + "/index.json" }) {
+		FILE *file = fopen((this->root + candidate).c_str(), "rb");
+		if (!file) continue;
+
+		char buffer[0x1000];
+		size_t read = 0;
+		data.clear();
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, read);
+
+		const bool ok = !ferror(file);
+		fclose(file);
+		if (!ok) continue; // E.g. a directory.
+
+		/* Release JSON and UniStores point to the files on the stand-in. */
+		const size_t dot = candidate.rfind('.');
+		if (dot != std::string::npos && (candidate.compare(dot, std::string::npos, ".json") == 0 || candidate.compare(dot, std::string::npos, ".unistore") == 0)) {
+			const std::string base = this->Url();
+			for (size_t pos = data.find("{{STANDIN}}"); pos != std::string::npos; pos = data.find("{{STANDIN}}", pos + base.size())) data.replace(pos, 11, base);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool sendAll(int client, const char *data, size_t size) {
+	while (size > 0) {
+		const ssize_t sent = send(client, data, size, MSG_NOSIGNAL);
+		if (sent <= 0) return false;
+
+		data += sent;
+		size -= sent;
+	}
+
+	return true;
+}
+
+static std::string headerOf(const std::string &head, const char *name) {
+	const size_t len = strlen(name);
+
+	for (size_t pos = head.find("\r\n"); pos != std::string::npos; pos = head.find("\r\n", pos + 2)) {
+		if (strncasecmp(head.c_str() + pos + 2, name, len) != 0 || head[pos + 2 + len] != ':') continue;
+
+		const size_t start = head.find_first_not_of(" \t", pos + 3 + len);
+		const size_t end = head.find("\r\n", pos + 2);
+		return start < end ? head.substr(start, end - start) : "";
+	}
+
+	return "";
+}
+
+/*
+	Return the data gzipped, like a server with compression enabled sends it.
+
+	const std::string &data: Const Reference to the data.
+*/
+static std::string gzipOf(const std::string &data) {
+	z_stream zs = { };
+	if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return data;
+
+	std::string out(deflateBound(&zs, data.size()), '\0');
+	zs.next_in = (Bytef *)data.data();
+	zs.avail_in = data.size();
+	zs.next_out = (Bytef *)&out[0];
+	zs.avail_out = out.size();
+
+	deflate(&zs, Z_FINISH);
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return out;
+}
+
+static unsigned long long hashOf(const std::string &data) {
+	unsigned long long hash = 14695981039346656037ULL; // FNV-1a.
+	for (unsigned char c : data) hash = (hash ^ c) * 1099511628211ULL;
+	return hash;
+}
+
+void StandinServer::Handle(int client) {
+	char buffer[0x1000];
+	std::string pending = ""; // What got received past the last request.
+
+	/* Connections are closed after every response, unless a request asks for keepalive=1. */
+	while (this->Answer(client, pending)) { }
+
+	shutdown(client, SHUT_WR);
+	while (recv(client, buffer, sizeof(buffer), 0) > 0); // Let the client close first, so nothing gets reset.
+	close(client);
+}
+
+/*
+	Answer one request of a connection. Returns true, if the connection stays open for the next one.
+
+	int client: The socket of the connection.
+	std::string &pending: Reference to what got received past the previous request.
+*/
+bool StandinServer::Answer(int client, std::string &pending) {
+	std::string head = pending;
+	char buffer[0x1000];
+
+	while (head.find("\r\n\r\n") == std::string::npos && head.size() < 0x4000) {
+		const ssize_t read = recv(client, buffer, sizeof(buffer), 0);
+		if (read <= 0) break;
+		head.append(buffer, read);
+	}
+
+	const size_t headEnd = head.find("\r\n\r\n");
+	pending = headEnd != std::string::npos ? head.substr(headEnd + 4) : "";
+
+	const size_t methodEnd = head.find(' '), targetEnd = head.find(' ', methodEnd + 1);
+	if (methodEnd == std::string::npos || targetEnd == std::string::npos) return false;
+
+	StandinRequest request;
+	request.Method = head.substr(0, methodEnd);
+	const std::string target = head.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+	const size_t queryStart = target.find('?');
+	request.Path = target.substr(0, queryStart);
+	request.Query = queryStart != std::string::npos ? target.substr(queryStart + 1) : "";
+	request.Range = headerOf(head, "Range");
+
+	/* The query overrides the faults of the server. */
+	StandinFaults faults = this->faults;
+	bool keepAlive = false;
+	std::vector<std::pair<std::string, std::string>> params;
+	for (size_t pos = 0; pos < request.Query.size();) {
+		size_t end = request.Query.find('&', pos);
+		if (end == std::string::npos) end = request.Query.size();
+
+		const std::string param = request.Query.substr(pos, end - pos);
+		const size_t equals = param.find('=');
+		params.push_back({ param.substr(0, equals), equals != std::string::npos ? param.substr(equals + 1) : "" });
+		pos = end + 1;
+	}
+
+	for (const auto &param : params) {
+		const unsigned long long value = strtoull(param.second.c_str(), nullptr, 10);
+
+		if (param.first == "latency") faults.Latency = value;
+		else if (param.first == "rate") faults.Rate = value;
+		else if (param.first == "truncate") faults.Truncate = value;
+		else if (param.first == "status") faults.Status = value;
+		else if (param.first == "fail") faults.Fail = value;
+		else if (param.first == "retryAfter") faults.RetryAfter = value;
+		else if (param.first == "redirect") faults.Redirect = value;
+		else if (param.first == "noranges") faults.NoRanges = value != 0;
+		else if (param.first == "chunked") faults.Chunked = value != 0;
+		else if (param.first == "keepalive") keepAlive = value != 0;
+		else if (param.first == "gzip") faults.Gzip = value != 0;
+	}
+
+	unsigned hit = 0;
+	{
+		std::lock_guard<std::mutex> guard(this->mutex);
+		this->requests.push_back(request);
+		hit = this->hits[request.Method + " " + target]++;
+		if (++this->answering > this->peak) this->peak = this->answering;
+	}
+
+	if (faults.Latency > 0) std::this_thread::sleep_for(std::chrono::milliseconds(faults.Latency));
+
+	std::string data = "", status = "200 OK", headers = "";
+	bool body = true;
+
+	if (faults.Redirect > 0) {
+		std::string location = request.Path + "?";
+		for (const auto &param : params) {
+			if (param.first != "redirect") location += param.first + "=" + param.second + "&";
+		}
+
+		location += "redirect=" + std::to_string(faults.Redirect - 1);
+		status = "302 Found";
+		headers += "Location: " + location + "\r\n";
+		body = false;
+
+	} else if (hit < faults.Fail) {
+		status = "503 Service Unavailable";
+		if (faults.RetryAfter > 0) headers += "Retry-After: " + std::to_string(faults.RetryAfter) + "\r\n";
+		body = false;
+
+	} else if (faults.Status != 0) {
+		status = std::to_string(faults.Status) + " Injected";
+		body = false;
+
+	} else if (!this->Lookup(request.Path, data)) {
+		status = "404 Not Found";
+		body = false;
+	}
+
+	size_t start = 0, length = data.size();
+	if (body) {
+		char etag[32];
+		snprintf(etag, sizeof(etag), "\"%016llx\"", hashOf(data));
+		headers += "ETag: " + std::string(etag) + "\r\nLast-Modified: " STANDIN_LAST_MODIFIED "\r\n";
+		if (!faults.NoRanges) headers += "Accept-Ranges: bytes\r\n";
+
+		const std::string ifRange = headerOf(head, "If-Range");
+
+		if (headerOf(head, "If-None-Match") == etag || headerOf(head, "If-Modified-Since") == STANDIN_LAST_MODIFIED) {
+			status = "304 Not Modified";
+			length = 0;
+
+		/* A changed file gets sent whole, like If-Range asks for. */
+		} else if (request.Range.compare(0, 6, "bytes=") == 0 && !faults.NoRanges && (ifRange == "" || ifRange == etag || ifRange == STANDIN_LAST_MODIFIED)) {
+			const size_t dash = request.Range.find('-');
+			start = strtoull(request.Range.c_str() + 6, nullptr, 10);
+			size_t end = (dash + 1 < request.Range.size()) ? strtoull(request.Range.c_str() + dash + 1, nullptr, 10) : data.size() - 1;
+			if (end >= data.size()) end = data.size() - 1;
+
+			if (start >= data.size() || end < start) {
+				status = "416 Range Not Satisfiable";
+				headers += "Content-Range: bytes */" + std::to_string(data.size()) + "\r\n";
+				start = 0;
+				length = 0;
+
+			} else {
+				status = "206 Partial Content";
+				headers += "Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end) + "/" + std::to_string(data.size()) + "\r\n";
+				length = end - start + 1;
+			}
+
+		/* The whole file only; ranges of a gzipped body aren't served. */
+		} else if (faults.Gzip && headerOf(head, "Accept-Encoding").find("gzip") != std::string::npos) {
+			data = gzipOf(data);
+			length = data.size();
+			headers += "Content-Encoding: gzip\r\n";
+		}
+
+	} else length = 0;
+
+	if (faults.Chunked && length > 0) headers += "Transfer-Encoding: chunked\r\n";
+	else headers += "Content-Length: " + std::to_string(length) + "\r\n";
+
+	const std::string response = "HTTP/1.1 " + status + "\r\n" + headers + (keepAlive ? "\r\n" : "Connection: close\r\n\r\n");
+	bool ok = sendAll(client, response.c_str(), response.size());
+
+	/* The body in slices, as fast as the rate allows and as far as the truncation allows. */
+	if (request.Method != "HEAD") {
+		const auto begin = std::chrono::steady_clock::now();
+		size_t sent = 0;
+
+		while (ok && sent < length) {
+			size_t slice = std::min((size_t)(faults.Rate > 0 ? std::min(STANDIN_SLICE, std::max(faults.Rate / 10, 1024U)) : STANDIN_SLICE), length - sent);
+			if (faults.Truncate >= 0 && sent + slice > (size_t)faults.Truncate) slice = faults.Truncate - sent;
+			if (slice == 0) break;
+
+			/* A slice goes out, once the rate allows all of it. */
+			if (faults.Rate > 0) std::this_thread::sleep_until(begin + std::chrono::microseconds((unsigned long long)(sent + slice) * 1000000ULL / faults.Rate));
+
+			if (faults.Chunked) {
+				char size[24];
+				snprintf(size, sizeof(size), "%zx\r\n", slice);
+				ok = sendAll(client, size, strlen(size));
+			}
+
+			ok = ok && sendAll(client, data.data() + start + sent, slice);
+			if (faults.Chunked) ok = ok && sendAll(client, "\r\n", 2);
+			sent += slice;
+		}
+
+		if (ok && faults.Chunked && sent == length && length > 0) ok = sendAll(client, "0\r\n\r\n", 5);
+		ok = ok && sent == length;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(this->mutex);
+		this->answering--;
+	}
+
+	return ok && keepAlive;
+}
@@ -0,0 +1,106 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_STANDIN_SERVER_HPP
+#define _UNIVERSAL_UPDATER_STANDIN_SERVER_HPP
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	What goes wrong on purpose. Given to Start(), it applies to every request,
+	the query string of a request overrides it:
+
+		latency=<ms>      Wait before answering.
+		rate=<bytes/s>    Limit the bandwidth of the body.
+		truncate=<bytes>  Close the connection after that much of the body.
+		status=<code>     Answer with that status instead of the file.
+		fail=<n>          Answer the first n requests of the URL with 503.
+		retryAfter=<s>    Send Retry-After with the injected 503s.
+		redirect=<n>      Redirect n times, before answering.
+		noranges=1        Ignore Range requests and don't advertise them.
+		chunked=1         Send the body chunked, without a Content-Length.
+		gzip=1            Gzip the whole body, if the client sends Accept-Encoding: gzip.
+		keepalive=1       Keep the connection open for the next request. (Closed after every response otherwise)
+*/
+struct StandinFaults {
+	unsigned Latency = 0, Rate = 0, Fail = 0, RetryAfter = 0, Redirect = 0;
+	long long Truncate = -1;
+	int Status = 0;
+	bool NoRanges = false, Chunked = false, Gzip = false;
+};
+
+struct StandinRequest {
+	std::string Method, Path, Query, Range;
+};
+
+/*
+	A small HTTP/1.1 stand-in for GitHub, the GitHub API and Universal-DB.
+	Serves the files below root, where the first part of the path is the hostname, like a STANDIN build asks for them,
+	e.g. /api.github.com/repos/Universal-Team/Universal-Updater/releases/latest.
+	A path also matches <path>.json and <path>/index.json, {{STANDIN}} in JSON and UniStore files becomes the URL of the server.
+	Files added through Add() are served from RAM and take precedence.
+*/
+class StandinServer {
+public:
+	~StandinServer() { this->Stop(); };
+
+	int Start(const std::string &root, int port = 0, const StandinFaults &faults = StandinFaults(), bool local = true);
+	void Stop();
+	void Add(const std::string &path, const std::string &data);
+	std::string Url(const std::string &path = "") const;
+
+	std::vector<StandinRequest> Requests();
+	size_t Count(const std::string &method, const std::string &path);
+	int Peak();
+	int Connections(); // Accepted since ClearRequests().
+	void ClearRequests();
+private:
+	void AcceptLoop();
+	void Handle(int client);
+	bool Answer(int client, std::string &pending);
+	bool Lookup(const std::string &path, std::string &data);
+
+	std::string root = "";
+	int listener = -1, port = 0;
+	bool running = false;
+	StandinFaults faults;
+	std::thread acceptThread;
+	int active = 0; // Connections, which are still handled.
+	int answering = 0, peak = 0; // Requests, which are being answered, and the most at once since ClearRequests().
+	int connections = 0;
+	std::condition_variable idle;
+	std::map<std::string, std::string> files;
+	std::map<std::string, unsigned> hits; // Requests per URL, for fail=<n>.
+	std::vector<StandinRequest> requests;
+	std::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,238 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	Installing CIAs while they get downloaded, into a fake installer instead of AM.
+*/
+
+#include "ciaStream.hpp"
+#include "downloadEngine.hpp"
+#include "test.hpp"
+
+#include <map>
+
+extern u32 installSize, installOffset;
+
+#define CIA_PATH "/github.com/Universal-Team/Universal-Updater/releases/download/v9.9.9/Universal-Updater.cia"
+#define CIA_TITLE_ID 0x0004000004391700ULL // In the TMD of the fixture.
+
+/* Takes the CIA like AM would, and remembers what happened to it. */
+struct FakeInstaller {
+	std::map<u64, std::string> writes; // By offset.
+	FS_MediaType media = MEDIATYPE_NAND;
+	bool started = false, finished = false, canceled = false;
+	u64 deleted = 0; // The title ID of the deleted previous title.
+	Result finishResult = 0, writeResult = 0;
+
+	CiaInstaller Installer() {
+		CiaInstaller installer;
+		installer.DeletePrevious = [this](u64 titleID, FS_MediaType media) { this->deleted = this->started ? 0 : titleID; return (Result)0; };
+		installer.Start = [this](FS_MediaType media, Handle *handle) { this->started = true; this->media = media; *handle = 0x1234; return (Result)0; };
+		installer.Write = [this](Handle handle, u64 offset, const void *data, u32 size) {
+			this->writes[offset] = std::string((const char *)data, size);
+			return this->writeResult;
+		};
+
+		installer.Finish = [this](Handle handle) { this->finished = R_SUCCEEDED(this->finishResult); return this->finishResult; };
+		installer.Cancel = [this](Handle handle) { this->canceled = true; return (Result)0; };
+		return installer;
+	}
+
+	/* The written data, if it was written without gaps. */
+	std::string Content() const {
+		std::string content;
+		for (const auto &write : this->writes) {
+			if (write.first != content.size()) return "";
+			content += write.second;
+		}
+
+		return content;
+	}
+};
+
+/*
+	Stream a download into the fake installer, like ScriptUtils::downloadInstallFile does.
+
+	const std::string &path: Const Reference to the path on the stand-in, with the query.
+	FakeInstaller &fake: Reference to the fake installer.
+	u64 &titleID: Reference to the title ID.
+	bool &staged: Reference to the fallback state.
+*/
+static Result install(const std::string &path, FakeInstaller &fake, u64 &titleID, bool &staged) {
+	ArchiveStream stream;
+	std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(Test::Standin().Url(path));
+	ctx->priority = TransferPriority::Bulk;
+	ctx->sink = [&stream, raw = ctx.get()](const char *data, size_t size) {
+		if (stream.length < 0) stream.length = raw->length;
+		return stream.Push(data, size);
+	};
+
+	stream.drained = [raw = ctx.get()]() { raw->SinkDrained(); };
+	ctx->callback = [&stream](DownloadContext &done) { stream.Close(done.state != TransferState::Done); };
+	DownloadEngine::Add(ctx);
+
+	const Result ret = CiaStream::Install(stream, fake.Installer(), titleID, staged);
+
+	stream.Abort();
+	DownloadEngine::Cancel(ctx);
+	DownloadEngine::Wait(ctx);
+	return ret;
+}
+
+static std::string fixture(const std::string &path) {
+	FILE *file = fopen(("fixtures" + path).c_str(), "rb");
+	if (!file) return "";
+
+	std::string data;
+	char buffer[0x1000];
+	size_t read = 0;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, read);
+	fclose(file);
+	return data;
+}
+
+TEST(ciaStreamDestination) {
+	CHECK(CiaStream::Destination(CIA_TITLE_ID) == MEDIATYPE_SD);
+	CHECK(CiaStream::Destination(0x0004013800000002ULL) == MEDIATYPE_NAND); // System module.
+	CHECK(CiaStream::Destination(0x00048004484E4145ULL) == MEDIATYPE_NAND); // DSiWare.
+	CHECK(CiaStream::Destination(0x0003000042383841ULL) == MEDIATYPE_NAND); // DSi.
+}
+
+TEST(ciaStreamSizeFromHeader) {
+	const std::string cia = fixture(CIA_PATH);
+	CHECK(CiaStream::Size(std::vector<u8>(cia.begin(), cia.begin() + 0x1F)) == 0); // Needs the whole header.
+	CHECK(CiaStream::Size(std::vector<u8>(cia.begin(), cia.begin() + 0x20)) == cia.size());
+
+	/* A meta section starts aligned behind the content. */
+	std::vector<u8> header(cia.begin(), cia.begin() + 0x20);
+	header[0x14] = 0xC0; // Meta size 0x3AC0.
+	header[0x15] = 0x3A;
+	header[0x18] = 0x30; // Content size 0x30.
+	CHECK(CiaStream::Size(header) == 0x2FC0 + 0x40 + 0x3AC0);
+}
+
+TEST(ciaStreamInstallsWhileDownloading) {
+	const std::string cia = fixture(CIA_PATH);
+	CHECK(cia.size() > 0);
+
+	FakeInstaller fake;
+	u64 titleID = 0;
+	bool staged = true;
+
+	CHECK(install(CIA_PATH "?rate=16384", fake, titleID, staged) == 0);
+	CHECK(titleID == CIA_TITLE_ID);
+	CHECK(!staged);
+	CHECK(fake.media == MEDIATYPE_SD);
+	CHECK(fake.finished && !fake.canceled);
+	CHECK(fake.Content() == cia);
+	CHECK(fake.deleted == CIA_TITLE_ID); // Before the install started, like the file based install.
+	CHECK(installSize == cia.size() && installOffset == cia.size());
+}
+
+TEST(ciaStreamInstallsGzippedResponse) {
+	const std::string cia = fixture(CIA_PATH);
+	FakeInstaller fake;
+	u64 titleID = 0;
+	bool staged = true;
+
+	CHECK(install(CIA_PATH "?gzip=1", fake, titleID, staged) == 0);
+	CHECK(!staged);
+	CHECK(fake.finished && fake.Content() == cia);
+}
+
+TEST(ciaStreamStagesBrokenDownload) {
+	FakeInstaller fake;
+	u64 titleID = 0;
+	bool staged = false;
+
+	CHECK(install(CIA_PATH "?truncate=12200", fake, titleID, staged) != 0); // Behind the title ID.
+	CHECK(staged); // Storing the CIA first may still work.
+	CHECK(fake.started && fake.canceled && !fake.finished);
+}
+
+TEST(ciaStreamInstallsWithoutLength) {
+	const std::string cia = fixture(CIA_PATH);
+	FakeInstaller fake;
+	u64 titleID = 0;
+	bool staged = true;
+
+	CHECK(install(CIA_PATH "?chunked=1", fake, titleID, staged) == 0); // The header tells the size.
+	CHECK(!staged);
+	CHECK(fake.finished && fake.Content() == cia);
+	CHECK(installSize == cia.size());
+}
+
+TEST(ciaStreamKeepsTitleWithoutDeletePrevious) {
+	FakeInstaller fake;
+	CiaInstaller installer = fake.Installer();
+	installer.DeletePrevious = nullptr; // Universal-Updater updating itself.
+
+	ArchiveStream stream;
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url(CIA_PATH));
+	ctx->sink = [&stream](const char *data, size_t size) { return stream.Push(data, size); };
+	stream.drained = [raw = ctx.get()]() { raw->SinkDrained(); };
+	ctx->callback = [&stream](DownloadContext &done) { stream.Close(done.state != TransferState::Done); };
+	DownloadEngine::Add(ctx);
+
+	u64 titleID = 0;
+	bool staged = true;
+	CHECK(CiaStream::Install(stream, installer, titleID, staged) == 0);
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(fake.finished && fake.deleted == 0);
+}
+
+TEST(ciaStreamStagesRefusedFinish) {
+	FakeInstaller fake;
+	fake.finishResult = -1; // E.g. a newer version is installed.
+	u64 titleID = 0;
+	bool staged = false;
+
+	CHECK(install(CIA_PATH, fake, titleID, staged) == -1);
+	CHECK(staged);
+	CHECK(!fake.finished);
+}
+
+TEST(ciaStreamFailsOnWriteError) {
+	FakeInstaller fake;
+	fake.writeResult = -2; // The installer itself broke, so storing the CIA first won't help.
+	u64 titleID = 0;
+	bool staged = true;
+
+	CHECK(install(CIA_PATH, fake, titleID, staged) == -2);
+	CHECK(!staged);
+	CHECK(fake.canceled && !fake.finished);
+}
+
+TEST(ciaStreamRejectsOtherData) {
+	Test::Pattern(0x10000);
+	FakeInstaller fake;
+	u64 titleID = 0;
+	bool staged = true;
+
+	CHECK(install("/files/65536.bin", fake, titleID, staged) != 0);
+	CHECK(!staged);
+	CHECK(!fake.started);
+}
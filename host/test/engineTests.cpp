@@ -0,0 +1,231 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	How the DownloadEngine schedules transfers: the limit of parallel transfers, the priorities
+	and the pausing for a full ring or a slow sink.
+*/
+
+#include "archiveStream.hpp"
+#include "downloadEngine.hpp"
+#include "test.hpp"
+
+#include <unistd.h>
+
+static std::shared_ptr<DownloadContext> add(const std::string &query, TransferPriority priority, const std::string &path = "") {
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/65536.bin?" + query), path);
+	ctx->priority = priority;
+	return DownloadEngine::Add(ctx);
+}
+
+TEST(engineLimitsParallelTransfers) {
+	Test::Pattern(0x10000);
+
+	std::vector<std::shared_ptr<DownloadContext>> transfers;
+	for (int i = 0; i < 8; i++) transfers.push_back(add("rate=131072", TransferPriority::Metadata));
+	for (const auto &ctx : transfers) CHECK(DownloadEngine::Wait(ctx));
+
+	CHECK(Test::Standin().Peak() == 4);
+	CHECK(Test::Standin().Count("GET", "/files/65536.bin") == 8);
+}
+
+TEST(engineKeepsSlotFreeOfSpeculative) {
+	Test::Pattern(0x10000);
+
+	std::vector<std::shared_ptr<DownloadContext>> transfers;
+	for (int i = 0; i < 6; i++) transfers.push_back(add("rate=131072", TransferPriority::Speculative));
+	for (const auto &ctx : transfers) CHECK(DownloadEngine::Wait(ctx));
+
+	CHECK(Test::Standin().Peak() == 3);
+}
+
+TEST(engineStartsInteractiveBeyondLimit) {
+	Test::Pattern(0x10000);
+
+	std::vector<std::shared_ptr<DownloadContext>> bulk;
+	for (int i = 0; i < 4; i++) bulk.push_back(add("rate=65536", TransferPriority::Bulk));
+	usleep(200000);
+
+	const u64 start = Test::Now();
+	auto interactive = add("", TransferPriority::Interactive);
+	CHECK(DownloadEngine::Wait(interactive));
+	CHECK(Test::Now() - start < 500); // Not after the bulk transfers.
+
+	for (const auto &ctx : bulk) CHECK(ctx->state != TransferState::Done);
+	for (const auto &ctx : bulk) CHECK(DownloadEngine::Wait(ctx));
+
+	CHECK(Test::Standin().Peak() == 5);
+}
+
+TEST(engineStartsMostUrgentFirst) {
+	Test::Pattern(0x10000);
+
+	/* The slots become free one after another. */
+	std::vector<std::shared_ptr<DownloadContext>> busy;
+	for (int i = 0; i < 4; i++) busy.push_back(add("latency=" + std::to_string(300 + i * 150), TransferPriority::Bulk));
+	usleep(100000);
+
+	auto speculative = add("latency=100&speculative", TransferPriority::Speculative);
+	auto bulk = add("latency=100&bulk", TransferPriority::Bulk);
+	auto metadata = add("latency=100&metadata", TransferPriority::Metadata);
+
+	CHECK(DownloadEngine::Wait(metadata));
+	CHECK(DownloadEngine::Wait(bulk));
+	CHECK(DownloadEngine::Wait(speculative));
+	for (const auto &ctx : busy) CHECK(DownloadEngine::Wait(ctx));
+
+	const std::vector<StandinRequest> requests = Test::Standin().Requests();
+	CHECK(requests.size() == 7);
+	CHECK(requests[4].Query == "latency=100&metadata");
+	CHECK(requests[5].Query == "latency=100&bulk");
+	CHECK(requests[6].Query == "latency=100&speculative");
+}
+
+TEST(engineBulkYieldsToMetadata) {
+	const std::string data = Test::Pattern(0x400000);
+
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/4194304.bin?rate=4194304"), "build/test/yield.bin");
+	ctx->priority = TransferPriority::Bulk;
+	DownloadEngine::Add(ctx);
+	usleep(200000);
+
+	/* While the metadata transfer runs, the bulk one pauses. */
+	auto metadata = add("latency=1000", TransferPriority::Metadata);
+	usleep(300000);
+	CHECK(Scheduler::ShouldYield(TransferPriority::Bulk));
+	const curl_off_t before = ctx->now;
+	usleep(500000);
+	CHECK(ctx->now - before < 0x40000); // At most the chunks, which were in flight.
+
+	CHECK(DownloadEngine::Wait(metadata));
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(Test::FileIs("build/test/yield.bin", data));
+	remove("build/test/yield.bin");
+}
+
+TEST(engineSmallRingPausesTransfer) {
+	const std::string data = Test::Pattern(0x400000);
+
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/4194304.bin"), "build/test/ring.bin");
+	ctx->ringBuffers = 2;
+	ctx->lowWatermark = 1;
+	DownloadEngine::Add(ctx);
+
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(Test::FileIs("build/test/ring.bin", data));
+	remove("build/test/ring.bin");
+}
+
+TEST(engineSlowSinkPausesOnlyItsTransfer) {
+	const std::string data = Test::Pattern(0x400000);
+	ArchiveStream stream;
+
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/4194304.bin"));
+	ctx->sink = [&stream](const char *buffer, size_t size) { return stream.Push(buffer, size); };
+	stream.drained = [raw = ctx.get()]() { raw->SinkDrained(); };
+	ctx->callback = [&stream](DownloadContext &done) { stream.Close(done.state != TransferState::Done); };
+	DownloadEngine::Add(ctx);
+
+	/* Read slowly, a second transfer has to finish meanwhile. */
+	auto other = add("", TransferPriority::Metadata);
+	std::string received;
+	const void *buffer = nullptr;
+	ssize_t read = 0;
+
+	for (int i = 0; (read = stream.Read(&buffer)) > 0; i++) {
+		received.append((const char *)buffer, read);
+		if (i < 16) usleep(20000);
+		if (i == 16) CHECK(other->state == TransferState::Done);
+	}
+
+	CHECK(read == 0);
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(DownloadEngine::Wait(other));
+	CHECK(received == data);
+}
+
+TEST(engineSharesConnectionsWithBlockingHandles) {
+	const std::string data = Test::Pattern(0x10000);
+	const std::string url = Test::Standin().Url("/files/65536.bin?keepalive=1");
+
+	for (int i = 0; i < 2; i++) {
+		auto ctx = DownloadEngine::Add(url);
+		CHECK(DownloadEngine::Wait(ctx));
+		CHECK(ctx->GetString() == data);
+
+		DownloadContext blocking(url);
+		CHECK(blocking.Perform() == 0);
+		CHECK(blocking.GetString() == data);
+	}
+
+	CHECK(Test::Standin().Count("GET", "/files/65536.bin") == 4);
+	CHECK(Test::Standin().Connections() == 1); // The engine and the pooled handles reuse one connection.
+}
+
+TEST(engineSinkGetsBodyUnencoded) {
+	const std::string data = Test::Pattern(0x10000);
+
+	/* Files are still fetched gzipped and decoded. */
+	DownloadContext file(Test::Standin().Url("/files/65536.bin?gzip=1"));
+	CHECK(file.Perform() == 0);
+	CHECK(file.GetString() == data);
+
+	/* A sink gets the length announced, so it has to match the bytes it gets. */
+	std::string received;
+	curl_off_t length = -1;
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/65536.bin?gzip=1"));
+	ctx->sink = [&received, &length, raw = ctx.get()](const char *buffer, size_t size) {
+		if (length < 0) length = raw->length;
+		received.append(buffer, size);
+		return SinkResult::Accepted;
+	};
+
+	CHECK(DownloadEngine::Wait(DownloadEngine::Add(ctx)));
+	CHECK(received == data);
+	CHECK(length == (curl_off_t)data.size());
+}
+
+TEST(engineConcludesAfterFileIsInPlace) {
+	const std::string data = Test::Pattern(0x400000);
+
+	/* The commit thread moves the part file, the engine only flips the state afterwards. */
+	bool inPlace = false;
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/4194304.bin"), "build/test/concluded.bin");
+	ctx->resumable = true;
+	ctx->callback = [&inPlace, &data](DownloadContext &done) {
+		inPlace = done.state == TransferState::Done && Test::FileIs("build/test/concluded.bin", data) && access("build/test/concluded.bin.part", F_OK) != 0;
+	};
+
+	CHECK(DownloadEngine::Wait(DownloadEngine::Add(ctx)));
+	CHECK(inPlace);
+	CHECK(!DownloadContext::HasJournal("build/test/concluded.bin"));
+
+	/* A failed one, which can't be continued, leaves nothing behind. */
+	auto missing = DownloadEngine::Add(Test::Standin().Url("/files/missing.bin"), "build/test/missing.bin");
+	CHECK(!DownloadEngine::Wait(missing));
+	CHECK(access("build/test/missing.bin", F_OK) != 0);
+	remove("build/test/concluded.bin");
+}
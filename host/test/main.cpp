@@ -0,0 +1,147 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	Runs the host tests: uu-test [name...]
+	Has to run in the host directory, so the stand-in finds the fixtures. The output of the core goes to build/uu-test.log.
+*/
+
+#include "curlPool.hpp"
+#include "downloadEngine.hpp"
+#include "test.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+struct TestCase {
+	const char *Name;
+	void (*Run)();
+};
+
+static std::vector<TestCase> &tests() {
+	static std::vector<TestCase> list; // Filled before main(), so it can't be a plain global.
+	return list;
+}
+
+static bool failed = false;
+
+bool Test::Register(const char *name, void (*run)()) {
+	tests().push_back({ name, run });
+	return true;
+}
+
+void Test::Fail(const char *file, int line, const char *condition) {
+	fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, condition);
+	failed = true;
+}
+
+StandinServer &Test::Standin() {
+	static StandinServer server;
+	return server;
+}
+
+/*
+	Return the data of /files/<size>.bin and serve it from then on.
+
+	size_t size: The size.
+*/
+std::string Test::Pattern(size_t size) {
+	std::string data(size, '\0');
+	for (size_t i = 0; i < size; i++) data[i] = (char)(i * 7 + (i >> 8));
+
+	Test::Standin().Add("/files/" + std::to_string(size) + ".bin", data);
+	return data;
+}
+
+/*
+	Return, if a file has exactly that content.
+
+	const std::string &path: Const Reference to the path.
+	const std::string &data: Const Reference to the expected content.
+*/
+bool Test::FileIs(const std::string &path, const std::string &data) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) return false;
+
+	std::string content;
+	char buffer[0x4000];
+	size_t read = 0;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) content.append(buffer, read);
+	fclose(file);
+
+	return content == data;
+}
+
+bool Test::WriteFile(const std::string &path, const std::string &data) {
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file) return false;
+
+	const bool written = fwrite(data.c_str(), 1, data.size(), file) == data.size();
+	fclose(file);
+	return written;
+}
+
+u64 Test::Now() { return svcGetSystemTick() / 1000000ULL; }
+
+int main(int argc, char *argv[]) {
+	mkdir("build", 0777);
+	mkdir("build/test", 0777);
+	if (!freopen("build/uu-test.log", "w", stdout)) return 1;
+
+	if (Test::Standin().Start("fixtures") < 0) {
+		fprintf(stderr, "Could not start the stand-in server.\n");
+		return 1;
+	}
+
+	CurlPool::Init();
+	DownloadEngine::Init(4);
+
+	int run = 0, failures = 0;
+	for (const TestCase &test : tests()) {
+		bool selected = argc < 2;
+		for (int i = 1; i < argc && !selected; i++) selected = strcmp(argv[i], test.Name) == 0;
+		if (!selected) continue;
+
+		fprintf(stderr, "%s\n", test.Name);
+		printf("==== %s\n", test.Name);
+
+		failed = false;
+		Test::Standin().ClearRequests();
+		test.Run();
+
+		run++;
+		if (failed) failures++;
+	}
+
+	DownloadEngine::Exit();
+	CurlPool::Exit();
+	Test::Standin().Stop();
+
+	fprintf(stderr, "%d of %d tests passed.\n", run - failures, run);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	The retries of failed downloads: the policy, the backoff, the failover to mirrors and continuing from the journal.
+*/
+
+#include "downloadEngine.hpp"
+#include "test.hpp"
+
+#include <algorithm>
+
+static RetryPolicy fastRetries() {
+	RetryPolicy retry;
+	retry.BaseDelay = 50;
+	retry.MaxDelay = 2000;
+	return retry;
+}
+
+TEST(retryOnlyTransientFailures) {
+	RetryPolicy retry;
+
+	CHECK(retry.Retryable(CURLE_OPERATION_TIMEDOUT, 0));
+	CHECK(retry.Retryable(CURLE_PARTIAL_FILE, 200));
+	CHECK(retry.Retryable(CURLE_HTTP_RETURNED_ERROR, 503));
+	CHECK(retry.Retryable(CURLE_HTTP_RETURNED_ERROR, 429));
+	CHECK(!retry.Retryable(CURLE_HTTP_RETURNED_ERROR, 404));
+	CHECK(!retry.Retryable(CURLE_HTTP_RETURNED_ERROR, 403));
+	CHECK(!retry.Retryable(CURLE_HTTP_RETURNED_ERROR, 416)); // Asking for the same range again won't help.
+	CHECK(!retry.Retryable(CURLE_WRITE_ERROR, 200));
+}
+
+TEST(retryDelayGrowsUpToMaximum) {
+	RetryPolicy retry;
+
+	for (u32 attempt = 1; attempt <= 8; attempt++) {
+		const u32 full = std::min(retry.BaseDelay << (attempt - 1), retry.MaxDelay);
+		const u32 delay = retry.Delay(attempt);
+		CHECK(delay >= full / 2 && delay <= full); // Jittered within the upper half.
+	}
+
+	CHECK(retry.Delay(1, 3000) == 3000); // Retry-After wins,
+	CHECK(retry.Delay(1, 60000) == retry.MaxDelay); // but only up to the maximum.
+}
+
+TEST(retryRecoversFromServerErrors) {
+	const std::string data = Test::Pattern(0x10000);
+
+	DownloadContext ctx(Test::Standin().Url("/files/65536.bin?fail=2"));
+	ctx.retry = fastRetries();
+
+	CHECK(ctx.Perform() == 0);
+	CHECK(ctx.GetString() == data);
+	CHECK(Test::Standin().Count("GET", "/files/65536.bin") == 3);
+}
+
+TEST(retryGivesUpAfterMaxAttempts) {
+	Test::Pattern(0x10000);
+
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/65536.bin?fail=10"));
+	ctx->retry = fastRetries();
+	DownloadEngine::Add(ctx);
+
+	CHECK(!DownloadEngine::Wait(ctx));
+	CHECK(ctx->status == 503);
+	CHECK(Test::Standin().Count("GET", "/files/65536.bin") == RETRY_ATTEMPTS);
+}
+
+TEST(retryNotOnClientErrors) {
+	DownloadContext ctx(Test::Standin().Url("/files/missing.bin"));
+	ctx.retry = fastRetries();
+
+	CHECK(ctx.Perform() != 0);
+	CHECK(ctx.status == 404);
+	CHECK(Test::Standin().Count("GET", "/files/missing.bin") == 1);
+}
+
+TEST(retryWaitsForRetryAfter) {
+	Test::Pattern(0x10000);
+
+	DownloadContext ctx(Test::Standin().Url("/files/65536.bin?fail=1&retryAfter=1"));
+	ctx.retry = fastRetries();
+
+	const u64 start = Test::Now();
+	CHECK(ctx.Perform() == 0);
+	CHECK(Test::Now() - start >= 1000);
+}
+
+TEST(retryFailsOverToMirror) {
+	const std::string data = Test::Pattern(0x10000);
+	const std::string mirror = Test::Standin().Url("/files/65536.bin?mirror");
+
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/missing.bin"));
+	ctx->mirrors.push_back(mirror);
+	ctx->retry = fastRetries();
+	DownloadEngine::Add(ctx);
+
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(ctx->url == mirror);
+	CHECK(ctx->GetString() == data);
+}
+
+TEST(retryContinuesTruncatedFile) {
+	const std::string data = Test::Pattern(0x400000);
+
+	/* Every response breaks off after 1.5 MiB, so it takes three attempts, each continuing the part file. */
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/4194304.bin?truncate=1572864"), "build/test/resume.bin");
+	ctx->resumable = true;
+	ctx->retry = fastRetries();
+	DownloadEngine::Add(ctx);
+
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(Test::FileIs("build/test/resume.bin", data));
+	CHECK(!DownloadContext::HasJournal("build/test/resume.bin"));
+
+	const std::vector<StandinRequest> requests = Test::Standin().Requests();
+	CHECK(requests.size() == 3);
+	CHECK(requests[0].Range == "");
+	CHECK(requests[1].Range == "bytes=1572864-");
+	CHECK(requests[2].Range == "bytes=3145728-");
+	remove("build/test/resume.bin");
+}
+
+TEST(retryRestartsRefusedRangeOnce) {
+	const std::string data = Test::Pattern(0x10000);
+
+	/* A part file, which is longer than the file on the server now. */
+	Test::WriteFile("build/test/refused.bin.part", Test::Pattern(0x11000));
+	Test::WriteFile("build/test/refused.bin.part.journal", "{\"url\":\"" + Test::Standin().Url("/files/65536.bin") + "\",\"etag\":\"\",\"lastModified\":\"Mon, 19 Oct 2026 00:00:00 GMT\",\"committed\":69632}");
+
+	auto ctx = std::make_shared<DownloadContext>(Test::Standin().Url("/files/65536.bin"), "build/test/refused.bin");
+	ctx->resumable = true;
+	ctx->retry = fastRetries();
+	DownloadEngine::Add(ctx);
+
+	CHECK(DownloadEngine::Wait(ctx));
+	CHECK(Test::FileIs("build/test/refused.bin", data));
+
+	const std::vector<StandinRequest> requests = Test::Standin().Requests();
+	CHECK(requests.size() == 2);
+	CHECK(requests[0].Range == "bytes=69632-");
+	CHECK(requests[1].Range == "");
+	remove("build/test/refused.bin");
+}
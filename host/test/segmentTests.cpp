@@ -0,0 +1,148 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+/*
+	Segmented downloads against a slow, high-latency link, where every connection is limited on its own.
+	Prints the timings, like downloadSegmented() would see them, including what the HEAD probe costs.
+*/
+
+#include "downloadEngine.hpp"
+#include "test.hpp"
+
+#include <unistd.h>
+#include <zlib.h>
+
+#define LINK "latency=150&rate=1048576" // 150 ms round trip, 1 MiB/s per connection.
+
+/*
+	Download into path over count range requests in parallel, after probing with HEAD like downloadSegmented().
+	Returns the time it took in ms, or 0 on failure.
+
+	const std::string &url: Const Reference to the URL.
+	const std::string &path: Const Reference to the output.
+	int count: The amount of segments.
+	u64 &probeTime: Reference to the time of the HEAD probe.
+	std::shared_ptr<SegmentHasher> hasher: What hashes the file while the segments commit, if any.
+*/
+static u64 downloadSegments(const std::string &url, const std::string &path, int count, u64 &probeTime, std::shared_ptr<SegmentHasher> hasher = nullptr) {
+	const u64 start = Test::Now();
+
+	DownloadContext probe(url);
+	probe.headOnly = true;
+	if (probe.Perform() != 0 || !probe.acceptRanges || probe.length <= 0) return 0;
+	probeTime = Test::Now() - start;
+
+	FILE *out = fopen(path.c_str(), "wb");
+	const bool allocated = out && ftruncate(fileno(out), probe.length) == 0;
+	if (out) fclose(out);
+	if (!allocated) return 0;
+
+	std::vector<std::shared_ptr<DownloadContext>> segments;
+	for (int i = 0; i < count; i++) {
+		std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(url, path);
+		ctx->priority = TransferPriority::Bulk;
+		ctx->rangeStart = (probe.length / count) * i;
+		ctx->rangeEnd = (i == count - 1) ? probe.length - 1 : (probe.length / count) * (i + 1) - 1;
+		ctx->hasher = hasher;
+		if (hasher) hasher->Add(ctx->rangeStart, ctx->rangeEnd);
+		segments.push_back(ctx);
+	}
+
+	for (const std::shared_ptr<DownloadContext> &segment : segments) DownloadEngine::Add(segment);
+
+	bool ok = true;
+	for (const std::shared_ptr<DownloadContext> &segment : segments) ok = DownloadEngine::Wait(segment) && ok;
+	return ok ? Test::Now() - start : 0;
+}
+
+TEST(segmentsBeatOneSlowConnection) {
+	const std::string data = Test::Pattern(0x400000);
+	const std::string url = Test::Standin().Url("/files/4194304.bin?" LINK);
+
+	u64 start = Test::Now();
+	auto single = DownloadEngine::Add(url, "build/test/single.bin");
+	CHECK(DownloadEngine::Wait(single));
+	const u64 singleTime = Test::Now() - start;
+	CHECK(Test::FileIs("build/test/single.bin", data));
+
+	u64 probeTime = 0;
+	const u64 segmentedTime = downloadSegments(url, "build/test/segmented.bin", 4, probeTime);
+	CHECK(segmentedTime > 0);
+	CHECK(Test::FileIs("build/test/segmented.bin", data));
+
+	/* A file, which turns out too small for segments, pays for the probe. */
+	Test::Pattern(0x10000);
+	const std::string small = Test::Standin().Url("/files/65536.bin?" LINK);
+
+	start = Test::Now();
+	DownloadContext plain(small);
+	CHECK(plain.Perform() == 0);
+	const u64 plainTime = Test::Now() - start;
+
+	start = Test::Now();
+	DownloadContext probe(small), probed(small);
+	probe.headOnly = true;
+	CHECK(probe.Perform() == 0 && probed.Perform() == 0);
+	const u64 probedTime = Test::Now() - start;
+
+	fprintf(stderr, "  4 MiB: one connection %llu ms, 4 segments %llu ms, of that HEAD %llu ms\n", (unsigned long long)singleTime, (unsigned long long)segmentedTime, (unsigned long long)probeTime);
+	fprintf(stderr, "  64 KiB: GET %llu ms, HEAD + GET %llu ms\n", (unsigned long long)plainTime, (unsigned long long)probedTime);
+
+	CHECK(segmentedTime * 2 < singleTime);
+	CHECK(probedTime > plainTime + 100); // The round trip of the probe.
+
+	remove("build/test/single.bin");
+	remove("build/test/segmented.bin");
+}
+
+TEST(segmentsHashInOrder) {
+	const std::string data = Test::Pattern(0x400000);
+	const std::string url = Test::Standin().Url("/files/4194304.bin?" LINK);
+
+	u8 hash[32];
+	char sha256[sizeof(hash) * 2 + 1], crc32[9];
+	mbedtls_sha256_context sha;
+	mbedtls_sha256_init(&sha);
+	mbedtls_sha256_starts(&sha, 0);
+	mbedtls_sha256_update(&sha, (const unsigned char *)data.data(), data.size());
+	mbedtls_sha256_finish(&sha, hash);
+	mbedtls_sha256_free(&sha);
+	for (size_t i = 0; i < sizeof(hash); i++) snprintf(sha256 + i * 2, 3, "%02x", hash[i]);
+	snprintf(crc32, sizeof(crc32), "%08lx", ::crc32(0L, (const Bytef *)data.data(), data.size()));
+
+	u64 probeTime = 0;
+	auto hasher = std::make_shared<SegmentHasher>("build/test/hashed.bin", sha256, crc32);
+	CHECK(downloadSegments(url, "build/test/hashed.bin", 4, probeTime, hasher) > 0);
+	CHECK(hasher->Verify());
+	CHECK(hasher->ReadBack <= (curl_off_t)data.size() * 3 / 4); // At least the first segment is hashed as it commits.
+	fprintf(stderr, "  4 MiB in 4 segments: %lld bytes read back for the checksums\n", (long long)hasher->ReadBack);
+
+	hasher = std::make_shared<SegmentHasher>("build/test/hashed.bin", "", "00000000");
+	CHECK(downloadSegments(url, "build/test/hashed.bin", 4, probeTime, hasher) > 0);
+	CHECK(!hasher->Verify());
+
+	remove("build/test/hashed.bin");
+}
@@ -0,0 +1,61 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_TEST_HPP
+#define _UNIVERSAL_UPDATER_TEST_HPP
+
+#include "standinServer.hpp"
+#include <string>
+
+/*
+	A minimal test runner for the host build, since the core is built without exceptions.
+	TEST(name) defines and registers a test, CHECK(condition) ends it as failed, if the condition doesn't hold.
+*/
+namespace Test {
+	bool Register(const char *name, void (*run)());
+	void Fail(const char *file, int line, const char *condition);
+
+	StandinServer &Standin(); // Serves host/fixtures, started once for all tests.
+	std::string Pattern(size_t size); // The data of /files/<size>.bin on the stand-in.
+	bool FileIs(const std::string &path, const std::string &data);
+	bool WriteFile(const std::string &path, const std::string &data);
+	u64 Now(); // Milliseconds of a monotonic clock.
+};
+
+#define TEST(name) \
+	static void name(); \
+	static const bool name##Registered = Test::Register(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			Test::Fail(__FILE__, __LINE__, #condition); \
+			return; \
+		} \
+	} while (0)
+
+#endif
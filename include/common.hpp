@@ -32,15 +32,12 @@
 #include "lang.hpp"
 #include "msg.hpp"
 #include "screenCommon.hpp"
+#include "storeDefs.hpp"
 #include <3ds.h>
 #include <vector>
 
-#define _STORE_PATH "sdmc:/3ds/Universal-Updater/stores/"
-#define _META_PATH "sdmc:/3ds/Universal-Updater/MetaData.json"
 #define _THEME_AMOUNT 2
-#define _UNISTORE_VERSION 4
 
-inline std::unique_ptr<Config> config;
 inline uint32_t hRepeat, hDown, hHeld;
 inline touchPosition touch;
 inline C2D_Font font;
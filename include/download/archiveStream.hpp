@@ -0,0 +1,66 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_ARCHIVE_STREAM_HPP
+#define _UNIVERSAL_UPDATER_ARCHIVE_STREAM_HPP
+
+#include "downloadContext.hpp"
+#include <deque>
+#include <functional>
+#include <vector>
+
+#define STREAM_CHUNK_SIZE 0x10000
+#define STREAM_QUEUE_SIZE 0x100000 // The most data, which may wait for the extraction.
+
+/*
+	Hands downloaded data to the extraction, so archives can be extracted without storing them first.
+	Push() never blocks. If too much is queued, the download pauses until drained gets called.
+*/
+class ArchiveStream {
+public:
+	ArchiveStream();
+	~ArchiveStream();
+
+	SinkResult Push(const char *data, size_t size);
+	void Close(bool failed);
+	void Abort();
+	ssize_t Read(const void **buffer);
+
+	std::function<void()> drained = nullptr; // Called from the reading side, once a refused Push() would be taken again.
+	curl_off_t length = -1; // The size of the whole data, if the download told it before the first Push().
+private:
+	void NotifyDrained();
+
+	std::deque<std::vector<u8>> chunks;
+	std::vector<u8> current; // The chunk, which libarchive reads right now.
+	size_t queued = 0;
+	bool closed = false, failed = false, aborted = false;
+	bool refused = false; // A Push() got refused, so the writing side waits for drained.
+	LightLock lock;
+	CondVar changed;
+};
+
+#endif
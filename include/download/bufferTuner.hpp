@@ -0,0 +1,58 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_BUFFER_TUNER_HPP
+#define _UNIVERSAL_UPDATER_BUFFER_TUNER_HPP
+
+#include <3ds.h>
+#include <curl/curl.h>
+
+#define TUNER_MIN_CHUNK 0x10000 // 64 KiB.
+#define TUNER_MAX_CHUNK 0x100000 // 1 MiB.
+#define TUNER_DEFAULT_CHUNK 0x60000 // Until the throughput got measured.
+#define TUNER_MIN_CURL_BUFFER 0x4000 // 16 KiB.
+#define TUNER_MAX_CURL_BUFFER 0x80000 // 512 KiB, the most CURL accepts.
+#define TUNER_DEFAULT_CURL_BUFFER 102400
+
+#define TUNER_CHUNK_WINDOW 250 // A ring buffer holds that many ms of the throughput.
+#define TUNER_COMMIT_WINDOW 20 // A commit writes at least that many ms worth of data, so the fixed cost of a write doesn't dominate.
+#define TUNER_CURL_WINDOW 50 // The CURL buffer holds that many ms of the throughput.
+
+/*
+	Sizes the transfer buffers from the measured network throughput and SD card write speed,
+	so slow connections don't waste linear heap and fast ones don't write in small pieces.
+	All ring buffers together stay within the memory ceiling of the config, except for the minimum size.
+*/
+namespace BufferTuner {
+	void RecordThroughput(curl_off_t rate);
+	void RecordCommit(size_t size, u64 ticks);
+
+	size_t Acquire(u8 count);
+	void Release(size_t size);
+	long CurlBufferSize();
+};
+
+#endif
@@ -0,0 +1,55 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_DOWNLOAD_CACHE_HPP
+#define _UNIVERSAL_UPDATER_DOWNLOAD_CACHE_HPP
+
+#include "validatorCache.hpp"
+#include <string>
+
+#define _DOWNLOAD_CACHE_PATH "sdmc:/3ds/Universal-Updater/cache/"
+#define _DOWNLOAD_CACHE_INDEX _DOWNLOAD_CACHE_PATH "index.json"
+
+/*
+	An opt-in cache of downloaded files on the SD card, so reinstalls and assets shared between UniStores don't get downloaded again.
+	Files with a declared SHA-256 are found by it without asking the server, all others by their URL, once the server confirmed they are unchanged.
+	Without Wi-Fi, the cached copy of an URL is used as it is.
+	The least recently used files are dropped, once the cache grows beyond the quota of the config.
+	Cached files are moved out of the cache to their destination (DownloadCache::Restore), and downloaded and restored files are moved back, once they get deleted (DownloadCache::Adopt).
+	So temporary files like CIAs and archives never exist twice. Only files, which stay at their destination, get copied back by DownloadCache::Settle.
+*/
+namespace DownloadCache {
+	bool Enabled();
+	std::string Name(const std::string &URL, const std::string &sha256 = "");
+	bool Contains(const std::string &URL, const std::string &sha256);
+	Validators Lookup(const std::string &URL);
+	bool Restore(const std::string &URL, const std::string &sha256, const std::string &path);
+	void Store(const std::string &URL, const std::string &sha256, const std::string &etag, const std::string &lastModified, const std::string &path);
+	bool Adopt(const std::string &path);
+	void Settle();
+};
+
+#endif
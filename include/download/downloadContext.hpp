@@ -0,0 +1,197 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_DOWNLOAD_CONTEXT_HPP
+#define _UNIVERSAL_UPDATER_DOWNLOAD_CONTEXT_HPP
+
+#include "bufferPool.hpp"
+#include "retryPolicy.hpp"
+#include "scheduler.hpp"
+#include "segmentHasher.hpp"
+#include "telemetry.hpp"
+#include "validatorCache.hpp"
+#include <3ds.h>
+#include <curl/curl.h>
+#include <functional>
+#include <mbedtls/sha256.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define RING_BUFFERS 4 // Default amount of buffers between the network and the SD card.
+
+enum class TransferState {
+	Pending,
+	Running,
+	Done,
+	Failed,
+	Canceled
+};
+
+/* What a sink did with received data. */
+enum class SinkResult {
+	Accepted,
+	Full, // Not taken, the transfer pauses until SinkDrained() gets called.
+	Failed
+};
+
+/*
+	Everything a single download needs: the CURL handle, the output, the buffers and commit thread and the progress.
+	If path is empty, the data is kept in RAM, else it gets written to path.
+
+	A context can be performed blocking through Perform() or handed to the DownloadEngine.
+	With rangeEnd set, it only fetches that segment into the existing file at path, at its offset.
+	Transient failures are retried after a backoff according to retry, failing over to the mirrors, if any.
+	While more urgent transfers run, it pauses at the next chunk according to its priority.
+*/
+class DownloadContext {
+public:
+	DownloadContext(const std::string &url, const std::string &path = "");
+	~DownloadContext() { this->Cleanup(); mbedtls_sha256_free(&this->shaContext); BufferPool::Release(std::move(this->data)); };
+
+	Result Setup(CURL *hnd);
+	Result Finish(CURLcode res);
+	bool Finishing() const { return this->finishing; }; // Handed to the commit thread by Finish(). Only call from the thread, which drives the transfer.
+	bool Finalized();
+	Result Conclude();
+	Result Perform();
+	void CollectStats();
+	void Resume();
+	void Wakeup();
+	void SinkDrained();
+	bool VerifyFile(const std::string &file);
+	static bool HasJournal(const std::string &path);
+
+	std::string GetString() const { return std::string(this->data.begin(), this->data.end()); };
+
+	bool Segment() const { return this->rangeEnd >= 0; };
+
+	/* If the server answered a conditional request with 304. The data is empty then. */
+	bool NotModified() const { return this->status == 304; };
+	void SaveValidators(const std::string &file);
+
+	std::string url = "", path = "";
+	std::vector<u8> data; // The received data for RAM downloads.
+	curl_off_t total = 0, now = 0, speed = 0;
+	CURLcode result = CURLE_OK;
+	TransferState state = TransferState::Pending;
+	bool canceled = false;
+	bool reportProgress = false; // Mirror the progress to the global progress display.
+	bool conditional = false; // Send the cached validators with the request. File downloads only send revalidate.
+	Validators revalidate; // Sent instead of the cached validators, if set.
+	bool resumable = false; // Keep a journal and a part file, so failed file downloads can continue.
+	std::string sha256 = "", crc32 = ""; // Expected checksums of file downloads as hex. Empty to skip.
+	long status = 0; // The HTTP status code of the last response.
+	bool headOnly = false; // Only ask for the headers, e.g. to find out, if ranges are supported.
+	bool acceptRanges = false; // If the last response advertised byte ranges.
+	curl_off_t length = -1; // The Content-Length of the last response.
+	curl_off_t rangeStart = 0, rangeEnd = -1; // The segment of the file to fetch. (Inclusive, -1 for everything)
+	std::shared_ptr<SegmentHasher> hasher = nullptr; // Hashes the whole file, the segment belongs to, as it commits.
+	std::string etag = "", lastModified = ""; // The validators of the last response.
+	std::function<void(DownloadContext &)> callback = nullptr; // Called once finished.
+	std::function<SinkResult(const char *, size_t)> sink = nullptr; // Receives the data of RAM downloads instead of data, if set.
+	std::vector<std::string> mirrors; // Other URLs of the same file. url gets switched to the one in use.
+	RetryPolicy retry;
+	TransferPriority priority = TransferPriority::Metadata;
+	u64 retryAt = 0; // osGetTime() from when on the next attempt may start, while the state is Pending again.
+
+	/*
+		The ring between the network and the commit thread.
+		Once all buffers are queued, the network side pauses until the SD card drained the ring to lowWatermark.
+	*/
+	u8 ringBuffers = RING_BUFFERS, lowWatermark = RING_BUFFERS / 2;
+	u32 stalls = 0; // How often the network side had to wait for the SD card.
+	u64 stallTime = 0; // How long it waited in total, in ms.
+	u8 peakQueued = 0; // The most buffers, which were queued at once.
+	TransferStats stats; // The telemetry of the last attempt.
+
+	CURL *hnd = nullptr;
+	CURLM *multi = nullptr; // The multi handle of the DownloadEngine, while it drives the transfer.
+	LightEvent finished;
+private:
+	static size_t WriteFile(char *ptr, size_t size, size_t nmemb, void *userdata);
+	static size_t WriteMemory(char *ptr, size_t size, size_t nmemb, void *userdata);
+	static size_t WriteSink(char *ptr, size_t size, size_t nmemb, void *userdata);
+	static size_t HeaderData(char *buffer, size_t size, size_t nitems, void *userdata);
+	static int Progress(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+	static void CommitThread(void *arg);
+
+	bool Commit(const char *buffer, size_t size);
+	bool QueueBuffer(bool more = true);
+	bool RingFits(size_t size);
+	bool RingDrained() const;
+	void DrainRing();
+	void Cleanup();
+	Result Finalize(bool drain);
+	bool ScheduleRetry(Result ret);
+	bool Yield();
+
+	std::string RangeValidator() const;
+	curl_off_t LoadJournal();
+	void WriteJournal();
+	void RemoveJournal();
+
+	void ResetChecksums();
+	void UpdateChecksums(const char *buffer, size_t size);
+	bool VerifyChecksums();
+	bool HashFile(const std::string &file, curl_off_t size);
+
+	FILE *out = nullptr;
+	std::string outPath = "";
+	curl_off_t resumeFrom = 0, committed = 0;
+	curl_off_t journaled = 0; // What the journal claims to be committed.
+	u64 journaledAt = 0; // When the journal got written the last time.
+	u64 reservation = 0; // Space on the SD card, which is reserved for the rest of the file.
+	bool preallocated = false; // The file got extended to its full size before the first write.
+	u32 attempts = 0, failures = 0;
+	bool restarted = false; // Started over from zero, after the server refused to continue the part file.
+	u32 retryAfter = 0; // What the server asked for through Retry-After, in ms.
+	std::vector<std::string> candidates, tried; // The URL with its mirrors and the ones of them, which failed.
+	bool scheduled = false, paused = false;
+	u64 pausedAt = 0, resumedAt = 0;
+	bool ringPaused = false; // Paused, until the commit thread drained the ring.
+	bool sinkPaused = false, sinkDrained = false; // Paused, until the consumer of the sink took enough data.
+	u64 stalledAt = 0; // When it paused for the ring or the sink.
+	size_t ringWanted = 0; // The size of the held back chunk.
+	u64 sampleTime = 0; // Start of the current throughput sample.
+	curl_off_t sampleBytes = 0;
+	mbedtls_sha256_context shaContext;
+	u32 crcState = 0;
+	curl_slist *headers = nullptr;
+	std::vector<char *> ring;
+	std::vector<size_t> ringSizes;
+	u8 ringHead = 0, ringTail = 0, ringQueued = 0;
+	size_t bufferPos = 0, chunkSize = 0, ringBytes = 0; // The size of a ring buffer and of all together.
+	LightLock ringLock;
+	CondVar ringFilled, ringDrained;
+	Thread commitThread = nullptr;
+	bool killThread = false, writeError = false;
+	bool finishing = false, finishKeep = false; // Handed over by Finish(), keeping the rest of the data or not.
+	bool finalized = false, finishCanceled = false; // Set by Finalize().
+	Result finishRet = 0; // The result of Finalize().
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_DOWNLOAD_DEFS_HPP
+#define _UNIVERSAL_UPDATER_DOWNLOAD_DEFS_HPP
+
+#define APP_TITLE "Universal-Updater"
+#define VERSION_STRING "3.0.0"
+#define USER_AGENT APP_TITLE "-" VERSION_STRING
+
+/*
+	The servers, Universal-Updater talks to.
+	Building with STANDIN=http://host:port points all of them to a local stand-in server, which serves them below their hostname,
+	so the downloads, update checks and release resolution can be tried against fixtures, slow links and failing servers.
+*/
+#ifdef STANDIN_HOST
+	#define GITHUB_URL STANDIN_HOST "/github.com"
+	#define GITHUB_API_URL STANDIN_HOST "/api.github.com"
+	#define UNIVERSAL_DB_URL STANDIN_HOST "/db.universal-team.net"
+#else
+	#define GITHUB_URL "https://github.com"
+	#define GITHUB_API_URL "https://api.github.com"
+	#define UNIVERSAL_DB_URL "https://db.universal-team.net"
+#endif
+
+enum DownloadError {
+	DL_ERROR_NONE = 0,
+	DL_ERROR_WRITEFILE,
+	DL_ERROR_ALLOC,
+	DL_ERROR_STATUSCODE,
+	DL_ERROR_GIT,
+	DL_CANCEL, // No clue if that's needed tho.
+	DL_ERROR_CHECKSUM
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_RETRY_POLICY_HPP
+#define _UNIVERSAL_UPDATER_RETRY_POLICY_HPP
+
+#include <3ds.h>
+#include <curl/curl.h>
+#include <string>
+#include <vector>
+
+#define RETRY_ATTEMPTS 3 // Attempts per download, not counting the mirrors.
+#define RETRY_BASE_DELAY 500 // Milliseconds before the first retry, doubled with every further one.
+#define RETRY_MAX_DELAY 8000
+#define MIRROR_PENALTY 60000 // How long a failed mirror is only used as the last resort, in ms.
+
+/*
+	When and how often a failed download is tried again.
+	Only transient failures are retried: timeouts, dropped connections and overloaded servers.
+*/
+struct RetryPolicy {
+	u8 MaxAttempts = RETRY_ATTEMPTS;
+	u32 BaseDelay = RETRY_BASE_DELAY, MaxDelay = RETRY_MAX_DELAY;
+
+	bool Retryable(CURLcode res, long status) const;
+	u32 Delay(u32 attempt, u32 retryAfter = 0) const;
+};
+
+/*
+	Remembers how the hosts of mirrored downloads performed, so the fastest one, which still answers, is used first.
+*/
+namespace MirrorStats {
+	void Record(const std::string &url, bool ok, curl_off_t speed);
+	std::string Pick(const std::vector<std::string> &candidates, const std::vector<std::string> &tried);
+};
+
+#endif
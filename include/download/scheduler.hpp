@@ -0,0 +1,55 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_SCHEDULER_HPP
+#define _UNIVERSAL_UPDATER_SCHEDULER_HPP
+
+#include <3ds.h>
+
+#define SCHEDULER_MAX_PAUSE 2000 // How long a transfer yields at once at most, in ms.
+#define SCHEDULER_SHARE 500 // How long it runs then at least, before it yields again, in ms.
+#define PREFETCH_DELAY 500 // How long an entry has to stay selected, before its downloads get prepared, in ms.
+#define PREFETCH_MAX 6 // Speculative transfers per entry at most.
+
+/* The traffic classes, most urgent first. */
+enum class TransferPriority {
+	Interactive, // Something the user is looking at right now, like screenshots.
+	Metadata, // UniStores, sprite sheets and release informations.
+	Bulk, // Downloads of the queue.
+	Speculative // Prefetches, which may turn out to be useless.
+};
+
+/*
+	Keeps track of the running transfers per priority, so less urgent ones can pause, while more urgent ones run.
+	The pausing itself happens in the DownloadContext at chunk boundaries.
+*/
+namespace Scheduler {
+	void Begin(TransferPriority priority);
+	void End(TransferPriority priority);
+	bool ShouldYield(TransferPriority priority);
+};
+
+#endif
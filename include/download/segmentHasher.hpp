@@ -0,0 +1,72 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_SEGMENT_HASHER_HPP
+#define _UNIVERSAL_UPDATER_SEGMENT_HASHER_HPP
+
+#include <3ds.h>
+#include <curl/curl.h>
+#include <mbedtls/sha256.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*
+	Hashes a file, which gets downloaded in segments, in order while the segments commit.
+	Data at the hashed position is taken straight from the commit. Only what a segment committed, before the position reached it, has to be read back from the file.
+*/
+class SegmentHasher {
+public:
+	SegmentHasher(const std::string &path, const std::string &sha256, const std::string &crc32);
+	~SegmentHasher() { mbedtls_sha256_free(&this->shaContext); };
+
+	void Add(curl_off_t start, curl_off_t end);
+	void Committed(curl_off_t start, curl_off_t offset, const char *buffer, size_t size, FILE *out);
+	void Finished(curl_off_t start);
+	bool Verify();
+
+	curl_off_t ReadBack = 0; // How much had to be read back from the file.
+private:
+	struct Range {
+		curl_off_t Start, End; // Inclusive.
+		bool Finished;
+	};
+
+	Range *Find(curl_off_t start);
+	void Update(const char *buffer, size_t size);
+	void HashFile(curl_off_t end);
+	void Advance();
+
+	std::string path, sha256, crc32;
+	std::vector<Range> segments;
+	curl_off_t hashed = 0; // Everything before got hashed.
+	bool failed = false; // Reading back failed, so the checksums can't be trusted.
+	mbedtls_sha256_context shaContext;
+	u32 crcState = 0;
+	LightLock lock = 1; // Unlocked.
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_TELEMETRY_HPP
+#define _UNIVERSAL_UPDATER_TELEMETRY_HPP
+
+#include <3ds.h>
+#include <curl/curl.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#define TELEMETRY_LOG_PATH "sdmc:/3ds/Universal-Updater/transfers.log"
+#define TELEMETRY_LOG_SIZE 0x10000 // Rotate the log once it grew bigger than 64 KiB.
+#define TELEMETRY_HISTORY 32 // How many transfers are kept for the diagnostics screen.
+#define TELEMETRY_PENDING 128 // How many transfers wait for the log at most.
+
+/* What a single transfer spent its time on. */
+struct TransferStats {
+	std::string URL = "";
+	CURLcode Result = CURLE_OK;
+	long Status = 0; // The HTTP status code.
+	u32 DNS = 0, Connect = 0, TLS = 0, TTFB = 0, Total = 0; // Milliseconds since the start of the transfer.
+	curl_off_t AvgSpeed = 0, PeakSpeed = 0; // Bytes per second.
+	curl_off_t Bytes = 0; // Received from the network.
+	curl_off_t Written = 0; // Written to the SD card.
+	long Redirects = 0;
+	u32 Retries = 0, Stalls = 0;
+	u64 StallTime = 0; // Milliseconds the network waited for the SD card.
+	time_t Time = 0; // When it finished.
+};
+
+/*
+	Keeps the stats of the last transfers and writes them to a rolling log on the SD card,
+	so slow installs can be tracked down to the network, the TLS handshake or the SD card.
+*/
+namespace Telemetry {
+	void Record(const TransferStats &stats);
+	void Flush();
+	std::vector<TransferStats> History();
+};
+
+#endif
@@ -0,0 +1,52 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_VALIDATOR_CACHE_HPP
+#define _UNIVERSAL_UPDATER_VALIDATOR_CACHE_HPP
+
+#include <string>
+
+#define _VALIDATOR_CACHE_PATH "sdmc:/3ds/Universal-Updater/validators.json"
+
+struct Validators {
+	std::string ETag = "";
+	std::string LastModified = "";
+	std::string File = ""; // The local copy, the validators belong to.
+	size_t Size = 0;
+};
+
+/*
+	Keeps the HTTP validators (ETag, Last-Modified) per URL, so unchanged files can be answered with 304.
+	Changes are written in batches, so ValidatorCache::Flush has to be called before exiting.
+*/
+namespace ValidatorCache {
+	Validators Get(const std::string &URL);
+	void Set(const std::string &URL, const Validators &validators);
+	void Remove(const std::string &URL);
+	void Flush();
+};
+
+#endif
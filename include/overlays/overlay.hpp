@@ -34,6 +34,7 @@ namespace Overlays {
 	void SelectStore();
 	void SelectLanguage();
 	void ShowCredits();
+	void ShowDiagnostics();
 	std::string SelectDir(const std::string &oldDir, const std::string &msg);
 	void SelectTheme();
 };
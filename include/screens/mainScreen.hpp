@@ -61,6 +61,10 @@ private:
 
 	SortType sorttype = SortType::LAST_UPDATED;
 
+	/* The selected entry and when it got selected, for the prefetch. */
+	const StoreEntry *selectedEntry = nullptr, *prefetchedEntry = nullptr;
+	u64 selectedAt = 0;
+
 	/* Title, Author, Category, Console. */
 	std::vector<bool> searchIncludes = { false, false, false, false }, installs = { };
 	std::string searchResult = "", screenshotName = "";
@@ -42,6 +42,7 @@ enum favoriteMarks {
 class Meta {
 public:
 	Meta();
+	Meta(const std::string &file);
 	~Meta() { this->SaveCall(); };
 
 	std::string GetUpdated(const std::string &unistoreName, const std::string &entry) const;
@@ -95,6 +96,7 @@ public:
 	void SaveCall();
 private:
 	nlohmann::json metadataJson = nullptr;
+	std::string file = "";
 };
 
 #endif
\ No newline at end of file
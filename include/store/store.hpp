@@ -28,17 +28,14 @@
 #define _UNIVERSAL_UPDATER_STORE_HPP
 
 #include "json.hpp"
-#include <citro2d.h>
+#include "storeDefs.hpp"
 #include <string>
+#include <vector>
 
 class Store {
 public:
-	Store(const std::string &file, const std::string &file2, bool ARGMode = false);
-	~Store();
+	Store(const std::string &file, const std::string &file2);
 	void LoadFromFile(const std::string &file);
-	void loadSheets();
-	void unloadSheets();
-	void update(const std::string &file);
 
 	/* Get Information of the UniStore itself. */
 	std::string GetUniStoreTitle() const;
@@ -53,7 +50,7 @@ public:
 	std::vector<std::string> GetConsoleEntry(int index) const;
 	std::string GetLastUpdatedEntry(int index) const;
 	std::string GetLicenseEntry(int index) const;
-	C2D_Image GetIconEntry(int index) const;
+	StoreImage GetIconEntry(int index) const;
 	std::string GetFileSizes(int index, const std::string &entry) const;
 	std::vector<std::string> GetScreenshotList(int index) const;
 	std::vector<std::string> GetScreenshotNames(int index) const;
@@ -81,18 +78,15 @@ public:
 	nlohmann::json &GetJson() { return this->storeJson; };
 	bool GetValid() const { return this->valid; };
 
-	/* Both of these things are used for custom BG support. */
-	C2D_Image GetStoreImg() const { return this->storeBG; };
-	bool customBG() const { return this->hasCustomBG; };
+	/* The SpriteSheet files and the custom BG on them, which StoreSheets loads. */
+	std::vector<std::string> GetSheets() const;
+	StoreImage GetBGEntry() const;
 
 	/* Return filename of the UniStore. */
 	std::string GetFileName() const { return this->fileName; };
 private:
-	void SetC2DBGImage();
 	nlohmann::json storeJson = nullptr;
-	std::vector<C2D_SpriteSheet> sheets;
-	C2D_Image storeBG = { nullptr };
-	bool valid = false, hasSheet = false, hasCustomBG = false;
+	bool valid = false;
 	int screenIndex = 0, entry = 0, box = 0, downEntry = 0, downIndex = 0;
 	std::string fileName = "";
 };
@@ -45,7 +45,7 @@ public:
 	std::string GetLicense() const { return this->License; };
 	int GetMarks() const { return this->Marks; };
 
-	C2D_Image GetIcon() const { return this->Icon; };
+	StoreImage GetIcon() const { return this->Icon; };
 
 	int GetSheetIndex() const { return this->SheetIndex; };
 	int GetEntryIndex() const { return this->EntryIndex; };
@@ -67,7 +67,7 @@ public:
 
 private:
 	std::string Title, Author, Description, Category, Version, Console, LastUpdated, License, MarkString, ReleaseNotes;
-	C2D_Image Icon;
+	StoreImage Icon;
 	int SheetIndex, EntryIndex, Marks;
 	std::vector<std::string> FullCategory, FullConsole, Sizes, Screenshots, ScreenshotNames;
 	bool UpdateAvailable;
@@ -54,6 +54,7 @@ namespace StoreUtils {
 	/* Entry Info. */
 	void DrawEntryInfo(const std::unique_ptr<StoreEntry> &entry);
 	void EntryHandle(bool &showMark, bool &fetch, bool &sFetch, int &mode, const std::unique_ptr<StoreEntry> &entry);
+	void Prefetch(const std::unique_ptr<StoreEntry> &entry);
 
 	/* Side Menu. */
 	void DrawSideMenu(int currentMenu);
@@ -78,10 +79,6 @@ namespace StoreUtils {
 	/* Credits. */
 	void DrawCredits();
 
-	/* Screenshot menu. */
-	void DrawScreenshotMenu(const C2D_Image &img, const int sIndex, const bool sFetch, const int screenshotSize, const std::string &name, const int zoom, const bool canDisplay);
-	void ScreenshotMenu(C2D_Image &img, int &sIndex, bool &sFetch, int &storeMode, const int screenshotSize, int &zoom, bool &canDisplay);
-
 	/* Settings. */
 	void DrawSettings(int page, int selection, int sPos);
 	void SettingsHandle(int &page, bool &dspSettings, int &storeMode, int &selection, int &sPos);
@@ -107,10 +104,12 @@ namespace StoreUtils {
 
 	void search(const std::string &query, bool title, bool author, bool category, bool console, int selectedMarks, bool updateAvl, bool isAND);
 
+	void LoadStore(const std::string &file, const std::string &fileName);
 	void ResetAll();
 
 	void RefreshUpdateAVL();
 
+	nlohmann::json GetScript(int index, const std::string &entry);
 	void AddToQueue(int index, const std::string &entry, const std::string &entryName, const std::string &lUpdated);
 	void AddAllToQueue();
 };
@@ -27,16 +27,10 @@
 #ifndef _UNIVERSAL_UPDATER_ANIMATION_HPP
 #define _UNIVERSAL_UPDATER_ANIMATION_HPP
 
+#include "platform.hpp"
 #include <3ds.h>
 #include <string>
 
-enum class ProgressBar {
-	Downloading,
-	Extracting,
-	Installing,
-	Copying
-};
-
 namespace Animation {
 	extern int DisplayY, DisplayDelay;
 	extern bool MoveUp, DoDelay;
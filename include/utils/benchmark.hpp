@@ -0,0 +1,67 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_BENCHMARK_HPP
+#define _UNIVERSAL_UPDATER_BENCHMARK_HPP
+
+#include "json.hpp"
+#include "storeUtils.hpp"
+#include <stdio.h>
+#include <string>
+
+#define BENCHMARK_PATH "sdmc:/3ds/Universal-Updater/benchmark/"
+#define BENCHMARK_LOG_PATH "sdmc:/3ds/Universal-Updater/benchmark.jsonl" // One JSON object per line.
+
+/*
+	Generated UniStores of different sizes, to measure how the store handling scales.
+	Only built with 'make BENCHMARK=1', which runs it on start.
+	The generator, the operations and the log format are also part of the host build, which measures the same UniStores on a PC. ('make bench' in host)
+*/
+namespace Benchmark {
+	inline const int Sizes[] = { 100, 1000, 10000, 100000 }; // The entries of the generated UniStores.
+
+	struct SortOp { const char *op; SortType type; };
+	struct SearchOp { const char *op, *query; bool title, author, category, console; int marks; bool updateAvl, isAND; };
+
+	inline const SortOp Sorts[] = {
+		{ "SortEntries.title", SortType::TITLE },
+		{ "SortEntries.author", SortType::AUTHOR },
+		{ "SortEntries.updated", SortType::LAST_UPDATED }
+	};
+
+	inline const SearchOp Searches[] = {
+		{ "search.title", "super", true, false, false, false, 0, false, false },
+		{ "search.all", "a", true, true, true, true, 0, false, false },
+		{ "search.category", "emulator", false, false, true, false, 0, false, false },
+		{ "search.marks", "", false, false, false, false, STAR, true, true }
+	};
+
+	void Generate(int entries, const std::string &file, const std::string &metaFile);
+	void Write(FILE *log, const char *version, const char *op, int entries, const nlohmann::json &result);
+	void Run();
+};
+
+#endif
@@ -27,14 +27,15 @@
 #ifndef _UNIVERSAL_UPDATER_CIA_HPP
 #define _UNIVERSAL_UPDATER_CIA_HPP
 
-#include "common.hpp"
-
 #include <3ds.h>
 
+class ArchiveStream;
+
 namespace Title {
 	Result Launch(u64 titleId, FS_MediaType mediaType);
 	Result DeletePrevious(u64 titleid, FS_MediaType media);
 	Result Install(const char *ciaPath, bool updateSelf);
+	Result InstallStream(ArchiveStream &stream, bool updateSelf, bool &staged);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifndef _UNIVERSAL_UPDATER_CIA_STREAM_HPP
+#define _UNIVERSAL_UPDATER_CIA_STREAM_HPP
+
+#include "archiveStream.hpp"
+#include <3ds.h>
+#include <functional>
+#include <vector>
+
+/*
+	Where a streamed CIA gets installed to.
+	Title::InstallStream() uses AM, the host tests a fake one.
+	DeletePrevious is optional, like for the file based install, which keeps the title, when Universal-Updater updates itself.
+*/
+struct CiaInstaller {
+	std::function<Result(u64 titleID, FS_MediaType media)> DeletePrevious;
+	std::function<Result(FS_MediaType media, Handle *handle)> Start;
+	std::function<Result(Handle handle, u64 offset, const void *data, u32 size)> Write;
+	std::function<Result(Handle handle)> Finish;
+	std::function<Result(Handle handle)> Cancel;
+};
+
+namespace CiaStream {
+	u64 TitleID(const std::vector<u8> &data, bool &invalid);
+	u64 Size(const std::vector<u8> &data);
+	FS_MediaType Destination(u64 titleID);
+	Result Install(ArchiveStream &stream, const CiaInstaller &installer, u64 &titleID, bool &staged);
+};
+
+#endif
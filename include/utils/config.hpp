@@ -30,6 +30,7 @@
 #include "json.hpp"
 
 #include <3ds.h>
+#include <memory>
 #include <string>
 
 class Config {
@@ -101,6 +102,26 @@ public:
 	/* If showing prompt if action failed / succeeded. */
 	bool prompt() const { return this->v_prompt; };
 	void prompt(bool v) { this->v_prompt = v; if (!this->changesMade) this->changesMade = true; };
+
+	/* If keeping downloaded files for reinstalls. */
+	bool downloadCache() const { return this->v_downloadCache; };
+	void downloadCache(bool v) { this->v_downloadCache = v; if (!this->changesMade) this->changesMade = true; };
+
+	/* The size limit of the download cache in MiB. */
+	int cacheQuota() const { return this->v_cacheQuota; };
+	void cacheQuota(int v) { this->v_cacheQuota = v; if (!this->changesMade) this->changesMade = true; };
+
+	/* If preparing the downloads of the selected entry ahead. */
+	bool prefetch() const { return this->v_prefetch; };
+	void prefetch(bool v) { this->v_prefetch = v; if (!this->changesMade) this->changesMade = true; };
+
+	/* If also fetching the first screenshot of the selected entry ahead. */
+	bool prefetchScreenshots() const { return this->v_prefetchScreenshots; };
+	void prefetchScreenshots(bool v) { this->v_prefetchScreenshots = v; if (!this->changesMade) this->changesMade = true; };
+
+	/* The memory limit for the buffers of all running downloads in KiB. */
+	int bufferCeiling() const { return this->v_bufferCeiling; };
+	void bufferCeiling(int v) { this->v_bufferCeiling = v; if (!this->changesMade) this->changesMade = true; };
 private:
 	/* Mainly helper. */
 	bool getBool(const std::string &key);
@@ -118,7 +139,12 @@ private:
 				v_shortcutPath = "sdmc:/3ds/Universal-Updater/shortcuts", v_firmPath = "sdmc:/luma/payloads", v_theme = "Default";
 
 	bool v_list = false, v_autoUpdate = true, v_metadata = true, v_updateCheck = true,
-		v_showBg = false, v_customFont = false, v_changelog = true, v_prompt = true, v_3dsxInFolder = false;
+		v_showBg = false, v_customFont = false, v_changelog = true, v_prompt = true, v_3dsxInFolder = false, v_downloadCache = false,
+		v_prefetch = false, v_prefetchScreenshots = false; // Prefetching costs traffic and API quota for entries, which may never be downloaded.
+
+	int v_cacheQuota = 256, v_bufferCeiling = 4096;
 };
 
+inline std::unique_ptr<Config> config;
+
 #endif
@@ -27,19 +27,12 @@
 #ifndef _UNIVERSAL_UPDATER_DOWNLOAD_HPP
 #define _UNIVERSAL_UPDATER_DOWNLOAD_HPP
 
-#include "common.hpp"
+#include "downloadDefs.hpp"
+#include <3ds.h>
+#include <string>
+#include <vector>
 
-#define APP_TITLE "Universal-Updater"
-#define VERSION_STRING "3.0.0"
-
-enum DownloadError {
-	DL_ERROR_NONE = 0,
-	DL_ERROR_WRITEFILE,
-	DL_ERROR_ALLOC,
-	DL_ERROR_STATUSCODE,
-	DL_ERROR_GIT,
-	DL_CANCEL, // No clue if that's needed tho.
-};
+#define _SCREENSHOT_CACHE_PATH "sdmc:/3ds/Universal-Updater/screenshots/"
 
 struct StoreList {
 	std::string Title;
@@ -48,14 +41,25 @@ struct StoreList {
 	std::string Description;
 };
 
+/* A file download with its optional checksums and mirrors. */
+struct FileDownload {
+	std::string URL;
+	std::string Output;
+	std::string SHA256 = "";
+	std::string CRC32 = "";
+	std::vector<std::string> Mirrors = { };
+};
+
 struct UUUpdate {
 	bool Available = false;
 	std::string Notes = "";
 	std::string Version = "";
 };
 
-Result downloadToFile(const std::string &url, const std::string &path);
-Result downloadFromRelease(const std::string &url, const std::string &asset, const std::string &path, bool includePrereleases);
+Result downloadToFile(const std::string &url, const std::string &path, const std::string &sha256 = "", const std::string &crc32 = "", const std::vector<std::string> &mirrors = { });
+Result downloadToFiles(const std::vector<FileDownload> &files);
+Result getReleaseAssetURL(const std::string &url, const std::string &asset, bool includePrereleases, std::string &assetUrl);
+Result downloadFromRelease(const std::string &url, const std::string &asset, const std::string &path, bool includePrereleases, const std::string &sha256 = "", const std::string &crc32 = "");
 
 /*
 	Check Wi-Fi status.
@@ -79,12 +83,19 @@ void notImplemented(void);
 void doneMsg(void);
 
 bool IsUpdateAvailable(const std::string &URL, int revCurrent);
-bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, bool isDownload = false, bool isUDB = false);
+bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, bool isDownload = false, bool isUDB = false, const std::vector<std::string> &mirrors = { });
 bool DownloadSpriteSheet(const std::string &URL, const std::string &file);
+void DownloadSpriteSheets(const std::vector<std::string> &URLs, const std::vector<std::string> &files, const std::string &msg);
 UUUpdate IsUUUpdateAvailable();
 void UpdateAction();
 std::vector<StoreList> FetchStores();
-C2D_Image FetchScreenshot(const std::string &URL);
+bool FetchScreenshotData(const std::string &URL, std::vector<u8> &data);
+
+/* Speculative work for the selected entry, so its downloads start right away. */
+void PrefetchConnection(const std::string &URL);
+void PrefetchRelease(const std::string &url, const std::string &asset, bool includePrereleases);
+void PrefetchScreenshot(const std::string &URL);
+void CancelPrefetches();
 std::string GetChangelog();
 
 #endif
\ No newline at end of file
@@ -27,7 +27,9 @@
 #ifndef _UNIVERSAL_UPDATER_EXTRACT_HPP
 #define _UNIVERSAL_UPDATER_EXTRACT_HPP
 
-#include "common.hpp"
+#include "archiveStream.hpp"
+#include <3ds.h>
+#include <string>
 
 enum ExtractError {
 	EXTRACT_ERROR_NONE = 0,
@@ -43,4 +45,7 @@ Result getExtractedSize(const std::string &archivePath, const std::string &wante
 
 Result extractArchive(const std::string &archivePath, const std::string &wantedFile, const std::string &outputPath);
 
+bool isStreamableArchive(const std::string &archivePath);
+Result extractStream(ArchiveStream &stream, const std::string &wantedFile, const std::string &outputPath);
+
 #endif
\ No newline at end of file
@@ -27,7 +27,7 @@
 #ifndef _UNIVERSAL_UPDATER_FILES_HPP
 #define _UNIVERSAL_UPDATER_FILES_HPP
 
-#include "common.hpp"
+#include <3ds.h>
 
 Result makeDirs(const char *path);
 Result openFile(Handle *fileHandle, const char *path, bool write);
@@ -36,4 +36,16 @@ Result removeDir(const char *path);
 Result removeDirRecursive(const char *path);
 u64 getAvailableSpace();
 
+/*
+	Free space accounting for the SD card.
+	The filesystem gets only queried on Sync, everything written in between gets tracked through reservations and commits.
+*/
+namespace FreeSpace {
+	void Sync();
+	u64 Available();
+	bool Reserve(u64 size, u64 &reservation);
+	void Commit(u64 size, u64 &reservation);
+	void Release(u64 &reservation);
+};
+
 #endif
\ No newline at end of file
@@ -28,7 +28,8 @@
 #define _UNIVERSAL_UPDATER_QUEUE_SYSTEM_HPP
 
 #include "json.hpp"
-#include <citro2d.h>
+#include "storeDefs.hpp"
+#include <3ds.h>
 #include <deque>
 #include <memory>
 
@@ -42,6 +43,7 @@ enum class QueueStatus {
 	Installing,
 	Moving,
 	Request, // For User needed Requests.
+	Deferred, // Needs the network, while there is no Wi-Fi.
 	Failed,
 	Done
 };
@@ -62,21 +64,23 @@ namespace QueueSystem {
 	extern bool Wait, Popup, CancelCallback;
 
 	void QueueHandle(); // Handles the Queue.
-	void AddToQueue(nlohmann::json obj, const C2D_Image &icn, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated); // Adds to Queue.
+	void AddToQueue(nlohmann::json obj, const StoreImage &icn, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated, u64 size = 0); // Adds to Queue.
 	void ClearQueue(); // Clears the Queue.
 	void Resume();
+	void Wakeup(); // Ends the wait for Wi-Fi early.
 };
 
 class Queue {
 public:
-	Queue(nlohmann::json object, const C2D_Image &img, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated) :
-		obj(object), icn(img), total(object.size()), current(QueueSystem::LastElement), name(name), unistoreName(uName), entryName(eName), lastUpdated(lUpdated) { };
+	Queue(nlohmann::json object, const StoreImage &img, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated, u64 size = 0) :
+		obj(object), icn(img), total(object.size()), current(QueueSystem::LastElement), name(name), unistoreName(uName), entryName(eName), lastUpdated(lUpdated), size(size) { };
 
 	QueueStatus status = QueueStatus::None;
 	nlohmann::json obj;
-	C2D_Image icn;
+	StoreImage icn;
 	int total, current;
 	std::string name = "", unistoreName = "", entryName = "", lastUpdated = "";
+	u64 size = 0; // The size the entry needs on the SD card, if known.
 };
 
 #endif
\ No newline at end of file
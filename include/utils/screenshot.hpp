@@ -36,4 +36,12 @@ namespace Screenshot {
 	C2D_Image ConvertFromBuffer(const std::vector<u8> &buffer);
 };
 
+C2D_Image FetchScreenshot(const std::string &URL);
+
+namespace StoreUtils {
+	/* Screenshot menu. */
+	void DrawScreenshotMenu(const C2D_Image &img, const int sIndex, const bool sFetch, const int screenshotSize, const std::string &name, const int zoom, const bool canDisplay);
+	void ScreenshotMenu(C2D_Image &img, int &sIndex, bool &sFetch, int &storeMode, const int screenshotSize, int &zoom, bool &canDisplay);
+};
+
 #endif
\ No newline at end of file
@@ -27,9 +27,11 @@
 #ifndef _UNIVERSAL_UPDATER_SCRIPT_UTILS_HPP
 #define _UNIVERSAL_UPDATER_SCRIPT_UTILS_HPP
 
+#include "download.hpp"
 #include "json.hpp"
 #include <3ds.h>
 #include <string>
+#include <vector>
 
 enum ScriptState {
 	NONE = 0,
@@ -39,7 +41,8 @@ enum ScriptState {
 	COPY_ERROR,
 	MOVE_ERROR,
 	DELETE_ERROR,
-	EXTRACT_ERROR
+	EXTRACT_ERROR,
+	SPACE_ERROR
 };
 
 namespace ScriptUtils {
@@ -50,10 +53,13 @@ namespace ScriptUtils {
 	Result prompt(const std::string &message);
 	Result copyFile(const std::string &source, const std::string &destination, const std::string &message, bool isARG = false);
 	Result renameFile(const std::string &oldName, const std::string &newName, const std::string &message, bool isARG = false);
-	Result downloadRelease(const std::string &repo, const std::string &file, const std::string &output, bool includePrereleases, const std::string &message, bool isARG = false);
-	Result downloadFile(const std::string &file, const std::string &output, const std::string &message, bool isARG = false);
+	Result downloadRelease(const std::string &repo, const std::string &file, const std::string &output, bool includePrereleases, const std::string &message, bool isARG = false, const std::string &sha256 = "", const std::string &crc32 = "");
+	Result downloadFile(const std::string &file, const std::string &output, const std::string &message, bool isARG = false, const std::string &sha256 = "", const std::string &crc32 = "", const std::vector<std::string> &mirrors = { });
+	Result downloadFiles(const std::vector<FileDownload> &files, const std::string &message, bool isARG = false);
 	void installFile(const std::string &file, bool updatingSelf, const std::string &message, bool isARG = false);
 	Result extractFile(const std::string &file, const std::string &input, const std::string &output, const std::string &message, bool isARG = false);
+	Result downloadInstallFile(const std::string &file, const std::string &cia, bool updatingSelf, const std::string &message, bool isARG = false);
+	Result downloadExtractFile(const std::string &file, const std::string &archive, const std::string &input, const std::string &output, const std::string &message, bool isARG = false);
 
 	Result runFunctions(nlohmann::json storeJson, int selection, const std::string &entry);
 };
@@ -28,6 +28,7 @@
 #define _UNIVERSAL_UPDATER_STRING_UTILS_HPP
 
 #include "meta.hpp"
+#include <3ds.h>
 #include <string>
 #include <vector>
 
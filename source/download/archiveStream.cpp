@@ -0,0 +1,133 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "archiveStream.hpp"
+
+#include <algorithm>
+
+ArchiveStream::ArchiveStream() {
+	LightLock_Init(&this->lock);
+	CondVar_Init(&this->changed);
+}
+
+ArchiveStream::~ArchiveStream() {
+	for (std::vector<u8> &chunk : this->chunks) BufferPool::Release(std::move(chunk));
+	BufferPool::Release(std::move(this->current));
+}
+
+/*
+	Queue received data.
+	Returns SinkResult::Full, if too much is queued already and SinkResult::Failed, if the reading side gave up.
+
+	const char *data: The data.
+	size_t size: The size of the data.
+*/
+SinkResult ArchiveStream::Push(const char *data, size_t size) {
+	LightLock_Lock(&this->lock);
+
+	if (this->aborted || this->queued >= STREAM_QUEUE_SIZE) {
+		const bool aborted = this->aborted;
+		if (!aborted) this->refused = true;
+
+		LightLock_Unlock(&this->lock);
+		return aborted ? SinkResult::Failed : SinkResult::Full;
+	}
+
+	/* Fill up the last chunk, before starting a new one. */
+	if (this->chunks.empty() || this->chunks.back().size() + size > this->chunks.back().capacity()) {
+		this->chunks.push_back(BufferPool::Acquire(std::max(size, (size_t)STREAM_CHUNK_SIZE)));
+	}
+
+	this->chunks.back().insert(this->chunks.back().end(), (const u8 *)data, (const u8 *)data + size);
+	this->queued += size;
+
+	CondVar_Broadcast(&this->changed);
+	LightLock_Unlock(&this->lock);
+	return SinkResult::Accepted;
+}
+
+/*
+	Mark the end of the data.
+
+	bool failed: If the download failed.
+*/
+void ArchiveStream::Close(bool failed) {
+	LightLock_Lock(&this->lock);
+	this->closed = true;
+	this->failed = failed;
+	CondVar_Broadcast(&this->changed);
+	LightLock_Unlock(&this->lock);
+}
+
+/*
+	Stop reading, so a paused download fails at its next Push().
+*/
+void ArchiveStream::Abort() {
+	LightLock_Lock(&this->lock);
+	this->aborted = true;
+	CondVar_Broadcast(&this->changed);
+	this->NotifyDrained();
+	LightLock_Unlock(&this->lock);
+}
+
+/*
+	Let the writing side continue, if it waits for that. Has to be called with lock held.
+*/
+void ArchiveStream::NotifyDrained() {
+	if (!this->refused && !this->aborted) return;
+
+	this->refused = false;
+	if (this->drained) this->drained();
+}
+
+/*
+	Get the next chunk. It stays valid until the next call.
+	Returns the size of the chunk, 0 at the end and -1 if the download failed.
+
+	const void **buffer: Where to store the pointer to the chunk.
+*/
+ssize_t ArchiveStream::Read(const void **buffer) {
+	LightLock_Lock(&this->lock);
+	BufferPool::Release(std::move(this->current));
+
+	while (this->chunks.empty() && !this->closed) CondVar_Wait(&this->changed, &this->lock);
+
+	ssize_t size = this->failed ? -1 : 0;
+	if (!this->chunks.empty()) {
+		this->current = std::move(this->chunks.front());
+		this->chunks.pop_front();
+		this->queued -= this->current.size();
+		size = this->current.size();
+		*buffer = this->current.data();
+	}
+
+	/* Some headroom, so the download doesn't pause again for every single chunk. */
+	if (this->queued <= STREAM_QUEUE_SIZE / 2) this->NotifyDrained();
+
+	CondVar_Broadcast(&this->changed);
+	LightLock_Unlock(&this->lock);
+	return size;
+}
@@ -0,0 +1,118 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "bufferPool.hpp"
+
+#define POOL_PER_CLASS 2 // How many idle buffers each size class keeps.
+
+/* The size classes. Anything bigger is allocated as needed and not kept. */
+static const size_t sizeClasses[] = { 0x4000, 0x10000, 0x40000, 0x100000 };
+#define POOL_CLASSES (sizeof(sizeClasses) / sizeof(sizeClasses[0]))
+
+static std::vector<std::vector<u8>> idle[POOL_CLASSES];
+static LightLock poolLock = 1; // Unlocked.
+
+/*
+	Return the smallest size class, which fits the size. POOL_CLASSES if none does.
+
+	size_t size: The wanted size.
+*/
+static u8 getClass(size_t size) {
+	for (u8 i = 0; i < POOL_CLASSES; i++) {
+		if (size <= sizeClasses[i]) return i;
+	}
+
+	return POOL_CLASSES;
+}
+
+/*
+	Get an empty buffer, which can hold at least size bytes without reallocating.
+
+	size_t size: The expected size. 0 if unknown.
+*/
+std::vector<u8> BufferPool::Acquire(size_t size) {
+	std::vector<u8> buffer;
+	const u8 cls = getClass(size);
+
+	if (cls < POOL_CLASSES) {
+		LightLock_Lock(&poolLock);
+
+		/* Any idle buffer of this class or above fits. */
+		for (u8 i = cls; i < POOL_CLASSES; i++) {
+			if (!idle[i].empty()) {
+				buffer = std::move(idle[i].back());
+				idle[i].pop_back();
+				break;
+			}
+		}
+
+		LightLock_Unlock(&poolLock);
+	}
+
+	if (buffer.capacity() < size || buffer.capacity() == 0) buffer.reserve(cls < POOL_CLASSES ? sizeClasses[cls] : size);
+	return buffer;
+}
+
+/*
+	Give a buffer back to the pool.
+
+	std::vector<u8> &&buffer: The buffer. It is empty afterwards.
+*/
+void BufferPool::Release(std::vector<u8> &&buffer) {
+	if (buffer.capacity() == 0) return;
+
+	/* File it under the biggest class it fully covers. */
+	u8 cls = POOL_CLASSES;
+	for (u8 i = POOL_CLASSES; i > 0; i--) {
+		if (buffer.capacity() >= sizeClasses[i - 1]) {
+			cls = i - 1;
+			break;
+		}
+	}
+
+	/* Too small or way too big to be worth keeping. */
+	if (cls == POOL_CLASSES || buffer.capacity() > sizeClasses[POOL_CLASSES - 1] * 2) {
+		std::vector<u8>().swap(buffer);
+		return;
+	}
+
+	buffer.clear();
+
+	LightLock_Lock(&poolLock);
+	if (idle[cls].size() < POOL_PER_CLASS) idle[cls].push_back(std::move(buffer));
+	LightLock_Unlock(&poolLock);
+
+	std::vector<u8>().swap(buffer); // Free it, if the pool is full.
+}
+
+/*
+	Free all idle buffers.
+*/
+void BufferPool::Clear() {
+	LightLock_Lock(&poolLock);
+	for (u8 i = 0; i < POOL_CLASSES; i++) std::vector<std::vector<u8>>().swap(idle[i]);
+	LightLock_Unlock(&poolLock);
+}
@@ -0,0 +1,131 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "bufferTuner.hpp"
+#include "config.hpp"
+
+#include <algorithm>
+
+static curl_off_t networkRate = 0, sdRate = 0; // Bytes per second, 0 until measured.
+static size_t inUse = 0; // Bytes of all ring buffers, which are allocated right now.
+static LightLock tunerLock = 1; // Unlocked.
+
+/*
+	Blend a new sample into a running average, which follows changes within a few samples.
+
+	curl_off_t average: The current average. (0 if none yet)
+	curl_off_t sample: The new sample.
+*/
+static curl_off_t blend(curl_off_t average, curl_off_t sample) {
+	return average == 0 ? sample : (average * 3 + sample) / 4;
+}
+
+/*
+	Clamp a size to the range and round it down to whole pages, as the ring buffers are page aligned.
+
+	curl_off_t size: The size.
+	size_t min: The minimum.
+	size_t max: The maximum.
+*/
+static size_t clampSize(curl_off_t size, size_t min, size_t max) {
+	return std::min(std::max((size_t)std::max(size, (curl_off_t)0), min), max) & ~(size_t)0xFFF;
+}
+
+/*
+	Record a throughput sample of a transfer.
+
+	curl_off_t rate: The throughput in bytes per second.
+*/
+void BufferTuner::RecordThroughput(curl_off_t rate) {
+	if (rate <= 0) return;
+
+	LightLock_Lock(&tunerLock);
+	networkRate = blend(networkRate, rate);
+	LightLock_Unlock(&tunerLock);
+}
+
+/*
+	Record how long writing a buffer to the SD card took.
+
+	size_t size: The size of the buffer.
+	u64 ticks: The system ticks the write took.
+*/
+void BufferTuner::RecordCommit(size_t size, u64 ticks) {
+	if (size < TUNER_MIN_CHUNK || ticks == 0) return; // The last piece of a file says nothing about the card.
+
+	LightLock_Lock(&tunerLock);
+	sdRate = blend(sdRate, (curl_off_t)size * SYSCLOCK_ARM11 / ticks);
+	LightLock_Unlock(&tunerLock);
+}
+
+/*
+	Return the size for the ring buffers of a new transfer and account them against the memory ceiling.
+	Release the returned size times count, once the buffers are freed.
+
+	u8 count: The amount of ring buffers.
+*/
+size_t BufferTuner::Acquire(u8 count) {
+	LightLock_Lock(&tunerLock);
+
+	size_t chunk = TUNER_DEFAULT_CHUNK;
+	if (networkRate > 0) {
+		/* Enough for a while of the network, but at least, what the SD card writes efficiently. */
+		const curl_off_t target = std::max(networkRate * TUNER_CHUNK_WINDOW, sdRate * TUNER_COMMIT_WINDOW) / 1000;
+		chunk = clampSize(target, TUNER_MIN_CHUNK, TUNER_MAX_CHUNK);
+	}
+
+	const size_t ceiling = config ? (size_t)std::max(config->bufferCeiling(), 0) * 1024 : SIZE_MAX;
+	const size_t budget = ceiling > inUse ? (ceiling - inUse) / std::max(count, (u8)1) : 0;
+	chunk = clampSize(std::min(chunk, budget), TUNER_MIN_CHUNK, TUNER_MAX_CHUNK);
+
+	inUse += chunk * count;
+	LightLock_Unlock(&tunerLock);
+
+	return chunk;
+}
+
+/*
+	Give back ring buffers, which got freed.
+
+	size_t size: The size of all of them together.
+*/
+void BufferTuner::Release(size_t size) {
+	LightLock_Lock(&tunerLock);
+	inUse -= std::min(size, inUse);
+	LightLock_Unlock(&tunerLock);
+}
+
+/*
+	Return the size of the CURL receive buffer for a new transfer.
+*/
+long BufferTuner::CurlBufferSize() {
+	LightLock_Lock(&tunerLock);
+	const curl_off_t rate = networkRate;
+	LightLock_Unlock(&tunerLock);
+
+	if (rate == 0) return TUNER_DEFAULT_CURL_BUFFER;
+	return (long)clampSize(rate * TUNER_CURL_WINDOW / 1000, TUNER_MIN_CURL_BUFFER, TUNER_MAX_CURL_BUFFER);
+}
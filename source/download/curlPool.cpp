@@ -0,0 +1,156 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "curlPool.hpp"
+
+#include <malloc.h>
+
+#define SOC_BUFFER_SIZE 0x100000
+#define POOL_SIZE 4 // Idle handles kept around. More can be active at once, they just won't be cached.
+
+static u32 *socBuffer = nullptr;
+static bool curlReady = false; // curl_global_init ran, so Exit has to clean it up.
+static CURLSH *CurlShare = nullptr;
+static LightLock shareLocks[CURL_LOCK_DATA_LAST];
+
+static CURL *idleHandles[POOL_SIZE] = { nullptr };
+static int idleCount = 0;
+static LightLock poolLock;
+
+/* One lock per kind of shared data, so a DNS lookup doesn't wait for the connection cache and the other way around. */
+static void shareLock(CURL *hnd, curl_lock_data data, curl_lock_access access, void *userptr) {
+	(void)hnd; (void)access; (void)userptr;
+	LightLock_Lock(&shareLocks[data]);
+}
+
+static void shareUnlock(CURL *hnd, curl_lock_data data, void *userptr) {
+	(void)hnd; (void)userptr;
+	LightLock_Unlock(&shareLocks[data]);
+}
+
+/*
+	Initialize SOC, curl and the share object.
+	This must be called once before any download happens.
+*/
+Result CurlPool::Init() {
+	for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) LightLock_Init(&shareLocks[i]);
+	LightLock_Init(&poolLock); // Blocking downloads still use the pool, even if SOC failed.
+
+	socBuffer = (u32 *)memalign(0x1000, SOC_BUFFER_SIZE);
+	if (!socBuffer) return -1;
+
+	Result ret = socInit(socBuffer, SOC_BUFFER_SIZE);
+	if (R_FAILED(ret)) {
+		free(socBuffer);
+		socBuffer = nullptr;
+		return ret;
+	}
+
+	if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+		socExit();
+		free(socBuffer);
+		socBuffer = nullptr;
+		return -1;
+	}
+
+	curlReady = true;
+	CurlShare = curl_share_init();
+	if (CurlShare) {
+		curl_share_setopt(CurlShare, CURLSHOPT_LOCKFUNC, shareLock);
+		curl_share_setopt(CurlShare, CURLSHOPT_UNLOCKFUNC, shareUnlock);
+		curl_share_setopt(CurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(CurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+		/* One connection cache for the multi handle and the blocking handles, so requests to the same host skip the TCP and TLS handshake. */
+		curl_share_setopt(CurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+	}
+
+	return 0;
+}
+
+/*
+	Cleanup all idle handles, the share object and SOC.
+*/
+void CurlPool::Exit() {
+	LightLock_Lock(&poolLock);
+	for (int i = 0; i < idleCount; i++) curl_easy_cleanup(idleHandles[i]);
+	idleCount = 0;
+	LightLock_Unlock(&poolLock);
+
+	if (!curlReady) return; // Init bailed out before curl, so there is nothing else to clean up.
+
+	if (CurlShare) {
+		curl_share_cleanup(CurlShare);
+		CurlShare = nullptr;
+	}
+
+	curl_global_cleanup();
+	curlReady = false;
+
+	if (socBuffer) {
+		socExit();
+		free(socBuffer);
+		socBuffer = nullptr;
+	}
+}
+
+/*
+	Return a handle attached to the share object.
+	Reuses an idle one if available, so live connections and sessions stay warm.
+*/
+CURL *CurlPool::Acquire() {
+	CURL *hnd = nullptr;
+
+	LightLock_Lock(&poolLock);
+	if (idleCount > 0) hnd = idleHandles[--idleCount];
+	LightLock_Unlock(&poolLock);
+
+	if (!hnd) hnd = curl_easy_init();
+	if (!hnd) return nullptr;
+
+	if (CurlShare) curl_easy_setopt(hnd, CURLOPT_SHARE, CurlShare);
+	curl_easy_setopt(hnd, CURLOPT_TCP_KEEPALIVE, 1L);
+	return hnd;
+}
+
+/*
+	Hand a handle back to the pool.
+	The options get reset, the shared caches are untouched by that.
+
+	CURL *hnd: The handle from CurlPool::Acquire().
+*/
+void CurlPool::Release(CURL *hnd) {
+	if (!hnd) return;
+	curl_easy_reset(hnd);
+
+	LightLock_Lock(&poolLock);
+	if (idleCount < POOL_SIZE) {
+		idleHandles[idleCount++] = hnd;
+		hnd = nullptr;
+	}
+	LightLock_Unlock(&poolLock);
+
+	if (hnd) curl_easy_cleanup(hnd);
+}
@@ -0,0 +1,492 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "bufferPool.hpp"
+#include "config.hpp"
+#include "downloadCache.hpp"
+#include "files.hpp"
+#include "json.hpp"
+
+#include <3ds.h>
+#include <map>
+#include <mbedtls/sha256.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define COPY_CHUNK_SIZE 0x10000
+
+struct PendingFile {
+	std::string Name = ""; // The name in the cache.
+	nlohmann::json Entry = nullptr; // The entry for the index.
+};
+
+static nlohmann::json indexJson = nullptr; // The cached files by name.
+static std::map<std::string, PendingFile> pendingFiles; // Downloaded or restored files by path, which the cache takes once they get deleted.
+static LightLock cacheLock = 1; // Initialized LightLock.
+
+/*
+	Load the index from the SD card, if not already done.
+*/
+static void loadIndex() {
+	if (!indexJson.is_null()) return;
+
+	FILE *file = fopen(_DOWNLOAD_CACHE_INDEX, "rt");
+	if (file) {
+		indexJson = nlohmann::json::parse(file, nullptr, false);
+		fclose(file);
+	}
+
+	if (!indexJson.is_object()) indexJson = nlohmann::json::object();
+}
+
+static void saveIndex() {
+	FILE *file = fopen(_DOWNLOAD_CACHE_INDEX, "w");
+	if (!file) return;
+
+	const std::string dump = indexJson.dump();
+	fwrite(dump.c_str(), 1, dump.size(), file);
+	fclose(file);
+}
+
+/*
+	Return the name of a cached file: the SHA-256 of the content, if known, else the one of the URL.
+
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the SHA-256 of the content as hex. (Empty if unknown)
+*/
+std::string DownloadCache::Name(const std::string &URL, const std::string &sha256) {
+	std::string name = "";
+
+	if (sha256 != "") {
+		for (const char c : sha256) name += tolower(c);
+		return name;
+	}
+
+	u8 hash[32];
+	mbedtls_sha256_context ctx;
+	mbedtls_sha256_init(&ctx);
+	mbedtls_sha256_starts(&ctx, 0);
+	mbedtls_sha256_update(&ctx, (const unsigned char *)URL.c_str(), URL.size());
+	mbedtls_sha256_finish(&ctx, hash);
+	mbedtls_sha256_free(&ctx);
+
+	char byte[3];
+	for (const u8 b : hash) {
+		snprintf(byte, sizeof(byte), "%02x", b);
+		name += byte;
+	}
+
+	return "url-" + name;
+}
+
+/*
+	Return, if an entry belongs to a download.
+
+	const nlohmann::json &entry: Const Reference to the entry.
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the SHA-256 as hex. If set, only the content counts.
+*/
+static bool matches(const nlohmann::json &entry, const std::string &URL, const std::string &sha256) {
+	if (!entry.is_object()) return false;
+
+	if (sha256 != "") return entry.contains("sha256") && entry["sha256"].is_string() && strcasecmp(entry["sha256"].get_ref<const std::string &>().c_str(), sha256.c_str()) == 0;
+	return entry.contains("url") && entry["url"] == URL;
+}
+
+/*
+	Find the cached file of a download. Has to be called with the lock held.
+
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the SHA-256 as hex. If set, only the content counts.
+*/
+static std::string findEntry(const std::string &URL, const std::string &sha256) {
+	for (auto it = indexJson.begin(); it != indexJson.end(); ++it) {
+		if (matches(it.value(), URL, sha256)) return it.key();
+	}
+
+	return "";
+}
+
+/*
+	Find a file, which the cache takes later, by the same rules as findEntry. Has to be called with the lock held.
+	Returns its current path.
+
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the SHA-256 as hex. If set, only the content counts.
+*/
+static std::string findPending(const std::string &URL, const std::string &sha256) {
+	for (const auto &file : pendingFiles) {
+		if (matches(file.second.Entry, URL, sha256)) return file.first;
+	}
+
+	return "";
+}
+
+/*
+	Remove a cached file and its entry. Has to be called with the lock held.
+
+	const std::string &name: Const Reference to the name of the file.
+*/
+static void dropEntry(const std::string &name) {
+	const std::string file = _DOWNLOAD_CACHE_PATH + name;
+	if (access(file.c_str(), F_OK) == 0) deleteFile(file.c_str());
+	indexJson.erase(name);
+}
+
+/*
+	Create the directories of a path.
+
+	const std::string &path: Const Reference to the path.
+*/
+static void makeDirs(const std::string &path) {
+	for (size_t slashpos = path.find('/', 1); slashpos != std::string::npos; slashpos = path.find('/', slashpos + 1)) {
+		mkdir(path.substr(0, slashpos).c_str(), 0777);
+	}
+}
+
+/*
+	Move a file, replacing the destination and creating its directories.
+
+	const std::string &source: Const Reference to the source.
+	const std::string &destination: Const Reference to the destination.
+*/
+static bool moveFile(const std::string &source, const std::string &destination) {
+	makeDirs(destination);
+	if (access(destination.c_str(), F_OK) == 0) deleteFile(destination.c_str()); // The SD card doesn't replace on rename.
+
+	return rename(source.c_str(), destination.c_str()) == 0;
+}
+
+/*
+	Copy a file, creating the directories of the destination.
+	Hard-linked instead, where the filesystem supports it. (Not on the SD card of the 3DS)
+
+	const std::string &source: Const Reference to the source.
+	const std::string &destination: Const Reference to the destination.
+*/
+static bool copyFile(const std::string &source, const std::string &destination) {
+	makeDirs(destination);
+	if (access(destination.c_str(), F_OK) == 0) deleteFile(destination.c_str());
+	if (link(source.c_str(), destination.c_str()) == 0) return true;
+
+	struct stat st;
+	if (stat(source.c_str(), &st) != 0) return false;
+
+	u64 reservation = 0;
+	if (!FreeSpace::Reserve(st.st_size, reservation)) return false;
+
+	FILE *in = fopen(source.c_str(), "rb");
+	FILE *out = in ? fopen(destination.c_str(), "wb") : nullptr;
+	bool ok = in && out && ftruncate(fileno(out), st.st_size) == 0; // Allocate it at once.
+
+	std::vector<u8> buffer = BufferPool::Acquire(COPY_CHUNK_SIZE);
+	buffer.resize(COPY_CHUNK_SIZE);
+
+	while (ok) {
+		const size_t read = fread(buffer.data(), 1, buffer.size(), in);
+		if (read == 0) {
+			ok = !ferror(in);
+			break;
+		}
+
+		ok = fwrite(buffer.data(), 1, read, out) == read;
+		if (ok) FreeSpace::Commit(read, reservation);
+	}
+
+	BufferPool::Release(std::move(buffer));
+	FreeSpace::Release(reservation);
+	if (in) fclose(in);
+	if (out) fclose(out);
+
+	if (!ok && out) deleteFile(destination.c_str());
+	return ok;
+}
+
+/*
+	Return, if the cache is enabled in the config.
+*/
+bool DownloadCache::Enabled() { return config && config->downloadCache(); }
+
+/*
+	Return the size of the file of an entry.
+
+	const nlohmann::json &entry: Const Reference to the entry.
+*/
+static u64 entrySize(const nlohmann::json &entry) {
+	return entry.is_object() && entry.contains("size") && entry["size"].is_number() ? entry["size"].get<u64>() : 0;
+}
+
+/*
+	Drop the least recently used files, until another file of that size fits the quota. Has to be called with the lock held.
+
+	u64 size: The size of the new file.
+*/
+static void makeRoom(u64 size) {
+	const u64 quota = (u64)std::max(config->cacheQuota(), 0) * 1024 * 1024;
+
+	u64 used = 0;
+	for (auto it = indexJson.begin(); it != indexJson.end(); ++it) used += entrySize(it.value());
+
+	/* Least recently used first out. */
+	while (used + size > quota && !indexJson.empty()) {
+		std::string oldest = "";
+		u64 oldestTime = UINT64_MAX;
+
+		for (auto it = indexJson.begin(); it != indexJson.end(); ++it) {
+			const u64 lastUsed = it.value().contains("lastUsed") && it.value()["lastUsed"].is_number() ? it.value()["lastUsed"].get<u64>() : 0;
+			if (lastUsed < oldestTime) {
+				oldest = it.key();
+				oldestTime = lastUsed;
+			}
+		}
+
+		used -= std::min(used, entrySize(indexJson[oldest]));
+		dropEntry(oldest);
+	}
+}
+
+/*
+	Return, if a download can be restored from the cache.
+
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the SHA-256 as hex. If set, the file is found by its content.
+*/
+bool DownloadCache::Contains(const std::string &URL, const std::string &sha256) {
+	if (!DownloadCache::Enabled()) return false;
+
+	LightLock_Lock(&cacheLock);
+	loadIndex();
+	const std::string name = findEntry(URL, sha256);
+	const std::string file = name != "" ? _DOWNLOAD_CACHE_PATH + name : findPending(URL, sha256);
+	LightLock_Unlock(&cacheLock);
+
+	return file != "" && access(file.c_str(), F_OK) == 0;
+}
+
+/*
+	Return the validators of the cached copy of an URL, to ask the server, if it changed.
+
+	const std::string &URL: Const Reference to the URL.
+*/
+Validators DownloadCache::Lookup(const std::string &URL) {
+	Validators validators;
+	if (!DownloadCache::Enabled()) return validators;
+
+	LightLock_Lock(&cacheLock);
+	loadIndex();
+
+	const std::string name = findEntry(URL, "");
+	const std::string pending = name == "" ? findPending(URL, "") : "";
+	if (name != "" || pending != "") {
+		const nlohmann::json &entry = name != "" ? indexJson[name] : pendingFiles[pending].Entry;
+		if (entry.contains("etag") && entry["etag"].is_string()) validators.ETag = entry["etag"];
+		if (entry.contains("lastModified") && entry["lastModified"].is_string()) validators.LastModified = entry["lastModified"];
+		if (entry.contains("size") && entry["size"].is_number()) validators.Size = entry["size"];
+		validators.File = name != "" ? _DOWNLOAD_CACHE_PATH + name : pending;
+	}
+
+	LightLock_Unlock(&cacheLock);
+
+	/* Without the cached file, a 304 would be useless. */
+	struct stat st;
+	if (validators.File == "" || stat(validators.File.c_str(), &st) != 0 || (size_t)st.st_size != validators.Size) return { };
+
+	return validators;
+}
+
+/*
+	Put a cached file at its destination.
+	By URL only, once the server confirmed, that the file didn't change.
+	The file is moved out of the cache instead of copied, and taken back once the destination gets deleted, or by DownloadCache::Settle.
+
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the SHA-256 as hex. If set, the file is found by its content.
+	const std::string &path: Const Reference to the destination.
+*/
+bool DownloadCache::Restore(const std::string &URL, const std::string &sha256, const std::string &path) {
+	if (!DownloadCache::Enabled()) return false;
+
+	LightLock_Lock(&cacheLock);
+	loadIndex();
+
+	const std::string name = findEntry(URL, sha256);
+	const std::string pending = name == "" ? findPending(URL, sha256) : "";
+	PendingFile file;
+
+	if (name != "") {
+		file = { name, indexJson[name] };
+		indexJson.erase(name);
+		saveIndex();
+	}
+
+	LightLock_Unlock(&cacheLock);
+	bool ok = false;
+
+	if (name != "") {
+		/* No lock needed for the move: the file has no entry meanwhile, so nothing else touches it. */
+		ok = moveFile(_DOWNLOAD_CACHE_PATH + name, path);
+
+		LightLock_Lock(&cacheLock);
+		if (ok) {
+			file.Entry["lastUsed"] = (u64)time(nullptr);
+			pendingFiles[path] = file;
+
+		} else if (access((_DOWNLOAD_CACHE_PATH + name).c_str(), F_OK) == 0) { // Still cached, so only the destination failed.
+			indexJson[name] = file.Entry;
+			saveIndex();
+		}
+
+		LightLock_Unlock(&cacheLock);
+
+	} else if (pending != "") {
+		ok = pending == path || copyFile(pending, path); // Still at a destination, which isn't deleted yet.
+	}
+
+	if (ok) printf("Restored from the cache:\n%s\n", path.c_str());
+	return ok;
+}
+
+/*
+	Put a downloaded file into the cache.
+	Nothing is copied here: the cache moves the file in, once it gets deleted, else DownloadCache::Settle copies it.
+
+	const std::string &URL: Const Reference to the URL.
+	const std::string &sha256: Const Reference to the verified SHA-256 as hex. (Empty if none)
+	const std::string &etag: Const Reference to the ETag of the response.
+	const std::string &lastModified: Const Reference to the Last-Modified of the response.
+	const std::string &path: Const Reference to the downloaded file.
+*/
+void DownloadCache::Store(const std::string &URL, const std::string &sha256, const std::string &etag, const std::string &lastModified, const std::string &path) {
+	if (!DownloadCache::Enabled()) return;
+	if (sha256 == "" && etag == "" && lastModified == "") return; // Could never be used again.
+
+	struct stat st;
+	const u64 quota = (u64)std::max(config->cacheQuota(), 0) * 1024 * 1024;
+	if (stat(path.c_str(), &st) != 0 || (u64)st.st_size > quota) return;
+
+	LightLock_Lock(&cacheLock);
+	loadIndex();
+
+	/* The URL may serve something else by now. */
+	const std::string old = findEntry(URL, "");
+	if (old != "") {
+		dropEntry(old);
+		saveIndex();
+	}
+
+	for (auto it = pendingFiles.begin(); it != pendingFiles.end();) {
+		if (it->first != path && matches(it->second.Entry, URL, "")) it = pendingFiles.erase(it);
+		else ++it;
+	}
+
+	pendingFiles[path] = { DownloadCache::Name(URL, sha256), {
+		{ "url", URL },
+		{ "sha256", sha256 },
+		{ "etag", etag },
+		{ "lastModified", lastModified },
+		{ "size", (u64)st.st_size },
+		{ "lastUsed", (u64)time(nullptr) }
+	} };
+
+	LightLock_Unlock(&cacheLock);
+}
+
+/*
+	Let the cache take a downloaded or restored file, which is about to be deleted, by moving it into the cache.
+	Returns false, if the file has to be deleted as usual.
+
+	const std::string &path: Const Reference to the file.
+*/
+bool DownloadCache::Adopt(const std::string &path) {
+	LightLock_Lock(&cacheLock);
+
+	auto it = pendingFiles.find(path);
+	if (it == pendingFiles.end()) {
+		LightLock_Unlock(&cacheLock);
+		return false;
+	}
+
+	const PendingFile file = it->second;
+	pendingFiles.erase(it);
+
+	struct stat st;
+	bool ok = DownloadCache::Enabled() && stat(path.c_str(), &st) == 0 && entrySize(file.Entry) == (u64)st.st_size;
+
+	if (ok) {
+		loadIndex();
+		if (indexJson.contains(file.Name)) dropEntry(file.Name);
+		makeRoom(st.st_size);
+
+		ok = moveFile(path, _DOWNLOAD_CACHE_PATH + file.Name); // Only renames on the same SD card, so it's fine under the lock.
+		if (ok) {
+			indexJson[file.Name] = file.Entry;
+			saveIndex();
+		}
+	}
+
+	LightLock_Unlock(&cacheLock);
+	return ok;
+}
+
+/*
+	Copy the downloaded and restored files, which were kept at their destination, into the cache.
+	Called after each entry of the queue and on exit. The copies run without the lock.
+*/
+void DownloadCache::Settle() {
+	std::map<std::string, PendingFile> files;
+
+	LightLock_Lock(&cacheLock);
+	files.swap(pendingFiles);
+	LightLock_Unlock(&cacheLock);
+
+	if (!DownloadCache::Enabled()) return;
+
+	for (const auto &file : files) {
+		struct stat st;
+		if (stat(file.first.c_str(), &st) != 0 || entrySize(file.second.Entry) != (u64)st.st_size) continue; // Changed meanwhile.
+
+		LightLock_Lock(&cacheLock);
+		loadIndex();
+		if (indexJson.contains(file.second.Name)) dropEntry(file.second.Name);
+		makeRoom(st.st_size);
+		saveIndex();
+		LightLock_Unlock(&cacheLock);
+
+		/* Copied under another name, so no lookup finds it half written. */
+		const std::string part = _DOWNLOAD_CACHE_PATH + file.second.Name + ".part";
+		if (!copyFile(file.first, part)) continue;
+
+		LightLock_Lock(&cacheLock);
+		if (moveFile(part, _DOWNLOAD_CACHE_PATH + file.second.Name)) {
+			indexJson[file.second.Name] = file.second.Entry;
+			saveIndex();
+		}
+
+		LightLock_Unlock(&cacheLock);
+	}
+}
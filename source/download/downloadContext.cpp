@@ -0,0 +1,1096 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "bufferTuner.hpp"
+#include "curlPool.hpp"
+#include "downloadContext.hpp"
+#include "downloadDefs.hpp"
+#include "files.hpp"
+#include "json.hpp"
+#include "validatorCache.hpp"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <malloc.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define VERIFY_CHUNK_SIZE 0x60000
+#define COMMIT_STACK_SIZE 0x8000 // The journal gets written from the commit thread, which takes JSON and stdio.
+#define JOURNAL_INTERVAL_BYTES 0x200000 // Write the journal after at least 2 MiB were committed...
+#define JOURNAL_INTERVAL_MS 2000 // ...or 2 seconds passed, whatever comes first.
+
+#define JOURNAL_EXTENSION ".journal"
+#define PART_EXTENSION ".part"
+
+/* The progress of the download, which is displayed right now. */
+curl_off_t downloadTotal = 1; // Dont initialize with 0 to avoid division by zero later.
+curl_off_t downloadNow = 0;
+curl_off_t downloadSpeed = 0;
+
+/* Set by the queue, to cancel the running downloads. */
+namespace QueueSystem { extern bool CancelCallback; };
+
+/*
+	Initialize a DownloadContext.
+
+	const std::string &url: Const Reference to the download URL.
+	const std::string &path: Const Reference to the output path. Empty for downloading into RAM.
+*/
+DownloadContext::DownloadContext(const std::string &url, const std::string &path) : url(url), path(path) {
+	LightEvent_Init(&this->finished, RESET_STICKY);
+	LightLock_Init(&this->ringLock);
+	CondVar_Init(&this->ringFilled);
+	CondVar_Init(&this->ringDrained);
+	mbedtls_sha256_init(&this->shaContext);
+}
+
+/*
+	Return the value of a header line, if it is the wanted header.
+
+	const std::string &line: Const Reference to the header line.
+	const char *name: The header name, including the colon.
+	std::string &value: Output for the trimmed value.
+*/
+static bool headerValue(const std::string &line, const char *name, std::string &value) {
+	const size_t len = strlen(name);
+	if (line.size() < len || strncasecmp(line.c_str(), name, len) != 0) return false;
+
+	const size_t start = line.find_first_not_of(" \t", len);
+	const size_t end = line.find_last_not_of(" \t\r\n");
+	value = (start == std::string::npos || end < start) ? "" : line.substr(start, end - start + 1);
+	return true;
+}
+
+size_t DownloadContext::HeaderData(char *buffer, size_t size, size_t nitems, void *userdata) {
+	DownloadContext *ctx = (DownloadContext *)userdata;
+	const std::string line(buffer, size * nitems);
+
+	/* A new response starts, e.g. after a redirect. */
+	if (line.compare(0, 5, "HTTP/") == 0) {
+		const size_t space = line.find(' ');
+		ctx->status = (space != std::string::npos) ? strtol(line.c_str() + space + 1, nullptr, 10) : 0;
+		ctx->etag = "";
+		ctx->lastModified = "";
+		ctx->retryAfter = 0;
+		ctx->acceptRanges = false;
+		ctx->length = -1;
+
+	} else {
+		std::string retryAfter = "", ranges = "", length = "";
+		headerValue(line, "ETag:", ctx->etag);
+		headerValue(line, "Last-Modified:", ctx->lastModified);
+
+		if (headerValue(line, "Accept-Ranges:", ranges)) ctx->acceptRanges = strcasecmp(ranges.c_str(), "bytes") == 0;
+		if (headerValue(line, "Content-Length:", length)) ctx->length = strtoll(length.c_str(), nullptr, 10);
+
+		/* Only the delay in seconds is honored, not the HTTP date. */
+		if (headerValue(line, "Retry-After:", retryAfter)) ctx->retryAfter = strtoul(retryAfter.c_str(), nullptr, 10) * 1000;
+	}
+
+	return size * nitems;
+}
+
+int DownloadContext::Progress(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+	DownloadContext *ctx = (DownloadContext *)clientp;
+
+	/* Ranged requests only report the remaining part. */
+	ctx->total = dltotal > 0 ? dltotal + ctx->resumeFrom : 0;
+	ctx->now = dlnow + ctx->resumeFrom;
+	curl_easy_getinfo(ctx->hnd, CURLINFO_SPEED_DOWNLOAD_T, &ctx->speed);
+
+	/* The average hides short peaks, so sample the throughput every half second. */
+	const u64 time = osGetTime();
+	if (ctx->sampleTime == 0) {
+		ctx->sampleTime = time;
+		ctx->sampleBytes = dlnow;
+
+	} else if (time - ctx->sampleTime >= 500) {
+		const curl_off_t rate = ((dlnow - ctx->sampleBytes) * 1000) / (curl_off_t)(time - ctx->sampleTime);
+		if (rate > ctx->stats.PeakSpeed) ctx->stats.PeakSpeed = rate;
+		if (!ctx->paused) BufferTuner::RecordThroughput(rate);
+
+		ctx->sampleTime = time;
+		ctx->sampleBytes = dlnow;
+	}
+
+	ctx->Resume();
+
+	if (ctx->reportProgress) {
+		downloadTotal = ctx->total;
+		downloadNow = ctx->now;
+		downloadSpeed = ctx->speed;
+	}
+
+	return ctx->canceled; // Non-zero aborts the transfer.
+}
+
+static std::string toHex(const u8 *data, size_t size) {
+	std::string hex = "";
+	char byte[3];
+
+	for (size_t i = 0; i < size; i++) {
+		snprintf(byte, sizeof(byte), "%02x", data[i]);
+		hex += byte;
+	}
+
+	return hex;
+}
+
+/*
+	Start the checksums over.
+*/
+void DownloadContext::ResetChecksums() {
+	if (this->sha256 != "") mbedtls_sha256_starts(&this->shaContext, 0);
+	this->crcState = ::crc32(0L, Z_NULL, 0);
+}
+
+/*
+	Add committed data to the checksums.
+
+	const char *buffer: The committed data.
+	size_t size: The size of the data.
+*/
+void DownloadContext::UpdateChecksums(const char *buffer, size_t size) {
+	if (this->sha256 != "") mbedtls_sha256_update(&this->shaContext, (const unsigned char *)buffer, size);
+	if (this->crc32 != "") this->crcState = ::crc32(this->crcState, (const Bytef *)buffer, size);
+}
+
+/*
+	Return, if the checksums of the whole file match the expected ones.
+*/
+bool DownloadContext::VerifyChecksums() {
+	if (this->sha256 != "") {
+		u8 hash[32];
+		mbedtls_sha256_finish(&this->shaContext, hash);
+
+		if (strcasecmp(toHex(hash, sizeof(hash)).c_str(), this->sha256.c_str()) != 0) {
+			printf("SHA-256 mismatch for:\n%s\n", this->path.c_str());
+			return false;
+		}
+	}
+
+	if (this->crc32 != "" && strtoul(this->crc32.c_str(), nullptr, 16) != this->crcState) {
+		printf("CRC32 mismatch for:\n%s\n", this->path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Return the validator, which is sent with If-Range. Weak ETags are not allowed there.
+*/
+std::string DownloadContext::RangeValidator() const {
+	if (this->etag != "" && this->etag.compare(0, 2, "W/") != 0) return this->etag;
+	return this->lastModified;
+}
+
+/*
+	Load the journal of a previous attempt and return, from where the download can continue.
+*/
+curl_off_t DownloadContext::LoadJournal() {
+	nlohmann::json journal;
+	FILE *file = fopen((this->outPath + JOURNAL_EXTENSION).c_str(), "rt");
+	if (!file) return 0;
+
+	journal = nlohmann::json::parse(file, nullptr, false);
+	fclose(file);
+
+	if (journal.is_discarded() || !journal.is_object()) return 0;
+	if (!journal.contains("url") || !journal["url"].is_string()) return 0;
+
+	/* Mirrors serve the same file, so the part of any of them can be continued. If-Range catches, if they differ. */
+	const std::string url = journal["url"];
+	if (std::find(this->candidates.begin(), this->candidates.end(), url) == this->candidates.end()) return 0;
+
+	if (!journal.contains("committed") || !journal["committed"].is_number()) return 0;
+
+	if (journal.contains("etag") && journal["etag"].is_string()) this->etag = journal["etag"];
+	if (journal.contains("lastModified") && journal["lastModified"].is_string()) this->lastModified = journal["lastModified"];
+	if (this->RangeValidator() == "") return 0; // No way to tell, if the file changed meanwhile.
+
+	/* The part file must contain at least everything, the journal claims. */
+	const curl_off_t committed = journal["committed"];
+	struct stat st;
+	if (stat(this->outPath.c_str(), &st) != 0 || st.st_size < committed) return 0;
+
+	/* The checksums continue from what is really on the SD card. */
+	if ((this->sha256 != "" || this->crc32 != "") && !this->HashFile(this->outPath, committed)) {
+		this->ResetChecksums();
+		return 0;
+	}
+
+	return committed;
+}
+
+/*
+	Write the journal, so the download can continue after a failure.
+*/
+void DownloadContext::WriteJournal() {
+	const nlohmann::json journal = {
+		{ "url", this->url },
+		{ "etag", this->etag },
+		{ "lastModified", this->lastModified },
+		{ "committed", this->committed }
+	};
+
+	this->journaled = this->committed;
+	this->journaledAt = osGetTime();
+
+	FILE *file = fopen((this->outPath + JOURNAL_EXTENSION).c_str(), "w");
+	if (!file) return;
+
+	const std::string dump = journal.dump();
+	fwrite(dump.c_str(), 1, dump.size(), file);
+	fclose(file);
+}
+
+/*
+	Return, if a previous attempt left a journal to continue from.
+
+	const std::string &path: Const Reference to the output path of the download.
+*/
+bool DownloadContext::HasJournal(const std::string &path) {
+	return access((path + PART_EXTENSION + JOURNAL_EXTENSION).c_str(), F_OK) == 0;
+}
+
+void DownloadContext::RemoveJournal() {
+	const std::string journal = this->outPath + JOURNAL_EXTENSION;
+	if (access(journal.c_str(), F_OK) == 0) deleteFile(journal.c_str());
+}
+
+/*
+	Write a buffer to the file.
+
+	const char *buffer: The buffer to write.
+	size_t size: The size of the buffer.
+*/
+bool DownloadContext::Commit(const char *buffer, size_t size) {
+	if (!this->out) return false;
+
+	/* Segments and preallocated files write into space, which got allocated for the whole file already. */
+	const bool allocated = this->Segment() || this->preallocated;
+	if (!allocated && this->reservation < size && FreeSpace::Available() < size - this->reservation) return false; // Out of space.
+
+	fseek(this->out, this->committed, SEEK_SET); // The file may be preallocated, so write in place.
+	const u64 start = svcGetSystemTick();
+	u32 byteswritten = fwrite(buffer, 1, size, this->out);
+	if (byteswritten != size) return false;
+	BufferTuner::RecordCommit(size, svcGetSystemTick() - start);
+
+	if (!allocated) FreeSpace::Commit(size, this->reservation);
+	this->UpdateChecksums(buffer, size);
+	if (this->hasher) this->hasher->Committed(this->rangeStart, this->committed, buffer, size, this->out);
+	this->committed += size;
+	this->stats.Written += size;
+
+	/* Only record what really reached the SD card. Every buffer would be too much, Finish() writes the rest. */
+	if (this->resumable && (this->committed - this->journaled >= JOURNAL_INTERVAL_BYTES || osGetTime() - this->journaledAt >= JOURNAL_INTERVAL_MS)) {
+		if (fflush(this->out) == 0) this->WriteJournal();
+	}
+
+	return true;
+}
+
+/*
+	The commit thread, which writes the queued buffers of the ring to the SD card.
+	Once the DownloadEngine is done with the transfer, it writes the rest and finalizes the download.
+*/
+void DownloadContext::CommitThread(void *arg) {
+	DownloadContext *ctx = (DownloadContext *)arg;
+	LightLock_Lock(&ctx->ringLock);
+
+	while (true) {
+		while (ctx->ringQueued == 0 && !ctx->killThread && !ctx->finishing) CondVar_Wait(&ctx->ringFilled, &ctx->ringLock);
+		if (ctx->killThread) break;
+
+		if (ctx->ringQueued == 0) {
+			LightLock_Unlock(&ctx->ringLock);
+			ctx->finishRet = ctx->Finalize(false);
+
+			LightLock_Lock(&ctx->ringLock);
+			ctx->finalized = true;
+			LightLock_Unlock(&ctx->ringLock);
+
+			ctx->Wakeup(); // The engine waits with concluding it, until this thread got joined.
+			return;
+		}
+
+		const u8 idx = ctx->ringTail;
+		const bool discard = ctx->finishing && !ctx->finishKeep; // Failed for good, so the rest isn't needed.
+		LightLock_Unlock(&ctx->ringLock);
+
+		const bool ok = ctx->writeError || discard || ctx->Commit(ctx->ring[idx], ctx->ringSizes[idx]);
+
+		LightLock_Lock(&ctx->ringLock);
+		if (!ok) ctx->writeError = true;
+		ctx->ringTail = (ctx->ringTail + 1) % ctx->ring.size();
+		ctx->ringQueued--;
+		CondVar_Broadcast(&ctx->ringDrained);
+
+		/* The network side paused for the SD card, so let the engine resume it. */
+		if (ctx->ringPaused && ctx->RingDrained()) ctx->Wakeup();
+	}
+
+	LightLock_Unlock(&ctx->ringLock);
+}
+
+/*
+	Hand the current buffer to the commit thread and move on to the next one.
+	Blocking transfers stall here, if the ring is full, until it got drained to the low watermark.
+	Transfers of the DownloadEngine pause in WriteFile() instead, before the ring runs full.
+
+	bool more: If more data of the current chunk follows, which needs a free buffer right away.
+*/
+bool DownloadContext::QueueBuffer(bool more) {
+	if (this->bufferPos == 0) return true;
+	svcFlushProcessDataCache(CUR_PROCESS_HANDLE, (u32)(uintptr_t)this->ring[this->ringHead], this->bufferPos);
+
+	LightLock_Lock(&this->ringLock);
+	this->ringSizes[this->ringHead] = this->bufferPos;
+	this->ringHead = (this->ringHead + 1) % this->ring.size();
+	this->ringQueued++;
+	this->bufferPos = 0;
+	if (this->ringQueued > this->peakQueued) this->peakQueued = this->ringQueued;
+	CondVar_Signal(&this->ringFilled);
+
+	/* The next buffer is still queued, so wait for the SD card. */
+	if (this->ringQueued == this->ring.size() && (more || !this->multi)) {
+		const u64 start = osGetTime();
+		this->stalls++;
+
+		while (this->ringQueued > this->lowWatermark && !this->writeError) CondVar_Wait(&this->ringDrained, &this->ringLock);
+		this->stallTime += osGetTime() - start;
+	}
+
+	const bool ok = !this->writeError;
+	LightLock_Unlock(&this->ringLock);
+	return ok;
+}
+
+/*
+	Return, if a chunk of the given size fits into the ring without waiting for the SD card.
+	If not, the transfer gets paused until the commit thread drained the ring far enough.
+
+	size_t size: The size of the chunk.
+*/
+bool DownloadContext::RingFits(size_t size) {
+	LightLock_Lock(&this->ringLock);
+	const size_t free = (this->ring.size() - this->ringQueued) * this->chunkSize - this->bufferPos;
+	const bool fits = size <= free || size > this->ringBytes - this->chunkSize; // Chunks, which may never fit, go the blocking way.
+
+	if (!fits) {
+		this->ringPaused = true;
+		this->stalledAt = osGetTime();
+		this->ringWanted = size;
+		this->stalls++;
+	}
+
+	LightLock_Unlock(&this->ringLock);
+	return fits;
+}
+
+/*
+	Return, if the ring got drained to the low watermark and the held back chunk fits. Call this with ringLock held.
+*/
+bool DownloadContext::RingDrained() const {
+	const size_t free = (this->ring.size() - this->ringQueued) * this->chunkSize - this->bufferPos;
+	return this->writeError || (this->ringQueued <= this->lowWatermark && this->ringWanted <= free);
+}
+
+/*
+	Wake up the DownloadEngine, so it resumes the transfer in time. Can be called from any thread.
+*/
+void DownloadContext::Wakeup() {
+	if (this->multi) curl_multi_wakeup(this->multi);
+}
+
+/*
+	Tell the transfer, that the sink takes data again after refusing it. Can be called from any thread.
+*/
+void DownloadContext::SinkDrained() {
+	LightLock_Lock(&this->ringLock);
+	this->sinkDrained = true;
+	CondVar_Broadcast(&this->ringDrained);
+	LightLock_Unlock(&this->ringLock);
+
+	this->Wakeup();
+}
+
+/*
+	Wait until the commit thread wrote everything, which is queued.
+*/
+void DownloadContext::DrainRing() {
+	if (!this->commitThread) return;
+
+	LightLock_Lock(&this->ringLock);
+	while (this->ringQueued > 0) CondVar_Wait(&this->ringDrained, &this->ringLock);
+	LightLock_Unlock(&this->ringLock);
+}
+
+/*
+	Return, if the transfer should pause at this chunk, because a more urgent one runs.
+	After pausing for SCHEDULER_MAX_PAUSE it gets its share again, so it doesn't starve.
+*/
+bool DownloadContext::Yield() {
+	if (!Scheduler::ShouldYield(this->priority)) return false;
+
+	const u64 now = osGetTime();
+	if (this->resumedAt != 0 && now - this->resumedAt < SCHEDULER_SHARE) return false;
+
+	this->paused = true;
+	this->pausedAt = now;
+	return true;
+}
+
+/*
+	Continue a paused transfer, once nothing more urgent runs or it waited long enough and the ring or the sink got drained.
+	Only call this from the thread, which drives the transfer.
+*/
+void DownloadContext::Resume() {
+	if ((!this->paused && !this->ringPaused && !this->sinkPaused) || !this->hnd) return;
+
+	const u64 now = osGetTime();
+	if (this->paused) {
+		if (Scheduler::ShouldYield(this->priority) && now - this->pausedAt < SCHEDULER_MAX_PAUSE) return;
+
+		this->paused = false;
+		this->resumedAt = now;
+	}
+
+	if (this->ringPaused || this->sinkPaused) {
+		LightLock_Lock(&this->ringLock);
+		const bool drained = this->ringPaused ? this->RingDrained() : this->sinkDrained;
+
+		if (drained) {
+			this->ringPaused = false;
+			this->sinkPaused = false;
+			this->sinkDrained = false;
+		}
+
+		LightLock_Unlock(&this->ringLock);
+		if (!drained) return;
+
+		this->stallTime += now - this->stalledAt;
+	}
+
+	curl_easy_pause(this->hnd, CURLPAUSE_CONT); // After updating the state, as CURL may hand over the held back chunk right away.
+}
+
+size_t DownloadContext::WriteFile(char *ptr, size_t size, size_t nmemb, void *userdata) {
+	DownloadContext *ctx = (DownloadContext *)userdata;
+
+	if (ctx->writeError || ctx->canceled) return 0;
+	if (QueueSystem::CancelCallback) return 0;
+	if (ctx->Yield()) return CURL_WRITEFUNC_PAUSE; // CURL keeps the chunk until resumed.
+
+	const size_t bsz = size * nmemb;
+
+	if (ctx->ring.empty()) {
+		/* A segment can't deal with the whole file. */
+		if (ctx->Segment()) {
+			if (ctx->status != 206) return 0;
+
+		/* The server ignored the range, because the file changed. Start over. */
+		} else if (ctx->resumeFrom > 0 && ctx->status != 206) {
+			if (ftruncate(fileno(ctx->out), 0) != 0) return 0;
+			rewind(ctx->out);
+			ctx->resumeFrom = 0;
+			ctx->committed = 0;
+			ctx->ResetChecksums();
+		}
+
+		/* Reserve the rest of the file up front, so it can't run out of space halfway. */
+		curl_off_t length = -1;
+		if (!ctx->Segment()) curl_easy_getinfo(ctx->hnd, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+		if (length > 0 && !FreeSpace::Reserve(length, ctx->reservation)) return 0;
+
+		/* Let the filesystem allocate all clusters at once, instead of growing the file with every commit. That uses up the reservation. */
+		if (length > 0 && ftruncate(fileno(ctx->out), ctx->committed + length) == 0) {
+			ctx->preallocated = true;
+			FreeSpace::Commit(length, ctx->reservation);
+		}
+
+		const u8 count = ctx->ringBuffers > 1 ? ctx->ringBuffers : 2;
+		if (ctx->lowWatermark >= count) ctx->lowWatermark = count - 1;
+
+		/* Sized from the measured throughput, within the memory ceiling. */
+		ctx->chunkSize = BufferTuner::Acquire(count);
+		ctx->ringBytes = ctx->chunkSize * count;
+
+		for (u8 i = 0; i < count; i++) {
+			char *buffer = (char *)memalign(0x1000, ctx->chunkSize);
+			if (!buffer) return 0;
+
+			ctx->ring.push_back(buffer);
+		}
+
+		ctx->ringSizes.resize(count, 0);
+
+		s32 prio = 0;
+		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+		ctx->commitThread = threadCreate(CommitThread, ctx, COMMIT_STACK_SIZE, prio - 1, -2, false);
+		if (!ctx->commitThread) return 0;
+	}
+
+	/* The engine thread must not wait for the SD card. CURL keeps the chunk until resumed. */
+	if (ctx->multi && !ctx->RingFits(bsz)) return CURL_WRITEFUNC_PAUSE;
+
+	size_t written = 0;
+	while (written < bsz) {
+		const size_t tofill = std::min(bsz - written, ctx->chunkSize - ctx->bufferPos);
+		memcpy(ctx->ring[ctx->ringHead] + ctx->bufferPos, ptr + written, tofill);
+		ctx->bufferPos += tofill;
+		written += tofill;
+
+		if (ctx->bufferPos == ctx->chunkSize && !ctx->QueueBuffer(written < bsz)) return 0;
+	}
+
+	return bsz;
+}
+
+size_t DownloadContext::WriteSink(char *ptr, size_t size, size_t nmemb, void *userdata) {
+	DownloadContext *ctx = (DownloadContext *)userdata;
+	const size_t bsz = size * nmemb;
+
+	if (ctx->canceled || QueueSystem::CancelCallback) return 0;
+	if (ctx->Yield()) return CURL_WRITEFUNC_PAUSE;
+
+	while (true) {
+		const SinkResult result = ctx->sink(ptr, bsz);
+		if (result != SinkResult::Full) return result == SinkResult::Accepted ? bsz : 0;
+
+		LightLock_Lock(&ctx->ringLock);
+
+		/* The engine thread must not wait for the consumer. CURL keeps the chunk until resumed. */
+		if (ctx->multi) {
+			ctx->sinkPaused = true;
+			ctx->stalledAt = osGetTime();
+			ctx->stalls++;
+			LightLock_Unlock(&ctx->ringLock);
+			return CURL_WRITEFUNC_PAUSE;
+		}
+
+		/* A blocking transfer just waits and tries again. */
+		while (!ctx->sinkDrained && !ctx->canceled) CondVar_Wait(&ctx->ringDrained, &ctx->ringLock);
+		ctx->sinkDrained = false;
+		LightLock_Unlock(&ctx->ringLock);
+		if (ctx->canceled) return 0;
+	}
+}
+
+size_t DownloadContext::WriteMemory(char *ptr, size_t size, size_t nmemb, void *userdata) {
+	DownloadContext *ctx = (DownloadContext *)userdata;
+	const size_t bsz = size * nmemb;
+
+	if (ctx->canceled) return 0;
+	if (ctx->Yield()) return CURL_WRITEFUNC_PAUSE;
+
+	/* Take a pooled buffer, which fits the whole body, if the server told us the size. */
+	if (ctx->data.capacity() == 0) {
+		curl_off_t length = -1;
+		curl_easy_getinfo(ctx->hnd, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+		ctx->data = BufferPool::Acquire(length > 0 ? length : 0);
+	}
+
+	ctx->data.insert(ctx->data.end(), (u8 *)ptr, (u8 *)ptr + bsz);
+	return bsz;
+}
+
+/*
+	Attach a CURL handle to the context and open the output.
+
+	CURL *hnd: The CURL handle to use.
+*/
+Result DownloadContext::Setup(CURL *hnd) {
+	if (!hnd) return -1;
+	this->hnd = hnd;
+	this->status = 0;
+	this->writeError = false;
+	this->retryAt = 0;
+	this->retryAfter = 0;
+	this->paused = false;
+	this->resumedAt = 0;
+	this->ringPaused = false;
+	this->sinkPaused = false;
+	this->sinkDrained = false;
+
+	/* The first attempt goes to the best of the URL and its mirrors. */
+	if (this->candidates.empty()) {
+		this->candidates.push_back(this->url);
+		this->candidates.insert(this->candidates.end(), this->mirrors.begin(), this->mirrors.end());
+		if (!this->mirrors.empty()) this->url = MirrorStats::Pick(this->candidates, this->tried);
+	}
+
+	this->stats = TransferStats();
+	this->stats.Retries = this->attempts++;
+	this->stalls = 0;
+	this->stallTime = 0;
+	this->peakQueued = 0;
+	this->sampleTime = 0;
+	this->sampleBytes = 0;
+
+	if (this->path != "") {
+		/* make directories. */
+		for (size_t slashpos = this->path.find('/', 1); slashpos != std::string::npos; slashpos = this->path.find('/', slashpos + 1)) {
+			mkdir(this->path.substr(0, slashpos).c_str(), 0777);
+		}
+
+		/* Resumable downloads go to a part file first, which is renamed once complete. */
+		this->outPath = (this->resumable && !this->Segment()) ? this->path + PART_EXTENSION : this->path;
+		this->ResetChecksums();
+		if (this->resumable && !this->Segment()) this->resumeFrom = this->LoadJournal();
+
+		/* A segment continues, where its last attempt stopped. The file has its full size already. */
+		if (this->Segment()) {
+			if (this->committed < this->rangeStart || this->committed > this->rangeEnd) this->committed = this->rangeStart;
+			this->resumeFrom = this->committed - this->rangeStart;
+			this->out = fopen(this->outPath.c_str(), "r+b");
+			if (!this->out) return -2;
+
+		} else if (this->resumeFrom > 0) {
+			this->out = fopen(this->outPath.c_str(), "r+b");
+
+			if (this->out && ftruncate(fileno(this->out), this->resumeFrom) == 0) {
+				fseek(this->out, 0, SEEK_END);
+
+			} else {
+				if (this->out) fclose(this->out);
+				this->out = nullptr;
+				this->resumeFrom = 0;
+				this->ResetChecksums();
+			}
+		}
+
+		if (!this->out) this->out = fopen(this->outPath.c_str(), "wb");
+		if (!this->out) return -2;
+
+		if (!this->Segment()) this->committed = this->resumeFrom;
+		this->journaled = this->committed;
+		this->journaledAt = osGetTime();
+
+	} else this->data.clear(); // Drop what a failed attempt left, but keep the buffer.
+
+	curl_easy_setopt(hnd, CURLOPT_BUFFERSIZE, BufferTuner::CurlBufferSize());
+	curl_easy_setopt(hnd, CURLOPT_URL, this->url.c_str());
+	curl_easy_setopt(hnd, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt(hnd, CURLOPT_USERAGENT, USER_AGENT);
+	curl_easy_setopt(hnd, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(hnd, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(hnd, CURLOPT_ACCEPT_ENCODING, "gzip");
+	curl_easy_setopt(hnd, CURLOPT_MAXREDIRS, 50L);
+	curl_easy_setopt(hnd, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(hnd, CURLOPT_PIPEWAIT, this->url.compare(0, 8, "https://") == 0 ? 1L : 0L); // HTTP/2 only comes over TLS, plain HTTP would wait for nothing.
+	curl_easy_setopt(hnd, CURLOPT_XFERINFOFUNCTION, Progress);
+	curl_easy_setopt(hnd, CURLOPT_XFERINFODATA, this);
+	curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, this->out ? WriteFile : (this->sink ? WriteSink : WriteMemory));
+	curl_easy_setopt(hnd, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(hnd, CURLOPT_HEADERFUNCTION, HeaderData);
+	curl_easy_setopt(hnd, CURLOPT_HEADERDATA, this);
+	curl_easy_setopt(hnd, CURLOPT_PRIVATE, this);
+	curl_easy_setopt(hnd, CURLOPT_SSL_VERIFYPEER, 0L);
+	curl_easy_setopt(hnd, CURLOPT_VERBOSE, 1L);
+	curl_easy_setopt(hnd, CURLOPT_STDERR, stdout);
+
+	/* Files only get asked for with their own validators, and not while continuing a part. */
+	if (this->conditional && (!this->out || this->resumeFrom == 0)) {
+		const bool own = this->revalidate.ETag != "" || this->revalidate.LastModified != "";
+		const Validators validators = (own || this->out) ? this->revalidate : ValidatorCache::Get(this->url);
+
+		if (validators.ETag != "") this->headers = curl_slist_append(this->headers, ("If-None-Match: " + validators.ETag).c_str());
+		if (validators.LastModified != "") this->headers = curl_slist_append(this->headers, ("If-Modified-Since: " + validators.LastModified).c_str());
+	}
+
+	/* Ranges count the bytes of the raw file, and a sink relies on the length matching the bytes it gets. */
+	if (this->resumable || this->Segment() || this->headOnly || this->sink) curl_easy_setopt(hnd, CURLOPT_ACCEPT_ENCODING, nullptr);
+	if (this->headOnly) curl_easy_setopt(hnd, CURLOPT_NOBODY, 1L);
+
+	/* Continue the previous attempt, as long as the file on the server is still the same. */
+	if (this->Segment()) {
+		const std::string range = std::to_string(this->committed) + "-" + std::to_string(this->rangeEnd);
+		curl_easy_setopt(hnd, CURLOPT_RANGE, range.c_str()); // CURL copies the string.
+
+	} else if (this->resumeFrom > 0) {
+		curl_easy_setopt(hnd, CURLOPT_RESUME_FROM_LARGE, this->resumeFrom);
+		this->headers = curl_slist_append(this->headers, ("If-Range: " + this->RangeValidator()).c_str());
+	}
+
+	if (this->headers) curl_easy_setopt(hnd, CURLOPT_HTTPHEADER, this->headers);
+
+	Scheduler::Begin(this->priority);
+	this->scheduled = true;
+	this->state = TransferState::Running;
+	return 0;
+}
+
+/*
+	Stop the commit thread, close the output and free the buffers.
+*/
+void DownloadContext::Cleanup() {
+	if (this->commitThread) {
+		LightLock_Lock(&this->ringLock);
+		this->killThread = true;
+		CondVar_Signal(&this->ringFilled);
+		LightLock_Unlock(&this->ringLock);
+
+		threadJoin(this->commitThread, U64_MAX);
+		threadFree(this->commitThread);
+		this->killThread = false;
+		this->commitThread = nullptr;
+	}
+
+	this->finishing = false;
+	this->finalized = false;
+
+	if (this->out) {
+		fclose(this->out);
+		this->out = nullptr;
+	}
+
+	FreeSpace::Release(this->reservation);
+	this->preallocated = false;
+
+	if (this->headers) {
+		curl_slist_free_all(this->headers);
+		this->headers = nullptr;
+	}
+
+	for (char *buffer : this->ring) free(buffer);
+	this->ring.clear();
+	this->ringSizes.clear();
+	BufferTuner::Release(this->ringBytes);
+	this->ringBytes = 0;
+
+	this->ringHead = 0;
+	this->ringTail = 0;
+	this->ringQueued = 0;
+	this->bufferPos = 0;
+}
+
+/*
+	Finish the download after CURL is done with it.
+	A file download of the DownloadEngine hands the rest to its commit thread, which writes it and moves the file into place, so the engine thread doesn't wait for the SD card.
+	The engine concludes it, once Finalized() is true. Everything else gets finished right away.
+
+	CURLcode res: The result of the transfer.
+*/
+Result DownloadContext::Finish(CURLcode res) {
+	this->result = res;
+
+	if (this->scheduled) {
+		Scheduler::End(this->priority);
+		this->scheduled = false;
+	}
+
+	if (this->multi && this->out) {
+		const bool keep = res == CURLE_OK || this->resumable || this->Segment(); // On failure only, if the download can be continued later.
+		if (keep && this->commitThread) this->QueueBuffer(false); // Doesn't wait, since the engine drives it.
+
+		/* Nothing got written, but the file still has to be closed and moved or deleted. */
+		if (!this->commitThread) {
+			s32 prio = 0;
+			svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+			this->commitThread = threadCreate(CommitThread, this, COMMIT_STACK_SIZE, prio - 1, -2, false);
+		}
+
+		if (this->commitThread) {
+			LightLock_Lock(&this->ringLock);
+			this->finishing = true;
+			this->finishKeep = keep;
+			CondVar_Signal(&this->ringFilled);
+			LightLock_Unlock(&this->ringLock);
+			return 0;
+		}
+	}
+
+	this->finishRet = this->Finalize(true);
+	return this->Conclude();
+}
+
+/*
+	Commit the remaining data, close the file and move it into place or drop it.
+	Runs on the commit thread for the DownloadEngine, else on the thread, which finishes the download.
+
+	bool drain: If the rest still has to be handed to the commit thread and waited for.
+*/
+Result DownloadContext::Finalize(bool drain) {
+	const CURLcode res = this->result;
+	Result ret = (res != CURLE_OK) ? -res : 0;
+
+	/* Commit the rest. On failure only, if the download can be continued later. */
+	if (this->out && (res == CURLE_OK || this->resumable || this->Segment())) {
+		if (drain && this->commitThread) {
+			this->QueueBuffer();
+			this->DrainRing();
+		}
+
+		if (this->writeError) {
+			if (ret == 0) ret = -3;
+
+		} else if (fflush(this->out) == 0 && this->resumable && ret != 0 && this->committed != this->journaled) this->WriteJournal(); // Keep everything for the next attempt.
+
+		/* Cut off what got preallocated, but never written. */
+		if (this->preallocated) {
+			if (ftruncate(fileno(this->out), this->committed) != 0 && ret == 0) ret = -3;
+			FreeSpace::Sync(); // The cut off part is free again.
+		}
+
+		if (this->stalls > 0) printf("Ring stalled %" PRIu32 " times for %" PRIu64 " ms, peak %u of %u buffers.\n", this->stalls, this->stallTime, this->peakQueued, (u8)this->ring.size());
+
+		if (ret == 0 && !this->NotModified() && !this->VerifyChecksums()) ret = DL_ERROR_CHECKSUM;
+
+		/* The server has to deliver the whole segment. */
+		if (ret == 0 && this->Segment() && this->committed != this->rangeEnd + 1) {
+			this->result = CURLE_PARTIAL_FILE;
+			ret = -CURLE_PARTIAL_FILE;
+		}
+	}
+
+	if (this->out) {
+		fclose(this->out);
+		this->out = nullptr;
+	}
+
+	this->finishCanceled = this->canceled || (this->path != "" && QueueSystem::CancelCallback);
+	const bool done = !this->finishCanceled && ret == 0;
+
+	/* The file of a segment belongs to the whole download. */
+	if (this->path != "" && this->outPath != "" && !this->Segment()) {
+		/* There is no body, so the caller takes its local copy. */
+		if (done && this->NotModified()) {
+			if (access(this->outPath.c_str(), F_OK) == 0) deleteFile(this->outPath.c_str());
+			if (this->resumable) this->RemoveJournal();
+
+		} else if (done) {
+			/* Move the completed part file to its place. */
+			if (this->outPath != this->path) {
+				if (access(this->path.c_str(), F_OK) == 0) deleteFile(this->path.c_str());
+				if (rename(this->outPath.c_str(), this->path.c_str()) != 0) ret = -3;
+			}
+
+			this->RemoveJournal();
+
+		/* Keep what we have for the next attempt, unless canceled or nothing to continue from. */
+		} else if (!this->resumable || this->finishCanceled || this->committed == 0 || this->status == 416 || ret == DL_ERROR_CHECKSUM) {
+			if (access(this->outPath.c_str(), F_OK) == 0) deleteFile(this->outPath.c_str());
+			if (this->resumable) this->RemoveJournal();
+		}
+	}
+
+	return ret;
+}
+
+/*
+	Return, if the commit thread finalized the download, so the DownloadEngine can conclude it.
+*/
+bool DownloadContext::Finalized() {
+	LightLock_Lock(&this->ringLock);
+	const bool finalized = this->finalized;
+	LightLock_Unlock(&this->ringLock);
+	return finalized;
+}
+
+/*
+	Flip the state after the download got finalized, schedule a retry or notify the waiting side.
+*/
+Result DownloadContext::Conclude() {
+	this->Cleanup();
+	const Result ret = this->finishRet;
+
+	if (this->finishCanceled) this->state = TransferState::Canceled;
+	else this->state = (ret == 0) ? TransferState::Done : TransferState::Failed;
+
+	if (this->hasher && this->state == TransferState::Done) this->hasher->Finished(this->rangeStart); // Its file is closed, so everything is on the SD card.
+
+	this->stats.URL = this->url;
+	this->stats.Result = this->result;
+	this->stats.Status = this->status;
+	this->stats.Stalls = this->stalls;
+	this->stats.StallTime = this->stallTime;
+	this->stats.Time = time(nullptr);
+	Telemetry::Record(this->stats);
+
+	if (this->state == TransferState::Done && this->candidates.size() > 1) MirrorStats::Record(this->url, true, this->stats.AvgSpeed);
+	if (this->ScheduleRetry(ret)) return ret; // Not finished yet.
+
+	if (this->callback) this->callback(*this);
+	LightEvent_Signal(&this->finished);
+	return ret;
+}
+
+/*
+	Decide, if a failed attempt gets another one and prepare it.
+	Transient failures are retried after a backoff, everything, which may only affect one server, fails over to an untried mirror right away.
+
+	Result ret: The result of the attempt.
+*/
+bool DownloadContext::ScheduleRetry(Result ret) {
+	if (this->state != TransferState::Failed || this->canceled || QueueSystem::CancelCallback) return false;
+	if (this->sink) return false; // The consumer already got the data of this attempt.
+
+	this->failures++;
+	if (this->candidates.size() > 1) {
+		MirrorStats::Record(this->url, false, 0);
+		if (std::find(this->tried.begin(), this->tried.end(), this->url) == this->tried.end()) this->tried.push_back(this->url);
+	}
+
+	if (this->failures >= this->retry.MaxAttempts + this->mirrors.size()) return false;
+
+	/* Local problems stay the same, no matter where the file comes from. */
+	const bool local = ret == -3 || this->result == CURLE_WRITE_ERROR || this->result == CURLE_FAILED_INIT || this->result == CURLE_OUT_OF_MEMORY || this->result == CURLE_ABORTED_BY_CALLBACK;
+	const bool untried = this->candidates.size() > 1 && this->tried.size() < this->candidates.size(); // Without mirrors, the URL itself is never untried.
+
+	/* The part file does not fit the file on the server. Finish deleted it, so start over from zero once. */
+	const bool restart = this->resumable && this->status == 416 && !this->restarted;
+	if (restart) this->restarted = true;
+
+	if (local || (!untried && !restart && !this->retry.Retryable(this->result, this->status))) return false;
+
+	if (this->candidates.size() > 1) this->url = MirrorStats::Pick(this->candidates, this->tried);
+	const u32 delay = (untried || restart) ? 0 : this->retry.Delay(this->failures, this->retryAfter);
+
+	printf("Attempt %" PRIu32 " failed, retrying in %" PRIu32 " ms from:\n%s\n", this->failures, delay, this->url.c_str());
+	this->retryAt = osGetTime() + delay;
+	this->state = TransferState::Pending;
+	return true;
+}
+
+/*
+	Read the timings of the transfer from the handle. Has to be called before the handle gets released.
+*/
+void DownloadContext::CollectStats() {
+	if (!this->hnd) return;
+
+	curl_off_t dns = 0, connect = 0, tls = 0, ttfb = 0, total = 0; // Microseconds.
+	curl_easy_getinfo(this->hnd, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+	curl_easy_getinfo(this->hnd, CURLINFO_CONNECT_TIME_T, &connect);
+	curl_easy_getinfo(this->hnd, CURLINFO_APPCONNECT_TIME_T, &tls);
+	curl_easy_getinfo(this->hnd, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+	curl_easy_getinfo(this->hnd, CURLINFO_TOTAL_TIME_T, &total);
+
+	this->stats.DNS = dns / 1000;
+	this->stats.Connect = connect / 1000;
+	this->stats.TLS = tls / 1000;
+	this->stats.TTFB = ttfb / 1000;
+	this->stats.Total = total / 1000;
+
+	curl_easy_getinfo(this->hnd, CURLINFO_SPEED_DOWNLOAD_T, &this->stats.AvgSpeed);
+	curl_easy_getinfo(this->hnd, CURLINFO_SIZE_DOWNLOAD_T, &this->stats.Bytes);
+	curl_easy_getinfo(this->hnd, CURLINFO_REDIRECT_COUNT, &this->stats.Redirects);
+
+	if (this->stats.PeakSpeed < this->stats.AvgSpeed) this->stats.PeakSpeed = this->stats.AvgSpeed; // Too short to be sampled.
+}
+
+/*
+	Perform the download blocking on the calling thread, including the retries.
+*/
+Result DownloadContext::Perform() {
+	while (true) {
+		CURL *hnd = CurlPool::Acquire();
+		Result ret = this->Setup(hnd);
+
+		if (ret != 0) {
+			if (hnd) CurlPool::Release(hnd);
+			this->hnd = nullptr;
+			this->Finish(CURLE_FAILED_INIT);
+			return ret;
+		}
+
+		CURLcode res = curl_easy_perform(hnd);
+		this->CollectStats();
+		CurlPool::Release(hnd);
+		this->hnd = nullptr;
+
+		ret = this->Finish(res);
+		if (this->state != TransferState::Pending) return ret;
+
+		/* Wait out the backoff, unless the download gets canceled meanwhile. */
+		while (osGetTime() < this->retryAt) {
+			if (this->canceled || QueueSystem::CancelCallback) return this->Finish(CURLE_ABORTED_BY_CALLBACK);
+			svcSleepThread(50000000); // 50ms.
+		}
+	}
+}
+
+/*
+	Verify the checksums against a file, which got written some other way, e.g. in segments.
+
+	const std::string &file: Const Reference to the path of the file.
+*/
+bool DownloadContext::VerifyFile(const std::string &file) {
+	this->ResetChecksums();
+	return this->HashFile(file, -1) && this->VerifyChecksums();
+}
+
+/*
+	Add the start of a file to the checksums.
+
+	const std::string &file: Const Reference to the path of the file.
+	curl_off_t size: How much of it to hash. -1 for everything.
+*/
+bool DownloadContext::HashFile(const std::string &file, curl_off_t size) {
+	FILE *in = fopen(file.c_str(), "rb");
+	if (!in) return false;
+
+	std::vector<u8> buffer = BufferPool::Acquire(VERIFY_CHUNK_SIZE);
+	buffer.resize(VERIFY_CHUNK_SIZE);
+
+	size_t read = 0;
+	curl_off_t left = size;
+	while (left != 0 && (read = fread(buffer.data(), 1, (left > 0 && left < (curl_off_t)buffer.size()) ? left : buffer.size(), in)) > 0) {
+		this->UpdateChecksums((const char *)buffer.data(), read);
+		if (left > 0) left -= read;
+	}
+
+	const bool ok = !ferror(in) && left <= 0;
+	fclose(in);
+	BufferPool::Release(std::move(buffer));
+	return ok;
+}
+
+/*
+	Remember the validators of the response for the next conditional request.
+	Only call this, once the data got written to file.
+
+	const std::string &file: Const Reference to the local copy of the data.
+*/
+void DownloadContext::SaveValidators(const std::string &file) {
+	if (this->NotModified()) return; // The old validators are still valid.
+
+	struct stat st;
+	if (stat(file.c_str(), &st) != 0) return;
+
+	Validators validators;
+	validators.ETag = this->etag;
+	validators.LastModified = this->lastModified;
+	validators.File = file;
+	validators.Size = st.st_size;
+
+	ValidatorCache::Set(this->url, validators);
+}
@@ -0,0 +1,330 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "curlPool.hpp"
+#include "downloadEngine.hpp"
+
+#include <deque>
+
+static CURLM *multiHandle = nullptr;
+static Thread engineThread = nullptr;
+static LightLock engineLock;
+static LightEvent wakeEvent;
+static bool engineRuns = false;
+static int maxRunning = 4;
+
+static std::deque<std::shared_ptr<DownloadContext>> pending; // Guarded by engineLock.
+static std::vector<std::shared_ptr<DownloadContext>> running; // Only touched by the engine thread.
+static std::vector<std::shared_ptr<DownloadContext>> finishing; // Finalized by their commit threads. Only touched by the engine thread.
+
+/*
+	Called once a context is concluded. If it gets retried, it goes back to the pending ones.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the context.
+*/
+static void concluded(const std::shared_ptr<DownloadContext> &ctx) {
+	ctx->multi = nullptr; // The commit thread is gone now, so nothing wakes the engine up for it anymore.
+
+	if (ctx->state == TransferState::Pending && engineRuns) {
+		LightLock_Lock(&engineLock);
+		pending.push_back(ctx);
+		LightLock_Unlock(&engineLock);
+	}
+}
+
+/*
+	Finish a context. A file download waits in the finishing ones, until its commit thread wrote the rest and moved the file.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the context.
+	CURLcode result: The result of the transfer.
+*/
+static void finish(const std::shared_ptr<DownloadContext> &ctx, CURLcode result) {
+	ctx->Finish(result);
+
+	if (ctx->Finishing()) finishing.push_back(ctx);
+	else concluded(ctx);
+}
+
+/*
+	Remove a context from the multi handle and finish it.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the context.
+	CURLcode result: The result of the transfer.
+*/
+static void finishTransfer(const std::shared_ptr<DownloadContext> &ctx, CURLcode result) {
+	if (ctx->hnd) {
+		curl_multi_remove_handle(multiHandle, ctx->hnd);
+		ctx->CollectStats();
+		CurlPool::Release(ctx->hnd);
+		ctx->hnd = nullptr;
+	}
+
+	finish(ctx, ctx->canceled ? CURLE_ABORTED_BY_CALLBACK : result);
+}
+
+/*
+	Conclude the finishing contexts, which got finalized. Only the state gets flipped here, the SD card work is done already.
+
+	bool wait: Wait for all of them, instead of only taking the finalized ones.
+*/
+static void concludeFinished(bool wait) {
+	for (auto it = finishing.begin(); it != finishing.end();) {
+		if (!wait && !(*it)->Finalized()) {
+			++it;
+			continue;
+		}
+
+		std::shared_ptr<DownloadContext> ctx = *it;
+		it = finishing.erase(it);
+
+		ctx->Conclude();
+		concluded(ctx);
+	}
+}
+
+/*
+	Move pending contexts to the multi handle by priority, until the limit is reached.
+	Retries wait in the pending ones, until their backoff is over.
+*/
+static void startPending() {
+	while (true) {
+		const u64 now = osGetTime();
+		LightLock_Lock(&engineLock);
+
+		/* The most urgent one, which is ready, in the order they got added. Canceled ones are finished at once. */
+		auto next = pending.end();
+		for (auto it = pending.begin(); it != pending.end(); ++it) {
+			if ((*it)->canceled) {
+				next = it;
+				break;
+			}
+
+			if ((*it)->retryAt > now) continue;
+			if (next == pending.end() || (*it)->priority < (*next)->priority) next = it;
+		}
+
+		/* Interactive transfers don't wait for a free slot, the others pause for them instead. Speculative ones always leave a slot free. */
+		const int limit = (next != pending.end() && (*next)->priority == TransferPriority::Speculative && maxRunning > 1) ? maxRunning - 1 : maxRunning;
+		if (next == pending.end() || ((int)running.size() >= limit && !(*next)->canceled && (*next)->priority != TransferPriority::Interactive)) {
+			LightLock_Unlock(&engineLock);
+			break;
+		}
+
+		std::shared_ptr<DownloadContext> ctx = *next;
+		pending.erase(next);
+		LightLock_Unlock(&engineLock);
+
+		if (ctx->canceled) {
+			finishTransfer(ctx, CURLE_ABORTED_BY_CALLBACK);
+			continue;
+		}
+
+		ctx->multi = multiHandle; // Before the first chunk arrives, so it pauses instead of blocking the engine.
+		if (ctx->Setup(CurlPool::Acquire()) != 0 || curl_multi_add_handle(multiHandle, ctx->hnd) != CURLM_OK) {
+			if (ctx->hnd) {
+				CurlPool::Release(ctx->hnd);
+				ctx->hnd = nullptr;
+			}
+
+			finish(ctx, CURLE_FAILED_INIT);
+			continue;
+		}
+
+		running.push_back(ctx);
+	}
+}
+
+/*
+	The engine thread, driving all running transfers.
+*/
+static void engineThreadFunc(void *arg) {
+	while (engineRuns) {
+		startPending();
+
+		if (running.empty() && finishing.empty()) {
+			LightLock_Lock(&engineLock);
+			const bool waiting = !pending.empty(); // Retries, which are backing off.
+			LightLock_Unlock(&engineLock);
+
+			if (waiting) LightEvent_WaitTimeout(&wakeEvent, 100000000); // 100ms.
+			else LightEvent_Wait(&wakeEvent);
+			continue;
+		}
+
+		int stillRunning = 0;
+		curl_multi_perform(multiHandle, &stillRunning);
+
+		CURLMsg *msg = nullptr;
+		int msgsLeft = 0;
+
+		while ((msg = curl_multi_info_read(multiHandle, &msgsLeft))) {
+			if (msg->msg != CURLMSG_DONE) continue;
+
+			for (auto it = running.begin(); it != running.end(); ++it) {
+				if ((*it)->hnd == msg->easy_handle) {
+					std::shared_ptr<DownloadContext> ctx = *it;
+					running.erase(it);
+					finishTransfer(ctx, msg->data.result);
+					break;
+				}
+			}
+		}
+
+		concludeFinished(false);
+
+		/* Paused transfers only get a progress call about once a second, so resume them here in time. The commit threads wake the poll up. */
+		for (const std::shared_ptr<DownloadContext> &ctx : running) ctx->Resume();
+
+		if (!running.empty() || !finishing.empty()) curl_multi_poll(multiHandle, nullptr, 0, 100, nullptr);
+	}
+}
+
+/*
+	Initialize the DownloadEngine.
+
+	int maxTransfers: The amount of transfers, which may run at the same time.
+*/
+void DownloadEngine::Init(int maxTransfers) {
+	if (engineRuns) return;
+
+	multiHandle = curl_multi_init();
+	if (!multiHandle) return;
+
+	maxRunning = maxTransfers > 0 ? maxTransfers : 1;
+	curl_multi_setopt(multiHandle, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)maxRunning + 1); // One spare for interactive transfers.
+	curl_multi_setopt(multiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+	LightLock_Init(&engineLock);
+	LightEvent_Init(&wakeEvent, RESET_ONESHOT);
+	engineRuns = true;
+
+	s32 prio = 0;
+	svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+	engineThread = threadCreate(engineThreadFunc, nullptr, 64 * 1024, prio - 1, -2, false);
+
+	if (!engineThread) {
+		engineRuns = false;
+		curl_multi_cleanup(multiHandle);
+		multiHandle = nullptr;
+	}
+}
+
+/*
+	Exit the DownloadEngine and cancel everything, that is still going on.
+*/
+void DownloadEngine::Exit() {
+	if (!engineRuns) return;
+
+	engineRuns = false;
+	curl_multi_wakeup(multiHandle);
+	LightEvent_Signal(&wakeEvent);
+
+	threadJoin(engineThread, U64_MAX);
+	threadFree(engineThread);
+	engineThread = nullptr;
+
+	for (const std::shared_ptr<DownloadContext> &ctx : running) {
+		ctx->canceled = true;
+		finishTransfer(ctx, CURLE_ABORTED_BY_CALLBACK);
+	}
+
+	running.clear();
+
+	for (const std::shared_ptr<DownloadContext> &ctx : finishing) ctx->canceled = true; // No retries anymore.
+	concludeFinished(true); // Joins their commit threads.
+
+	for (const std::shared_ptr<DownloadContext> &ctx : pending) {
+		ctx->canceled = true;
+		finishTransfer(ctx, CURLE_ABORTED_BY_CALLBACK);
+	}
+
+	pending.clear();
+
+	curl_multi_cleanup(multiHandle);
+	multiHandle = nullptr;
+}
+
+/*
+	Add a prepared context to the DownloadEngine.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the context.
+*/
+std::shared_ptr<DownloadContext> DownloadEngine::Add(const std::shared_ptr<DownloadContext> &ctx) {
+	if (!engineRuns) {
+		ctx->Finish(CURLE_FAILED_INIT);
+		return ctx;
+	}
+
+	LightLock_Lock(&engineLock);
+	pending.push_back(ctx);
+	LightLock_Unlock(&engineLock);
+
+	curl_multi_wakeup(multiHandle);
+	LightEvent_Signal(&wakeEvent);
+	return ctx;
+}
+
+/*
+	Add a download to the DownloadEngine.
+
+	const std::string &url: Const Reference to the URL.
+	const std::string &path: Const Reference to the output path. Empty for downloading into RAM.
+	std::function<void(DownloadContext &)> callback: Called from the engine thread, once the download finished.
+*/
+std::shared_ptr<DownloadContext> DownloadEngine::Add(const std::string &url, const std::string &path, std::function<void(DownloadContext &)> callback) {
+	std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(url, path);
+	ctx->callback = callback;
+
+	return DownloadEngine::Add(ctx);
+}
+
+/*
+	Cancel a download. The engine thread finishes it with TransferState::Canceled.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the context.
+*/
+void DownloadEngine::Cancel(const std::shared_ptr<DownloadContext> &ctx) {
+	if (!ctx) return;
+
+	ctx->canceled = true;
+	if (engineRuns) {
+		curl_multi_wakeup(multiHandle);
+		LightEvent_Signal(&wakeEvent);
+	}
+}
+
+/*
+	Wait until a download finished.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the context.
+	@return True, if the download succeeded.
+*/
+bool DownloadEngine::Wait(const std::shared_ptr<DownloadContext> &ctx) {
+	if (!ctx) return false;
+
+	LightEvent_Wait(&ctx->finished);
+	return ctx->state == TransferState::Done;
+}
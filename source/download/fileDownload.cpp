@@ -0,0 +1,802 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "download.hpp"
+#include "downloadCache.hpp"
+#include "downloadEngine.hpp"
+#include "files.hpp"
+#include "json.hpp"
+#include "queueSystem.hpp"
+#include "scriptUtils.hpp"
+
+#include <3ds.h>
+#include <algorithm>
+#include <curl/curl.h>
+#include <dirent.h>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+extern curl_off_t downloadTotal, downloadNow, downloadSpeed;
+
+#define _RELEASE_CACHE_PATH "sdmc:/3ds/Universal-Updater/releases.json"
+
+#define SEGMENT_COUNT 4 // Parallel connections for a large file.
+#define SEGMENT_MIN_SIZE 0x800000 // Smaller segments than 8 MiB aren't worth another connection.
+#define SCREENSHOT_CACHE_QUOTA 0x1000000 // The screenshot cache is kept below 16 MiB.
+
+/*
+	Download a large file in segments over parallel connections, if the server supports ranges.
+	Returns false, if it has to go over a single connection instead.
+	A HEAD request decides: the server has to tell the length and accept ranges, and the file has to be large enough for at least two segments.
+	The checksums are calculated in order, while the segments commit.
+
+	const std::string &url: The download URL.
+	const std::string &path: Where to place the file.
+	const std::string &sha256: The expected SHA-256 as hex. (Empty to skip)
+	const std::string &crc32: The expected CRC32 as hex. (Empty to skip)
+	const std::vector<std::string> &mirrors: Const Reference to other URLs of the file.
+	Result &ret: Output for the result.
+*/
+static bool downloadSegmented(const std::string &url, const std::string &path, const std::string &sha256, const std::string &crc32, const std::vector<std::string> &mirrors, Result &ret) {
+	if (DownloadContext::HasJournal(path)) return false; // Continuing the single connection is cheaper.
+
+	DownloadContext probe(url);
+	probe.headOnly = true;
+	probe.mirrors = mirrors;
+	probe.priority = TransferPriority::Bulk;
+	probe.retry.MaxAttempts = 1;
+
+	if (probe.Perform() != 0 || !probe.acceptRanges || probe.length < SEGMENT_MIN_SIZE * 2) return false;
+
+	const curl_off_t length = probe.length;
+	const int count = std::min((curl_off_t)SEGMENT_COUNT, length / SEGMENT_MIN_SIZE);
+
+	/* All segments write into the same file, so give it its full size up front. */
+	u64 reservation = 0;
+	if (!FreeSpace::Reserve(length, reservation)) return false;
+
+	for (size_t slashpos = path.find('/', 1); slashpos != std::string::npos; slashpos = path.find('/', slashpos + 1)) {
+		mkdir(path.substr(0, slashpos).c_str(), 0777);
+	}
+
+	FILE *out = fopen(path.c_str(), "wb");
+	const bool allocated = out && ftruncate(fileno(out), length) == 0;
+	if (out) fclose(out);
+
+	if (!allocated) {
+		FreeSpace::Release(reservation);
+		if (access(path.c_str(), F_OK) == 0) deleteFile(path.c_str());
+		return false;
+	}
+
+	FreeSpace::Commit(length, reservation);
+	printf("Downloading in %d segments.\n", count);
+
+	std::shared_ptr<SegmentHasher> hasher = nullptr;
+	if (sha256 != "" || crc32 != "") hasher = std::make_shared<SegmentHasher>(path, sha256, crc32);
+
+	std::vector<std::shared_ptr<DownloadContext>> segments;
+	for (int i = 0; i < count; i++) {
+		std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(url, path);
+		ctx->mirrors = mirrors;
+		ctx->priority = TransferPriority::Bulk;
+		ctx->rangeStart = (length / count) * i;
+		ctx->rangeEnd = (i == count - 1) ? length - 1 : (length / count) * (i + 1) - 1;
+		ctx->hasher = hasher;
+		if (hasher) hasher->Add(ctx->rangeStart, ctx->rangeEnd);
+		segments.push_back(ctx);
+	}
+
+	for (const std::shared_ptr<DownloadContext> &segment : segments) DownloadEngine::Add(segment); // The hasher needs to know all segments first.
+
+	const u64 startTime = osGetTime();
+	bool done = false;
+
+	while (!done) {
+		curl_off_t now = 0;
+		done = true;
+
+		for (const std::shared_ptr<DownloadContext> &segment : segments) {
+			if (QueueSystem::CancelCallback) DownloadEngine::Cancel(segment);
+
+			if (segment->state == TransferState::Pending || segment->state == TransferState::Running) done = false;
+			now += segment->now;
+		}
+
+		downloadTotal = length;
+		downloadNow = now;
+
+		const u64 elapsed = osGetTime() - startTime;
+		if (elapsed > 0) downloadSpeed = (now * 1000) / elapsed;
+
+		if (!done) svcSleepThread(50000000); // 50ms.
+	}
+
+	ret = 0;
+	for (const std::shared_ptr<DownloadContext> &segment : segments) {
+		if (!DownloadEngine::Wait(segment) && ret == 0) ret = -segment->result;
+	}
+
+	if (ret == 0 && !QueueSystem::CancelCallback && hasher && !hasher->Verify()) ret = DL_ERROR_CHECKSUM;
+
+	/* Nothing to continue from, so drop it and let a single connection start over. */
+	if (ret != 0 || QueueSystem::CancelCallback) {
+		deleteFile(path.c_str());
+		FreeSpace::Sync(); // The preallocated file is gone.
+		return QueueSystem::CancelCallback;
+	}
+
+	DownloadCache::Store(url, sha256, probe.etag, probe.lastModified, path);
+	return true;
+}
+
+/*
+	Download a file.
+
+	const std::string &url: The download URL.
+	const std::string &path: Where to place the file.
+	const std::string &sha256: The expected SHA-256 as hex. (Empty to skip)
+	const std::string &crc32: The expected CRC32 as hex. (Empty to skip)
+	const std::vector<std::string> &mirrors: Const Reference to other URLs of the file, used if url fails.
+*/
+Result downloadToFile(const std::string &url, const std::string &path, const std::string &sha256, const std::string &crc32, const std::vector<std::string> &mirrors) {
+	/* A file with a known content doesn't need the network, if it got cached before. */
+	if (sha256 != "" && DownloadCache::Restore(url, sha256, path)) return 0;
+
+	/* Without Wi-Fi, the last cached copy is the best there is. */
+	if (!checkWifiStatus()) return (sha256 == "" && DownloadCache::Restore(url, "", path)) ? 0 : -1; // NO WIFI.
+
+	downloadTotal = 1;
+	downloadNow = 0;
+	downloadSpeed = 0;
+
+	printf("Downloading from:\n%s\nto:\n%s\n", url.c_str(), path.c_str());
+
+	DownloadContext ctx(url, path);
+	ctx.reportProgress = true;
+	ctx.resumable = true;
+	ctx.sha256 = sha256;
+	ctx.crc32 = crc32;
+	ctx.mirrors = mirrors;
+	ctx.priority = TransferPriority::Bulk;
+	ctx.revalidate = DownloadCache::Lookup(url);
+	ctx.conditional = ctx.revalidate.File != ""; // Only ask, if the cached copy is still up to date.
+
+	/* Large files go over several connections, if the server allows it. */
+	Result ret = 0;
+	if (!ctx.conditional && downloadSegmented(url, path, sha256, crc32, mirrors, ret)) return QueueSystem::CancelCallback ? 0 : ret;
+	const bool corrupt = ret == DL_ERROR_CHECKSUM; // The segments count as the first try then.
+
+	ret = ctx.Perform();
+
+	/* Unchanged, so take the cached copy. If that vanished meanwhile, download it after all. */
+	if (ret == 0 && ctx.NotModified() && !DownloadCache::Restore(url, "", path)) {
+		ctx.conditional = false;
+		ret = ctx.Perform();
+	}
+
+	/* The corrupt data got dropped, so try once more from scratch. */
+	if (ret == DL_ERROR_CHECKSUM && !corrupt && !QueueSystem::CancelCallback) ret = ctx.Perform();
+
+	if (QueueSystem::CancelCallback) return 0;
+	if (ret == 0 && !ctx.NotModified()) DownloadCache::Store(url, sha256, ctx.etag, ctx.lastModified, path);
+	return ret;
+}
+
+/*
+	Download multiple files at once through the DownloadEngine.
+
+	const std::vector<FileDownload> &files: Const Reference to the downloads.
+*/
+Result downloadToFiles(const std::vector<FileDownload> &files) {
+	std::vector<FileDownload> downloads;
+	const bool online = checkWifiStatus();
+
+	/* Files with a known content don't need the network, if they got cached before. Without Wi-Fi, the last cached copy is used. */
+	for (const FileDownload &file : files) {
+		if (file.SHA256 != "" && DownloadCache::Restore(file.URL, file.SHA256, file.Output)) continue;
+		if (!online && file.SHA256 == "" && DownloadCache::Restore(file.URL, "", file.Output)) continue;
+
+		downloads.push_back(file);
+	}
+
+	if (downloads.empty()) return 0;
+	if (!online) return -1; // NO WIFI.
+
+	downloadTotal = 1;
+	downloadNow = 0;
+	downloadSpeed = 0;
+
+	std::vector<std::shared_ptr<DownloadContext>> transfers;
+	for (const FileDownload &file : downloads) {
+		printf("Downloading from:\n%s\nto:\n%s\n", file.URL.c_str(), file.Output.c_str());
+		std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(file.URL, file.Output);
+		ctx->resumable = true;
+		ctx->sha256 = file.SHA256;
+		ctx->crc32 = file.CRC32;
+		ctx->mirrors = file.Mirrors;
+		ctx->priority = TransferPriority::Bulk;
+		ctx->revalidate = DownloadCache::Lookup(file.URL);
+		ctx->conditional = ctx->revalidate.File != "";
+		transfers.push_back(DownloadEngine::Add(ctx));
+	}
+
+	const u64 startTime = osGetTime();
+	bool done = false;
+
+	/* Report the progress of all transfers together, until all are finished. */
+	while (!done) {
+		curl_off_t total = 0, now = 0;
+		done = true;
+
+		for (const std::shared_ptr<DownloadContext> &transfer : transfers) {
+			if (QueueSystem::CancelCallback) DownloadEngine::Cancel(transfer);
+
+			if (transfer->state == TransferState::Pending || transfer->state == TransferState::Running) done = false;
+			total += transfer->total;
+			now += transfer->now;
+		}
+
+		downloadTotal = total;
+		downloadNow = now;
+
+		const u64 elapsed = osGetTime() - startTime;
+		if (elapsed > 0) downloadSpeed = (now * 1000) / elapsed;
+
+		if (!done) svcSleepThread(50000000); // 50ms.
+	}
+
+	if (QueueSystem::CancelCallback) return 0;
+
+	for (size_t i = 0; i < transfers.size(); i++) {
+		const FileDownload &file = downloads[i];
+		if (!DownloadEngine::Wait(transfers[i])) return -transfers[i]->result;
+
+		/* Unchanged, so take the cached copy. If that vanished meanwhile, download it after all. */
+		if (transfers[i]->NotModified()) {
+			if (!DownloadCache::Restore(file.URL, "", file.Output)) {
+				const Result ret = downloadToFile(file.URL, file.Output, file.SHA256, file.CRC32, file.Mirrors);
+				if (ret != 0) return ret;
+			}
+
+		} else DownloadCache::Store(file.URL, file.SHA256, transfers[i]->etag, transfers[i]->lastModified, file.Output);
+	}
+
+	return 0;
+}
+
+#define RELEASE_CACHE_TTL 60000 // Trust the cached release metadata for a minute, before asking GitHub again.
+
+/* The assets of a release, as seen by the releases API. */
+struct ReleaseAssets {
+	std::vector<std::pair<std::string, std::string>> Assets; // Name and download URL.
+	std::string ETag = "", LastModified = "";
+	u64 Checked = 0; // When GitHub was asked last.
+	bool Valid = false;
+};
+
+static std::map<std::string, ReleaseAssets> releaseCache; // Keyed by the API URL, which includes the prerelease mode.
+static bool releaseCacheLoaded = false;
+static LightLock releaseLock = 1; // Unlocked.
+
+/*
+	Load the release metadata of the last sessions, so releases can be resolved without Wi-Fi.
+	Call with releaseLock held.
+*/
+static void loadReleaseCache() {
+	if (releaseCacheLoaded) return;
+	releaseCacheLoaded = true;
+
+	FILE *file = fopen(_RELEASE_CACHE_PATH, "rt");
+	if (!file) return;
+
+	const nlohmann::json cacheJson = nlohmann::json::parse(file, nullptr, false);
+	fclose(file);
+	if (!cacheJson.is_object()) return;
+
+	for (auto it = cacheJson.begin(); it != cacheJson.end(); ++it) {
+		const nlohmann::json &entry = it.value();
+		if (!entry.is_object() || !entry.contains("assets") || !entry["assets"].is_array()) continue;
+
+		ReleaseAssets release;
+		for (const auto &asset : entry["assets"]) {
+			if (asset.is_array() && asset.size() == 2 && asset[0].is_string() && asset[1].is_string()) release.Assets.push_back({ asset[0], asset[1] });
+		}
+
+		if (entry.contains("etag") && entry["etag"].is_string()) release.ETag = entry["etag"];
+		if (entry.contains("lastModified") && entry["lastModified"].is_string()) release.LastModified = entry["lastModified"];
+		release.Valid = true; // Checked stays 0, so it gets revalidated once online.
+
+		releaseCache[it.key()] = release;
+	}
+}
+
+/*
+	Write the release metadata to the SD card.
+	Call with releaseLock held.
+*/
+static void saveReleaseCache() {
+	nlohmann::json cacheJson = nlohmann::json::object();
+
+	for (const auto &cached : releaseCache) {
+		if (!cached.second.Valid) continue;
+
+		cacheJson[cached.first] = {
+			{ "assets", cached.second.Assets },
+			{ "etag", cached.second.ETag },
+			{ "lastModified", cached.second.LastModified }
+		};
+	}
+
+	FILE *file = fopen(_RELEASE_CACHE_PATH, "w");
+	if (!file) return;
+
+	const std::string dump = cacheJson.dump();
+	fwrite(dump.c_str(), 1, dump.size(), file);
+	fclose(file);
+}
+
+/*
+	SAX handler, which only keeps the asset names and URLs of the first release and stops right after it.
+	That skips the release bodies and all older releases of the list.
+*/
+struct ReleaseSax {
+	std::vector<std::pair<std::string, std::string>> &assets;
+	int depth = 0, releaseDepth = 0, assetsDepth = 0; // 0 while not inside.
+	std::string lastKey = "", name = "", url = "";
+	bool done = false;
+
+	ReleaseSax(std::vector<std::pair<std::string, std::string>> &assets) : assets(assets) { };
+
+	bool null() { return true; };
+	bool boolean(bool) { return true; };
+	bool number_integer(nlohmann::json::number_integer_t) { return true; };
+	bool number_unsigned(nlohmann::json::number_unsigned_t) { return true; };
+	bool number_float(nlohmann::json::number_float_t, const std::string &) { return true; };
+	bool binary(nlohmann::json::binary_t &) { return true; };
+	bool key(std::string &val) { this->lastKey = val; return true; };
+	bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &) { return false; };
+
+	bool string(std::string &val) {
+		if (this->assetsDepth && this->depth == this->assetsDepth + 1) {
+			if (this->lastKey == "name") this->name = val;
+			else if (this->lastKey == "browser_download_url") this->url = val;
+		}
+
+		return true;
+	};
+
+	bool start_object(std::size_t) {
+		this->depth++;
+		if (!this->releaseDepth) this->releaseDepth = this->depth; // The first object is the release, no matter if in a list.
+		return true;
+	};
+
+	bool end_object() {
+		if (this->assetsDepth && this->depth == this->assetsDepth + 1) {
+			if (this->name != "" && this->url != "") this->assets.push_back({ this->name, this->url });
+			this->name = "", this->url = "";
+		}
+
+		/* The first release is complete, nothing else is needed. */
+		if (this->depth-- == this->releaseDepth) {
+			this->done = true;
+			return false;
+		}
+
+		return true;
+	};
+
+	bool start_array(std::size_t) {
+		this->depth++;
+		if (this->releaseDepth && this->depth == this->releaseDepth + 1 && this->lastKey == "assets") this->assetsDepth = this->depth;
+		return true;
+	};
+
+	bool end_array() {
+		if (this->depth-- == this->assetsDepth) this->assetsDepth = 0;
+		return true;
+	};
+};
+
+/*
+	Parse the assets of a releases API response.
+
+	const DownloadContext &ctx: Const Reference to the response.
+	ReleaseAssets &release: Reference, where to store the assets.
+*/
+static void parseReleaseAssets(const DownloadContext &ctx, ReleaseAssets &release) {
+	release = ReleaseAssets();
+
+	ReleaseSax handler(release.Assets);
+	const bool parsed = nlohmann::json::sax_parse(ctx.data.begin(), ctx.data.end(), &handler);
+
+	/* An empty list is fine too, then all were prereleases and those are being ignored. */
+	release.Valid = handler.done || parsed;
+	if (!release.Valid) return;
+
+	release.ETag = ctx.etag;
+	release.LastModified = ctx.lastModified;
+}
+
+/*
+	Return the releases API URL of a repository, which only lists the newest release.
+
+	const std::string &url: Const Reference to the URL. (https://github.com/Owner/Repo)
+	bool includePrereleases: If including Pre-Releases.
+*/
+static std::string releaseApiURL(const std::string &url, bool includePrereleases) {
+	std::regex parseUrl("\\/([^\\/]+)\\/([^\\/]+)\\/?$"); // The owner and repository are the last two parts, no matter the host.
+	std::smatch result;
+	regex_search(url, result, parseUrl);
+
+	std::string repoOwner = result[1].str(), repoName = result[2].str();
+
+	std::stringstream apiurlStream;
+	apiurlStream << GITHUB_API_URL "/repos/" << repoOwner << "/" << repoName << (includePrereleases ? "/releases?per_page=1" : "/releases/latest"); // Only the newest release is used.
+	return apiurlStream.str();
+}
+
+/*
+	Return the cached release metadata of an API URL, if there is any.
+
+	const std::string &apiurl: Const Reference to the API URL.
+	ReleaseAssets &release: Reference, where to store the release.
+*/
+static bool cachedRelease(const std::string &apiurl, ReleaseAssets &release) {
+	LightLock_Lock(&releaseLock);
+	loadReleaseCache();
+	auto cached = releaseCache.find(apiurl);
+	const bool found = cached != releaseCache.end();
+	release = found ? cached->second : ReleaseAssets();
+	LightLock_Unlock(&releaseLock);
+
+	return found;
+}
+
+/*
+	Take the response of a releases API request over into the cache.
+
+	const std::string &apiurl: Const Reference to the API URL.
+	const DownloadContext &ctx: Const Reference to the finished request.
+	ReleaseAssets &release: Reference to the cached release, which gets updated.
+*/
+static void updateRelease(const std::string &apiurl, const DownloadContext &ctx, ReleaseAssets &release) {
+	if (ctx.result == CURLE_OK && !ctx.NotModified()) parseReleaseAssets(ctx, release);
+	release.Checked = osGetTime();
+
+	LightLock_Lock(&releaseLock);
+	releaseCache[apiurl] = release;
+	if (ctx.status == 200) saveReleaseCache(); // Only new metadata is worth the write.
+	LightLock_Unlock(&releaseLock);
+}
+
+/*
+	Return the download URL of the first asset matching the pattern, or an empty string.
+
+	const ReleaseAssets &release: Const Reference to the release.
+	const std::string &asset: Const Reference to the Asset. (File.filetype)
+*/
+static std::string findAsset(const ReleaseAssets &release, const std::string &asset) {
+	for (const std::pair<std::string, std::string> &releaseAsset : release.Assets) {
+		if (ScriptUtils::matchPattern(asset, releaseAsset.first)) return releaseAsset.second;
+	}
+
+	return "";
+}
+
+/*
+	Look up the download URL of a GitHub Release asset.
+	The release metadata is kept on the SD card and revalidated with its ETag, so several steps using the same release only fetch it once.
+	Without Wi-Fi, the last known release is used.
+
+	const std::string &url: Const Reference to the URL. (https://github.com/Owner/Repo)
+	const std::string &asset: Const Reference to the Asset. (File.filetype)
+	bool includePrereleases: If including Pre-Releases.
+	std::string &assetUrl: Reference, where to store the URL of the asset.
+*/
+Result getReleaseAssetURL(const std::string &url, const std::string &asset, bool includePrereleases, std::string &assetUrl) {
+	const std::string apiurl = releaseApiURL(url, includePrereleases);
+
+	ReleaseAssets release;
+	const bool found = cachedRelease(apiurl, release);
+
+	const bool online = checkWifiStatus();
+	if (!found && !online) return -1; // NO WIFI.
+
+	if (online && (!found || osGetTime() - release.Checked >= RELEASE_CACHE_TTL)) {
+		printf("Crafted API url:\n%s\n", apiurl.c_str());
+
+		DownloadContext ctx(apiurl);
+		ctx.conditional = found;
+		ctx.revalidate.ETag = release.ETag;
+		ctx.revalidate.LastModified = release.LastModified;
+
+		if (ctx.Perform() != 0) {
+			printf("Error in:\ncurl\n");
+			if (!found) return -1;
+		}
+
+		updateRelease(apiurl, ctx, release);
+	}
+
+	assetUrl = findAsset(release, asset);
+
+	if (assetUrl.empty() || !release.Valid) return DL_ERROR_GIT;
+	return 0;
+}
+
+/*
+	Download a file of a GitHub Release.
+
+	const std::string &url: Const Reference to the URL. (https://github.com/Owner/Repo)
+	const std::string &asset: Const Reference to the Asset. (File.filetype)
+	const std::string &path: Const Reference, where to store. (sdmc:/File.filetype)
+	bool includePrereleases: If including Pre-Releases.
+	const std::string &sha256: The expected SHA-256 as hex. (Empty to skip)
+	const std::string &crc32: The expected CRC32 as hex. (Empty to skip)
+*/
+Result downloadFromRelease(const std::string &url, const std::string &asset, const std::string &path, bool includePrereleases, const std::string &sha256, const std::string &crc32) {
+	std::string assetUrl;
+	printf("Downloading latest release from:\n%s\nLooking for asset with matching name:\n%s\n", url.c_str(), asset.c_str());
+
+	const Result ret = getReleaseAssetURL(url, asset, includePrereleases, assetUrl);
+	if (ret != 0) return ret;
+
+	return downloadToFile(assetUrl, path, sha256, crc32);
+}
+
+struct CachedScreenshot {
+	time_t Written = 0;
+	u64 Size = 0;
+};
+
+static std::map<std::string, CachedScreenshot> cachedScreenshots; // The screenshot cache by path.
+static u64 cachedScreenshotsSize = 0;
+static bool cachedScreenshotsScanned = false;
+static LightLock screenshotLock = 1; // Initialized LightLock.
+
+/*
+	Account a written screenshot and drop the oldest ones, until the cache fits its quota. Has to be called with the lock held.
+	The directory is only scanned once, afterwards the cache is tracked in memory.
+
+	const std::string &path: Const Reference to the written screenshot.
+	u64 size: The size of it.
+*/
+static void trimScreenshots(const std::string &path, u64 size) {
+	if (!cachedScreenshotsScanned) {
+		cachedScreenshotsScanned = true;
+
+		DIR *dir = opendir(_SCREENSHOT_CACHE_PATH);
+		if (dir) {
+			struct dirent *ent;
+			struct stat st;
+
+			while ((ent = readdir(dir))) {
+				const std::string file = std::string(_SCREENSHOT_CACHE_PATH) + ent->d_name;
+				if (ent->d_type == DT_DIR || stat(file.c_str(), &st) != 0) continue;
+
+				cachedScreenshots[file] = { st.st_mtime, (u64)st.st_size };
+				cachedScreenshotsSize += st.st_size;
+			}
+
+			closedir(dir);
+		}
+	}
+
+	auto it = cachedScreenshots.find(path);
+	if (it != cachedScreenshots.end()) cachedScreenshotsSize -= std::min(cachedScreenshotsSize, it->second.Size);
+
+	cachedScreenshots[path] = { time(nullptr), size };
+	cachedScreenshotsSize += size;
+
+	/* Oldest first out, but never the one just written. */
+	while (cachedScreenshotsSize > SCREENSHOT_CACHE_QUOTA && cachedScreenshots.size() > 1) {
+		auto oldest = cachedScreenshots.end();
+
+		for (auto entry = cachedScreenshots.begin(); entry != cachedScreenshots.end(); ++entry) {
+			if (entry->first != path && (oldest == cachedScreenshots.end() || entry->second.Written < oldest->second.Written)) oldest = entry;
+		}
+
+		deleteFile(oldest->first.c_str());
+		cachedScreenshotsSize -= std::min(cachedScreenshotsSize, oldest->second.Size);
+		cachedScreenshots.erase(oldest);
+	}
+}
+
+/*
+	Write a downloaded screenshot to the screenshot cache.
+
+	DownloadContext &ctx: Reference to the finished download.
+	const std::string &path: Const Reference to the cache path.
+*/
+static void saveScreenshot(DownloadContext &ctx, const std::string &path) {
+	if (FreeSpace::Available() < ctx.data.size() || ctx.data.size() > SCREENSHOT_CACHE_QUOTA) return;
+
+	LightLock_Lock(&screenshotLock);
+
+	FILE *out = fopen(path.c_str(), "wb");
+	bool written = false;
+
+	if (out) {
+		written = fwrite(ctx.data.data(), 1, ctx.data.size(), out) == ctx.data.size();
+		fclose(out);
+
+		if (written) trimScreenshots(path, ctx.data.size());
+		else deleteFile(path.c_str());
+	}
+
+	LightLock_Unlock(&screenshotLock);
+	if (written) ctx.SaveValidators(path);
+}
+
+/*
+	Fetch the data of a screenshot.
+	Screenshots are kept on the SD card and revalidated, so they also show up without Wi-Fi, once seen.
+
+	const std::string &URL: Const Reference to the URL of the screenshot.
+	std::vector<u8> &data: Output for the image file.
+*/
+bool FetchScreenshotData(const std::string &URL, std::vector<u8> &data) {
+	if (URL == "") return false;
+
+	const std::string path = _SCREENSHOT_CACHE_PATH + DownloadCache::Name(URL);
+
+	if (checkWifiStatus()) {
+		std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(URL);
+		ctx->priority = TransferPriority::Interactive; // The user is waiting for it, so the queue pauses meanwhile.
+		ctx->conditional = true;
+
+		DownloadEngine::Add(ctx);
+		if (!DownloadEngine::Wait(ctx)) {
+			printf("Error in:\ncurl\n");
+
+		} else if (!ctx->NotModified()) {
+			saveScreenshot(*ctx, path);
+			data.swap(ctx->data);
+			return true;
+		}
+	}
+
+	/* Unchanged, without Wi-Fi or failed, so take the local copy, if there is one. */
+	FILE *in = fopen(path.c_str(), "rb");
+	if (!in) return false;
+
+	fseek(in, 0, SEEK_END);
+	const long size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+
+	data.resize(size > 0 ? size : 0);
+	const bool read = size > 0 && fread(data.data(), 1, data.size(), in) == data.size();
+	fclose(in);
+
+	return read;
+}
+
+static std::vector<std::shared_ptr<DownloadContext>> prefetches; // Guarded by prefetchLock.
+static LightLock prefetchLock = 1; // Unlocked.
+
+/*
+	Hand a speculative transfer to the DownloadEngine and keep track of it, so it can be canceled.
+	Those only run, if nothing else wants the slot, and pause for any other transfer.
+
+	const std::shared_ptr<DownloadContext> &ctx: Const Reference to the transfer.
+*/
+static void addPrefetch(const std::shared_ptr<DownloadContext> &ctx) {
+	ctx->priority = TransferPriority::Speculative;
+	ctx->retry.MaxAttempts = 1; // Not worth a retry.
+
+	LightLock_Lock(&prefetchLock);
+	prefetches.erase(std::remove_if(prefetches.begin(), prefetches.end(), [](const std::shared_ptr<DownloadContext> &prefetch) {
+		return prefetch->state != TransferState::Pending && prefetch->state != TransferState::Running;
+	}), prefetches.end());
+
+	prefetches.push_back(DownloadEngine::Add(ctx));
+	LightLock_Unlock(&prefetchLock);
+}
+
+/*
+	Open a connection to the host of an URL ahead, so a following download can reuse it and its TLS session.
+	Redirects get followed, so those hosts get warmed up as well.
+
+	const std::string &URL: Const Reference to the URL.
+*/
+void PrefetchConnection(const std::string &URL) {
+	std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(URL);
+	ctx->headOnly = true;
+	addPrefetch(ctx);
+}
+
+/*
+	Resolve the asset URL of a GitHub Release ahead and open a connection to it.
+
+	const std::string &url: Const Reference to the URL. (https://github.com/Owner/Repo)
+	const std::string &asset: Const Reference to the Asset. (File.filetype)
+	bool includePrereleases: If including Pre-Releases.
+*/
+void PrefetchRelease(const std::string &url, const std::string &asset, bool includePrereleases) {
+	const std::string apiurl = releaseApiURL(url, includePrereleases);
+
+	ReleaseAssets release;
+	const bool found = cachedRelease(apiurl, release);
+
+	/* Still fresh, so only the asset host is left. */
+	if (found && osGetTime() - release.Checked < RELEASE_CACHE_TTL) {
+		const std::string assetUrl = findAsset(release, asset);
+		if (assetUrl != "") PrefetchConnection(assetUrl);
+		return;
+	}
+
+	std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(apiurl);
+	ctx->conditional = found;
+	ctx->revalidate.ETag = release.ETag;
+	ctx->revalidate.LastModified = release.LastModified;
+
+	ctx->callback = [apiurl, asset, release, found](DownloadContext &ctx) mutable {
+		if (ctx.canceled || (ctx.result != CURLE_OK && !found)) return;
+		updateRelease(apiurl, ctx, release);
+
+		const std::string assetUrl = findAsset(release, asset);
+		if (assetUrl != "") PrefetchConnection(assetUrl);
+	};
+
+	addPrefetch(ctx);
+}
+
+/*
+	Fetch a screenshot ahead into the screenshot cache, so FetchScreenshot only has to revalidate it.
+
+	const std::string &URL: Const Reference to the URL of the screenshot.
+*/
+void PrefetchScreenshot(const std::string &URL) {
+	if (URL == "") return;
+
+	const std::string path = _SCREENSHOT_CACHE_PATH + DownloadCache::Name(URL);
+	std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(URL);
+	ctx->conditional = true;
+
+	ctx->callback = [path](DownloadContext &ctx) {
+		if (ctx.result == CURLE_OK && !ctx.NotModified()) saveScreenshot(ctx, path);
+	};
+
+	addPrefetch(ctx);
+}
+
+/*
+	Cancel all speculative transfers, which didn't finish yet.
+*/
+void CancelPrefetches() {
+	LightLock_Lock(&prefetchLock);
+	for (const std::shared_ptr<DownloadContext> &prefetch : prefetches) DownloadEngine::Cancel(prefetch);
+	prefetches.clear();
+	LightLock_Unlock(&prefetchLock);
+}
@@ -0,0 +1,159 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "retryPolicy.hpp"
+
+#include <algorithm>
+#include <map>
+
+/* How a mirror host did the last time. */
+struct MirrorInfo {
+	curl_off_t Speed = 0; // Average speed of the last successful transfer.
+	u64 FailedAt = 0; // osGetTime() of the last failure, 0 if it worked since.
+};
+
+static std::map<std::string, MirrorInfo> mirrors;
+static LightLock mirrorLock = 1; // Unlocked.
+
+/*
+	Return, if a failure is worth another attempt.
+
+	CURLcode res: The result of the transfer.
+	long status: The HTTP status code of the last response.
+*/
+bool RetryPolicy::Retryable(CURLcode res, long status) const {
+	switch (res) {
+		case CURLE_COULDNT_RESOLVE_HOST:
+		case CURLE_COULDNT_CONNECT:
+		case CURLE_OPERATION_TIMEDOUT:
+		case CURLE_SEND_ERROR:
+		case CURLE_RECV_ERROR:
+		case CURLE_PARTIAL_FILE:
+		case CURLE_GOT_NOTHING:
+		case CURLE_SSL_CONNECT_ERROR:
+		case CURLE_HTTP2:
+		case CURLE_HTTP2_STREAM:
+			return true;
+
+		case CURLE_HTTP_RETURNED_ERROR:
+			return status == 408 || status == 425 || status == 429 || status == 500 || status == 502 || status == 503 || status == 504;
+
+		default:
+			return false;
+	}
+}
+
+/*
+	Return, how long to wait before the next attempt in ms.
+	The delay doubles with every attempt and gets jittered, so parallel downloads don't hammer the server at once.
+
+	u32 attempt: The amount of failed attempts so far, starting at 1.
+	u32 retryAfter: What the server asked for through Retry-After, in ms. (0 if nothing)
+*/
+u32 RetryPolicy::Delay(u32 attempt, u32 retryAfter) const {
+	u32 delay = this->BaseDelay << std::min(attempt > 0 ? attempt - 1 : 0, (u32)10);
+	if (delay > this->MaxDelay) delay = this->MaxDelay;
+
+	delay = delay / 2 + (u32)(svcGetSystemTick() % (delay / 2 + 1));
+	return std::max(delay, std::min(retryAfter, this->MaxDelay));
+}
+
+/*
+	Return the scheme and host of a URL.
+
+	const std::string &url: Const Reference to the URL.
+*/
+static std::string hostOf(const std::string &url) {
+	const size_t scheme = url.find("://");
+	const size_t end = url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+	return url.substr(0, end);
+}
+
+/*
+	Record the outcome of a transfer from a mirror.
+
+	const std::string &url: Const Reference to the URL.
+	bool ok: If the transfer succeeded.
+	curl_off_t speed: The average speed of the transfer.
+*/
+void MirrorStats::Record(const std::string &url, bool ok, curl_off_t speed) {
+	LightLock_Lock(&mirrorLock);
+	MirrorInfo &info = mirrors[hostOf(url)];
+
+	if (ok) {
+		info.Speed = speed;
+		info.FailedAt = 0;
+
+	} else info.FailedAt = osGetTime();
+
+	LightLock_Unlock(&mirrorLock);
+}
+
+/*
+	Pick the URL for the next attempt: the fastest known mirror, which didn't fail lately, before unknown ones.
+	Ties keep the order of the candidates, so the original URL comes first.
+
+	const std::vector<std::string> &candidates: Const Reference to the URL and its mirrors.
+	const std::vector<std::string> &tried: Const Reference to the URLs, which failed already. All are candidates again, once every one got tried.
+*/
+std::string MirrorStats::Pick(const std::vector<std::string> &candidates, const std::vector<std::string> &tried) {
+	if (candidates.empty()) return "";
+
+	const bool allTried = std::all_of(candidates.begin(), candidates.end(), [&tried](const std::string &url) {
+		return std::find(tried.begin(), tried.end(), url) != tried.end();
+	});
+
+	const u64 now = osGetTime();
+	std::string best = "";
+	int bestRank = -1;
+	curl_off_t bestSpeed = 0;
+
+	LightLock_Lock(&mirrorLock);
+	for (const std::string &url : candidates) {
+		if (!allTried && std::find(tried.begin(), tried.end(), url) != tried.end()) continue;
+
+		int rank = 1; // Unknown.
+		curl_off_t speed = 0;
+
+		const auto it = mirrors.find(hostOf(url));
+		if (it != mirrors.end()) {
+			if (it->second.FailedAt != 0 && now - it->second.FailedAt < MIRROR_PENALTY) rank = 0;
+			else if (it->second.Speed > 0) {
+				rank = 2;
+				speed = it->second.Speed;
+			}
+		}
+
+		if (rank > bestRank || (rank == bestRank && speed > bestSpeed)) {
+			best = url;
+			bestRank = rank;
+			bestSpeed = speed;
+		}
+	}
+
+	LightLock_Unlock(&mirrorLock);
+	return best;
+}
@@ -0,0 +1,67 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "scheduler.hpp"
+
+static u32 active[4] = { 0 }; // Running transfers per priority.
+static LightLock schedulerLock = 1; // Unlocked.
+
+/*
+	A transfer of the priority started.
+
+	TransferPriority priority: The priority of the transfer.
+*/
+void Scheduler::Begin(TransferPriority priority) {
+	LightLock_Lock(&schedulerLock);
+	active[(int)priority]++;
+	LightLock_Unlock(&schedulerLock);
+}
+
+/*
+	A transfer of the priority finished.
+
+	TransferPriority priority: The priority of the transfer.
+*/
+void Scheduler::End(TransferPriority priority) {
+	LightLock_Lock(&schedulerLock);
+	if (active[(int)priority] > 0) active[(int)priority]--;
+	LightLock_Unlock(&schedulerLock);
+}
+
+/*
+	Return, if a transfer of the priority should pause, because a more urgent one runs.
+
+	TransferPriority priority: The priority of the transfer.
+*/
+bool Scheduler::ShouldYield(TransferPriority priority) {
+	bool yield = false;
+
+	LightLock_Lock(&schedulerLock);
+	for (int i = 0; i < (int)priority && !yield; i++) yield = active[i] > 0;
+	LightLock_Unlock(&schedulerLock);
+
+	return yield;
+}
@@ -0,0 +1,190 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "bufferPool.hpp"
+#include "segmentHasher.hpp"
+
+#include <algorithm>
+#include <strings.h>
+#include <zlib.h>
+
+#define READ_BACK_CHUNK_SIZE 0x60000
+
+/*
+	Initialize a SegmentHasher.
+
+	const std::string &path: Const Reference to the file, the segments write into.
+	const std::string &sha256: Const Reference to the expected SHA-256 as hex. (Empty to skip)
+	const std::string &crc32: Const Reference to the expected CRC32 as hex. (Empty to skip)
+*/
+SegmentHasher::SegmentHasher(const std::string &path, const std::string &sha256, const std::string &crc32) : path(path), sha256(sha256), crc32(crc32) {
+	mbedtls_sha256_init(&this->shaContext);
+	if (this->sha256 != "") mbedtls_sha256_starts(&this->shaContext, 0);
+	this->crcState = ::crc32(0L, Z_NULL, 0);
+}
+
+/*
+	Add a segment. All segments have to be added, before the first one starts.
+
+	curl_off_t start: The first byte of the segment.
+	curl_off_t end: The last byte of the segment.
+*/
+void SegmentHasher::Add(curl_off_t start, curl_off_t end) {
+	this->segments.push_back({ start, end, false });
+}
+
+SegmentHasher::Range *SegmentHasher::Find(curl_off_t start) {
+	for (Range &segment : this->segments) {
+		if (segment.Start == start) return &segment;
+	}
+
+	return nullptr;
+}
+
+void SegmentHasher::Update(const char *buffer, size_t size) {
+	if (this->sha256 != "") mbedtls_sha256_update(&this->shaContext, (const unsigned char *)buffer, size);
+	if (this->crc32 != "") this->crcState = ::crc32(this->crcState, (const Bytef *)buffer, size);
+	this->hashed += size;
+}
+
+/*
+	Read the file from the hashed position up to end back and hash it.
+
+	curl_off_t end: Where to stop. (Exclusive)
+*/
+void SegmentHasher::HashFile(curl_off_t end) {
+	if (this->failed || end <= this->hashed) return;
+
+	FILE *in = fopen(this->path.c_str(), "rb");
+	if (!in || fseek(in, this->hashed, SEEK_SET) != 0) {
+		if (in) fclose(in);
+		this->failed = true;
+		return;
+	}
+
+	std::vector<u8> buffer = BufferPool::Acquire(READ_BACK_CHUNK_SIZE);
+	buffer.resize(READ_BACK_CHUNK_SIZE);
+	this->ReadBack += end - this->hashed;
+
+	while (this->hashed < end) {
+		const size_t read = fread(buffer.data(), 1, std::min((curl_off_t)buffer.size(), end - this->hashed), in);
+		if (read == 0) {
+			this->failed = true;
+			break;
+		}
+
+		this->Update((const char *)buffer.data(), read);
+	}
+
+	fclose(in);
+	BufferPool::Release(std::move(buffer));
+}
+
+/*
+	Hash the segments, which finished before the hashed position reached them.
+	Their data is on the SD card already, since their files got closed.
+*/
+void SegmentHasher::Advance() {
+	while (!this->failed) {
+		Range *segment = nullptr;
+		for (Range &range : this->segments) {
+			if (range.Start <= this->hashed && this->hashed <= range.End) segment = &range;
+		}
+
+		if (!segment || !segment->Finished) return;
+		this->HashFile(segment->End + 1);
+	}
+}
+
+/*
+	Hash the data of a commit of a segment, if it is next in order. Called from the commit thread of the segment, after it got written.
+
+	curl_off_t start: The first byte of the segment.
+	curl_off_t offset: The position of the data in the file.
+	const char *buffer: The committed data.
+	size_t size: The size of the data.
+	FILE *out: The file of the segment, which gets flushed before reading its earlier data back.
+*/
+void SegmentHasher::Committed(curl_off_t start, curl_off_t offset, const char *buffer, size_t size, FILE *out) {
+	LightLock_Lock(&this->lock);
+
+	/* The hashed position reached this segment after it committed some data already, which is read back once. */
+	const Range *segment = this->Find(start);
+	if (segment && this->hashed >= segment->Start && this->hashed < offset) {
+		if (fflush(out) == 0) this->HashFile(offset);
+		else this->failed = true;
+	}
+
+	if (this->hashed == offset && !this->failed) {
+		this->Update(buffer, size);
+		this->Advance();
+	}
+
+	LightLock_Unlock(&this->lock);
+}
+
+/*
+	Mark a segment as completely written.
+
+	curl_off_t start: The first byte of the segment.
+*/
+void SegmentHasher::Finished(curl_off_t start) {
+	LightLock_Lock(&this->lock);
+
+	Range *segment = this->Find(start);
+	if (segment) segment->Finished = true;
+	this->Advance();
+
+	LightLock_Unlock(&this->lock);
+}
+
+/*
+	Return, if the whole file got hashed and matches the expected checksums. Call it once, after all segments finished.
+*/
+bool SegmentHasher::Verify() {
+	LightLock_Lock(&this->lock);
+	bool ok = !this->failed && !this->segments.empty() && this->hashed == this->segments.back().End + 1;
+
+	if (ok && this->sha256 != "") {
+		u8 hash[32];
+		char hex[sizeof(hash) * 2 + 1];
+		mbedtls_sha256_finish(&this->shaContext, hash);
+
+		for (size_t i = 0; i < sizeof(hash); i++) snprintf(hex + i * 2, 3, "%02x", hash[i]);
+		if (strcasecmp(hex, this->sha256.c_str()) != 0) {
+			printf("SHA-256 mismatch for:\n%s\n", this->path.c_str());
+			ok = false;
+		}
+	}
+
+	if (ok && this->crc32 != "" && strtoul(this->crc32.c_str(), nullptr, 16) != this->crcState) {
+		printf("CRC32 mismatch for:\n%s\n", this->path.c_str());
+		ok = false;
+	}
+
+	LightLock_Unlock(&this->lock);
+	return ok;
+}
@@ -0,0 +1,109 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "telemetry.hpp"
+
+#include <deque>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+static std::deque<TransferStats> history;
+static std::vector<TransferStats> pending; // Not written to the log yet.
+static LightLock telemetryLock = 1; // Unlocked.
+
+/*
+	Append the stats to the log and start a new log, once it got too big.
+
+	const std::vector<TransferStats> &records: Const Reference to the stats, the oldest first.
+*/
+static void writeLog(const std::vector<TransferStats> &records) {
+	struct stat st;
+	if (stat(TELEMETRY_LOG_PATH, &st) == 0 && st.st_size > TELEMETRY_LOG_SIZE) {
+		const std::string old = std::string(TELEMETRY_LOG_PATH) + ".1";
+		remove(old.c_str());
+		rename(TELEMETRY_LOG_PATH, old.c_str());
+	}
+
+	FILE *log = fopen(TELEMETRY_LOG_PATH, "a");
+	if (!log) return;
+
+	char timeStr[32];
+	for (const TransferStats &stats : records) {
+		strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", gmtime(&stats.Time));
+
+		fprintf(log, "%s result=%d status=%ld dns=%" PRIu32 " connect=%" PRIu32 " tls=%" PRIu32 " ttfb=%" PRIu32 " total=%" PRIu32
+			" avg=%" CURL_FORMAT_CURL_OFF_T " peak=%" CURL_FORMAT_CURL_OFF_T " bytes=%" CURL_FORMAT_CURL_OFF_T " written=%" CURL_FORMAT_CURL_OFF_T
+			" redirects=%ld retries=%" PRIu32 " stalls=%" PRIu32 " stallms=%" PRIu64 " %s\n",
+			timeStr, stats.Result, stats.Status, stats.DNS, stats.Connect, stats.TLS, stats.TTFB, stats.Total, stats.AvgSpeed, stats.PeakSpeed,
+			stats.Bytes, stats.Written, stats.Redirects, stats.Retries, stats.Stalls, stats.StallTime, stats.URL.c_str());
+	}
+
+	fclose(log);
+}
+
+/*
+	Record the stats of a finished transfer.
+	Called on the engine thread, so the stats are only kept in memory here and written by Telemetry::Flush.
+
+	const TransferStats &stats: Const Reference to the stats.
+*/
+void Telemetry::Record(const TransferStats &stats) {
+	LightLock_Lock(&telemetryLock);
+
+	history.push_front(stats);
+	if (history.size() > TELEMETRY_HISTORY) history.pop_back();
+
+	pending.push_back(stats);
+	if (pending.size() > TELEMETRY_PENDING) pending.erase(pending.begin()); // Nobody flushed for long, so the oldest get lost.
+
+	LightLock_Unlock(&telemetryLock);
+}
+
+/*
+	Write the recorded stats to the log.
+	Called by the queue after each entry and on exit, so the engine thread never waits for the SD card for it.
+*/
+void Telemetry::Flush() {
+	std::vector<TransferStats> records;
+
+	LightLock_Lock(&telemetryLock);
+	records.swap(pending);
+	LightLock_Unlock(&telemetryLock);
+
+	if (!records.empty()) writeLog(records);
+}
+
+/*
+	Return the stats of the last transfers, the newest first.
+*/
+std::vector<TransferStats> Telemetry::History() {
+	LightLock_Lock(&telemetryLock);
+	const std::vector<TransferStats> copy(history.begin(), history.end());
+	LightLock_Unlock(&telemetryLock);
+
+	return copy;
+}
@@ -0,0 +1,187 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "json.hpp"
+#include "validatorCache.hpp"
+
+#include <3ds.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define VALIDATOR_CACHE_MAX 1024 // Entries kept at most.
+#define VALIDATOR_SAVE_INTERVAL 5000 // Changes are written at most every 5 seconds.
+
+static nlohmann::json cacheJson = nullptr;
+static LightLock cacheLock = 1; // Initialized LightLock.
+static bool cacheDirty = false;
+static u64 lastSave = 0;
+
+/*
+	Load the cache from the SD card, if not already done.
+*/
+static void loadCache() {
+	if (!cacheJson.is_null()) return;
+
+	FILE *file = fopen(_VALIDATOR_CACHE_PATH, "rt");
+	if (file) {
+		cacheJson = nlohmann::json::parse(file, nullptr, false);
+		fclose(file);
+	}
+
+	if (!cacheJson.is_object()) cacheJson = nlohmann::json::object();
+}
+
+/*
+	Write the cache to the SD card. Has to be called with the lock held.
+*/
+static void saveCache() {
+	cacheDirty = false;
+	lastSave = osGetTime();
+
+	FILE *file = fopen(_VALIDATOR_CACHE_PATH, "w");
+	if (!file) return;
+
+	const std::string dump = cacheJson.dump();
+	fwrite(dump.c_str(), 1, dump.size(), file);
+	fclose(file);
+}
+
+/*
+	Mark the cache as changed and write it, if the last write is long enough ago. Has to be called with the lock held.
+	A queue of many downloads so only rewrites the file a few times, instead of after every one.
+*/
+static void changedCache() {
+	cacheDirty = true;
+	if (osGetTime() - lastSave >= VALIDATOR_SAVE_INTERVAL) saveCache();
+}
+
+/*
+	Drop the least recently used entries, until the cache fits VALIDATOR_CACHE_MAX. Has to be called with the lock held.
+*/
+static void trimCache() {
+	while (cacheJson.size() > VALIDATOR_CACHE_MAX) {
+		auto oldest = cacheJson.end();
+		u64 oldestTime = UINT64_MAX;
+
+		for (auto it = cacheJson.begin(); it != cacheJson.end(); ++it) {
+			const u64 lastUsed = it.value().is_object() && it.value().contains("lastUsed") && it.value()["lastUsed"].is_number() ? it.value()["lastUsed"].get<u64>() : 0;
+			if (lastUsed < oldestTime) {
+				oldest = it;
+				oldestTime = lastUsed;
+			}
+		}
+
+		cacheJson.erase(oldest);
+	}
+}
+
+/*
+	Return the validators of an URL.
+	Those are only returned, if the local copy still exists and has the expected size.
+
+	const std::string &URL: Const Reference to the URL.
+*/
+Validators ValidatorCache::Get(const std::string &URL) {
+	Validators validators;
+
+	LightLock_Lock(&cacheLock);
+	loadCache();
+
+	if (cacheJson.contains(URL) && cacheJson[URL].is_object()) {
+		nlohmann::json &entry = cacheJson[URL];
+
+		if (entry.contains("etag") && entry["etag"].is_string()) validators.ETag = entry["etag"];
+		if (entry.contains("lastModified") && entry["lastModified"].is_string()) validators.LastModified = entry["lastModified"];
+		if (entry.contains("file") && entry["file"].is_string()) validators.File = entry["file"];
+		if (entry.contains("size") && entry["size"].is_number()) validators.Size = entry["size"];
+
+		entry["lastUsed"] = (u64)time(nullptr);
+		cacheDirty = true; // Written along with the next change.
+	}
+
+	LightLock_Unlock(&cacheLock);
+
+	/* Without a matching local copy, a 304 would be useless. */
+	struct stat st;
+	if (validators.File == "" || stat(validators.File.c_str(), &st) != 0 || (size_t)st.st_size != validators.Size) return { };
+
+	return validators;
+}
+
+/*
+	Set the validators of an URL.
+
+	const std::string &URL: Const Reference to the URL.
+	const Validators &validators: Const Reference to the validators.
+*/
+void ValidatorCache::Set(const std::string &URL, const Validators &validators) {
+	LightLock_Lock(&cacheLock);
+	loadCache();
+
+	if (validators.ETag == "" && validators.LastModified == "") {
+		if (cacheJson.contains(URL)) cacheJson.erase(URL);
+
+	} else {
+		cacheJson[URL] = {
+			{ "etag", validators.ETag },
+			{ "lastModified", validators.LastModified },
+			{ "file", validators.File },
+			{ "size", validators.Size },
+			{ "lastUsed", (u64)time(nullptr) }
+		};
+
+		trimCache();
+	}
+
+	changedCache();
+	LightLock_Unlock(&cacheLock);
+}
+
+/*
+	Remove the validators of an URL.
+
+	const std::string &URL: Const Reference to the URL.
+*/
+void ValidatorCache::Remove(const std::string &URL) {
+	LightLock_Lock(&cacheLock);
+	loadCache();
+
+	if (cacheJson.contains(URL)) {
+		cacheJson.erase(URL);
+		changedCache();
+	}
+
+	LightLock_Unlock(&cacheLock);
+}
+
+/*
+	Write pending changes of the cache to the SD card. Called on exit.
+*/
+void ValidatorCache::Flush() {
+	LightLock_Lock(&cacheLock);
+	if (cacheDirty) saveCache();
+	LightLock_Unlock(&cacheLock);
+}
@@ -0,0 +1,70 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "animation.hpp"
+#include "msg.hpp"
+#include "platform.hpp"
+#include <stdio.h>
+
+extern bool showProgressBar;
+extern ProgressBar progressbarType;
+extern char progressBarMsg[128];
+
+static Thread progressThread = nullptr;
+
+void Platform::DisplayMsg(const std::string &msg) { Msg::DisplayMsg(msg); }
+void Platform::WaitMsg(const std::string &msg) { Msg::waitMsg(msg); }
+bool Platform::PromptMsg(const std::string &msg) { return Msg::promptMsg(msg); }
+
+/*
+	Display the progress bar on its own thread, until HideProgress.
+
+	const std::string &msg: Const Reference to the message above the bar.
+	ProgressBar type: What the bar shows.
+*/
+void Platform::ShowProgress(const std::string &msg, ProgressBar type) {
+	progressbarType = type;
+	if (progressThread) return; // Already shown, so only the type changes.
+
+	snprintf(progressBarMsg, sizeof(progressBarMsg), "%s", msg.c_str());
+	showProgressBar = true;
+
+	s32 prio = 0;
+	svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+	progressThread = threadCreate((ThreadFunc)Animation::displayProgressBar, NULL, 64 * 1024, prio - 1, -2, false);
+}
+
+/*
+	Hide the progress bar and wait for its thread.
+*/
+void Platform::HideProgress() {
+	if (!progressThread) return;
+
+	showProgressBar = false;
+	threadJoin(progressThread, U64_MAX);
+	threadFree(progressThread);
+	progressThread = nullptr;
+}
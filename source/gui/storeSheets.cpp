@@ -0,0 +1,94 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "common.hpp"
+#include "storeSheets.hpp"
+#include <unistd.h>
+
+extern C2D_SpriteSheet sprites;
+static std::vector<C2D_SpriteSheet> sheets;
+static C2D_Image storeBG = { nullptr };
+
+/*
+	Load the SpriteSheets of a UniStore and its custom BG.
+
+	const std::unique_ptr<Store> &store: Const Reference to the UniStore.
+*/
+void StoreSheets::Load(const std::unique_ptr<Store> &store) {
+	StoreSheets::Unload();
+	if (!store || !store->GetValid()) return;
+
+	const std::vector<std::string> sheetLocs = store->GetSheets();
+
+	for (int i = 0; i < (int)sheetLocs.size(); i++) {
+		sheets.push_back(nullptr);
+
+		if (sheetLocs[i] != "" && access((std::string(_STORE_PATH) + sheetLocs[i]).c_str(), F_OK) == 0) {
+			char msg[150];
+			snprintf(msg, sizeof(msg), Lang::get("LOADING_SPRITESHEET").c_str(), i + 1, sheetLocs.size());
+			Msg::DisplayMsg(msg);
+
+			sheets[i] = C2D_SpriteSheetLoad((std::string(_STORE_PATH) + sheetLocs[i]).c_str());
+		}
+	}
+
+	const StoreImage bg = store->GetBGEntry();
+	if (bg.Index < 0 || bg.Sheet < 0 || bg.Sheet >= (int)sheets.size() || !sheets[bg.Sheet]) return;
+	if (bg.Index > (int)C2D_SpriteSheetCount(sheets[bg.Sheet]) - 1) return;
+
+	const C2D_Image temp = C2D_SpriteSheetGetImage(sheets[bg.Sheet], bg.Index);
+	if (temp.subtex->width == 400 && temp.subtex->height == 214) storeBG = temp; // Must be 400x214.
+}
+
+/*
+	Unload all SpriteSheets.
+*/
+void StoreSheets::Unload() {
+	for (C2D_SpriteSheet sheet : sheets) {
+		if (sheet) C2D_SpriteSheetFree(sheet);
+	}
+
+	sheets.clear();
+	storeBG = { nullptr };
+}
+
+/*
+	Return the icon image, or the no icon one, if it isn't on the SpriteSheets.
+
+	const StoreImage &icon: Const Reference to where the icon is.
+*/
+C2D_Image StoreSheets::Icon(const StoreImage &icon) {
+	if (icon.Index < 0 || icon.Sheet < 0 || icon.Sheet >= (int)sheets.size() || !sheets[icon.Sheet]) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
+	if (icon.Index > (int)C2D_SpriteSheetCount(sheets[icon.Sheet]) - 1) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
+
+	const C2D_Image temp = C2D_SpriteSheetGetImage(sheets[icon.Sheet], icon.Index);
+	if (temp.subtex->width < 49 && temp.subtex->height < 49) return temp; // up to 48x48 is valid.
+
+	return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
+}
+
+bool StoreSheets::HasBG() { return storeBG.tex != nullptr; }
+C2D_Image StoreSheets::BG() { return storeBG; }
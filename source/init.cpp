@@ -24,12 +24,19 @@
 *         reasonable ways as different from the original version.
 */
 
+#include "benchmark.hpp"
+#include "bufferPool.hpp"
 #include "common.hpp"
+#include "curlPool.hpp"
+#include "downloadCache.hpp"
+#include "downloadEngine.hpp"
 #include "download.hpp"
 #include "init.hpp"
 #include "mainScreen.hpp"
 #include "queueSystem.hpp"
 #include "sound.hpp"
+#include "telemetry.hpp"
+#include "validatorCache.hpp"
 
 #include <dirent.h>
 #include <unistd.h>
@@ -125,12 +132,14 @@ Result Init::Initialize() {
 	ptmuInit();
 	amInit();
 	acInit();
+	if (R_SUCCEEDED(CurlPool::Init())) DownloadEngine::Init(); // Without SOC, downloads fail like being offline.
 
 	/* Create Directories, if missing. */
 	mkdir("sdmc:/3ds", 0777);
 	mkdir("sdmc:/3ds/Universal-Updater", 0777);
 	mkdir("sdmc:/3ds/Universal-Updater/stores", 0777);
 	mkdir("sdmc:/3ds/Universal-Updater/shortcuts", 0777);
+	mkdir(_SCREENSHOT_CACHE_PATH, 0777);
 
 	config = std::make_unique<Config>();
 	UIThemes = std::make_unique<Theme>();
@@ -160,6 +169,10 @@ Result Init::Initialize() {
 
 	osSetSpeedupEnable(true); // Enable speed-up for New 3DS users.
 
+#ifdef BENCHMARK
+	Benchmark::Run();
+#endif
+
 	/* Check here for updates. */
 	if (config->updatecheck()) UpdateAction();
 
@@ -223,6 +236,12 @@ Result Init::Exit() {
 	cfguExit();
 	config->save();
 	ptmuExit();
+	DownloadEngine::Exit();
+	Telemetry::Flush(); // After the engine, so no download adds to them anymore.
+	ValidatorCache::Flush();
+	DownloadCache::Settle();
+	CurlPool::Exit();
+	BufferPool::Clear();
 	acExit();
 	amExit();
 
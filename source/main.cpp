@@ -25,8 +25,14 @@
 */
 
 #include "argumentParser.hpp"
+#include "bufferPool.hpp"
 #include "common.hpp"
+#include "curlPool.hpp"
+#include "downloadCache.hpp"
+#include "downloadEngine.hpp"
 #include "init.hpp"
+#include "telemetry.hpp"
+#include "validatorCache.hpp"
 #include <dirent.h>
 #include <string>
 
@@ -41,6 +47,7 @@ static void InitForARG() {
 	cfguInit();
 	amInit();
 	acInit();
+	if (R_SUCCEEDED(CurlPool::Init())) DownloadEngine::Init(); // Without SOC, downloads fail like being offline.
 
 	/* Create Directories, if missing. */
 	mkdir("sdmc:/3ds", 0777);
@@ -73,6 +80,12 @@ static Result ExitForARG() {
 	Init::UnloadFont();
 	gfxExit();
 	cfguExit();
+	DownloadEngine::Exit();
+	Telemetry::Flush(); // After the engine, so no download adds to them anymore.
+	ValidatorCache::Flush();
+	DownloadCache::Settle();
+	CurlPool::Exit();
+	BufferPool::Clear();
 	acExit();
 	amExit();
 	romfsExit();
@@ -29,6 +29,7 @@
 #include "keyboard.hpp"
 #include "queueSystem.hpp"
 #include "scriptUtils.hpp"
+#include "storeSheets.hpp"
 #include "storeUtils.hpp"
 #include "structs.hpp"
 #include <fstream>
@@ -112,7 +113,7 @@ void StoreUtils::DrawDownList(const std::vector<std::string> &entries, bool fetc
 	if (StoreUtils::store && StoreUtils::store->GetValid() && !fetch && entry) {
 		if (entries.size() > 0) {
 			Gui::Draw_Rect(0, 174, 400, 66, UIThemes->DownListPrev());
-			const C2D_Image tempImg = entry->GetIcon();
+			const C2D_Image tempImg = StoreSheets::Icon(entry->GetIcon());
 			const uint8_t offsetW = (48 - tempImg.subtex->width) / 2; // Center W.
 			const uint8_t offsetH = (48 - tempImg.subtex->height) / 2; // Center H.
 			C2D_DrawImageAt(tempImg, 9 + offsetW, 174 + 9 + offsetH, 0.5);
@@ -25,15 +25,17 @@
 */
 
 #include "common.hpp"
+#include "download.hpp"
 #include "files.hpp"
+#include "scheduler.hpp"
 #include "storeUtils.hpp"
 #include "structs.hpp"
+#include <set>
 
 extern bool touching(touchPosition touch, Structs::ButtonPos button);
 static const Structs::ButtonPos btn = { 45, 215, 24, 24 };
 static const Structs::ButtonPos sshot = { 75, 215, 24, 24 };
 static const Structs::ButtonPos notes = { 105, 215, 24, 24 };
-extern bool checkWifiStatus();
 extern bool QueueRuns;
 
 /*
@@ -82,16 +84,15 @@ void StoreUtils::EntryHandle(bool &showMark, bool &fetch, bool &sFetch, int &mod
 
 		if ((hDown & KEY_Y) || (hDown & KEY_TOUCH && touching(touch, sshot))) {
 			if (!entry->GetScreenshots().empty()) {
-				if (checkWifiStatus()) {
-					if (QueueRuns) {
-						if (!Msg::promptMsg(Lang::get("FEATURE_SIDE_EFFECTS"))) return;
-						sFetch = true;
-						mode = 6;
-
-					} else {
-						sFetch = true;
-						mode = 6;
-					}
+				/* Seen screenshots are cached, so those also show up without Wi-Fi. */
+				if (QueueRuns) {
+					if (!Msg::promptMsg(Lang::get("FEATURE_SIDE_EFFECTS"))) return;
+					sFetch = true;
+					mode = 6;
+
+				} else {
+					sFetch = true;
+					mode = 6;
 				}
 			}
 		}
@@ -100,4 +101,44 @@ void StoreUtils::EntryHandle(bool &showMark, bool &fetch, bool &sFetch, int &mod
 			if (entry->GetReleaseNotes() != "") mode = 7;
 		}
 	}
-}
\ No newline at end of file
+}
+
+/*
+	Prepare the downloads of an entry ahead, while the user looks at it:
+	Open the connections to the hosts of its scripts, resolve their GitHub Release assets and optionally fetch the first screenshot.
+	The work of the previously selected entry gets canceled.
+
+	const std::unique_ptr<StoreEntry> &entry: Const Reference to the selected entry.
+*/
+void StoreUtils::Prefetch(const std::unique_ptr<StoreEntry> &entry) {
+	CancelPrefetches();
+	if (!entry || !config->prefetch() || !checkWifiStatus()) return;
+
+	std::set<std::string> seen; // URLs and repositories, which already got a transfer.
+	const int index = entry->GetEntryIndex();
+
+	for (const std::string &name : StoreUtils::store->GetDownloadList(index)) {
+		const nlohmann::json Script = StoreUtils::GetScript(index, name);
+		if (!Script.is_array()) continue;
+
+		for (const auto &step : Script) {
+			if ((int)seen.size() >= PREFETCH_MAX) break;
+			if (!step.is_object() || !step.contains("type") || !step.contains("file") || !step["file"].is_string()) continue;
+
+			if (step["type"] == "downloadFile") {
+				const std::string file = step["file"];
+				if (seen.insert(file).second) PrefetchConnection(file);
+
+			} else if (step["type"] == "downloadRelease" && step.contains("repo") && step["repo"].is_string()) {
+				bool includePrereleases = false;
+				if (step.contains("includePrereleases") && step["includePrereleases"].is_boolean()) includePrereleases = step["includePrereleases"];
+
+				/* The assets of a release share the metadata and host, so one per release is enough. */
+				const std::string repo = step["repo"];
+				if (seen.insert(repo + (includePrereleases ? "#pre" : "")).second) PrefetchRelease(GITHUB_URL "/" + repo, step["file"], includePrereleases);
+			}
+		}
+	}
+
+	if (config->prefetchScreenshots() && !entry->GetScreenshots().empty()) PrefetchScreenshot(entry->GetScreenshots()[0]);
+}
@@ -25,6 +25,7 @@
 */
 
 #include "common.hpp"
+#include "storeSheets.hpp"
 #include "storeUtils.hpp"
 #include "structs.hpp"
 
@@ -52,8 +53,8 @@ static const std::vector<Structs::ButtonPos> GridBoxes = {
 void StoreUtils::DrawGrid() {
 	if (StoreUtils::store) { // Ensure, store is not a nullptr.
 
-		if (config->usebg() && StoreUtils::store->customBG()) {
-			C2D_DrawImageAt(StoreUtils::store->GetStoreImg(), 0, 26, 0.5f, nullptr);
+		if (config->usebg() && StoreSheets::HasBG()) {
+			C2D_DrawImageAt(StoreSheets::BG(), 0, 26, 0.5f, nullptr);
 
 		} else {
 			Gui::Draw_Rect(0, 26, 400, 214, UIThemes->BGColor());
@@ -66,7 +67,7 @@ void StoreUtils::DrawGrid() {
 			/* Ensure, entries is larger than the index. */
 			if ((int)StoreUtils::entries.size() > i2) {
 				if (StoreUtils::entries[i2]) { // Ensure, the Entry is not nullptr.
-					const C2D_Image tempImg = StoreUtils::entries[i2]->GetIcon();
+					const C2D_Image tempImg = StoreSheets::Icon(StoreUtils::entries[i2]->GetIcon());
 					const uint8_t offsetW = (48 - tempImg.subtex->width) / 2; // Center W.
 					const uint8_t offsetH = (48 - tempImg.subtex->height) / 2; // Center H.
 
@@ -25,6 +25,7 @@
 */
 
 #include "common.hpp"
+#include "storeSheets.hpp"
 #include "storeUtils.hpp"
 #include "structs.hpp"
 
@@ -38,8 +39,8 @@ static const std::vector<Structs::ButtonPos> StoreBoxesList = {
 void StoreUtils::DrawList() {
 	if (StoreUtils::store) { // Ensure, store is not a nullptr.
 
-		if (config->usebg() && StoreUtils::store->customBG()) {
-			C2D_DrawImageAt(StoreUtils::store->GetStoreImg(), 0, 26, 0.5f, nullptr);
+		if (config->usebg() && StoreSheets::HasBG()) {
+			C2D_DrawImageAt(StoreSheets::BG(), 0, 26, 0.5f, nullptr);
 
 		} else {
 			Gui::Draw_Rect(0, 26, 400, 214, UIThemes->BGColor());
@@ -55,7 +56,7 @@ void StoreUtils::DrawList() {
 				/* Ensure, entries is larger than the index. */
 				if ((int)StoreUtils::entries.size() > i + StoreUtils::store->GetScreenIndx()) {
 					if (StoreUtils::entries[i + StoreUtils::store->GetScreenIndx()]) { // Ensure, the Entry is not nullptr.
-						const C2D_Image tempImg = StoreUtils::entries[i + StoreUtils::store->GetScreenIndx()]->GetIcon();
+						const C2D_Image tempImg = StoreSheets::Icon(StoreUtils::entries[i + StoreUtils::store->GetScreenIndx()]->GetIcon());
 						const uint8_t offsetW = (48 - tempImg.subtex->width) / 2; // Center W.
 						const uint8_t offsetH = (48 - tempImg.subtex->height) / 2; // Center H.
 
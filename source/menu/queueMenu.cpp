@@ -27,6 +27,7 @@
 #include "common.hpp"
 #include "queueSystem.hpp"
 #include "scriptUtils.hpp"
+#include "storeSheets.hpp"
 #include "storeUtils.hpp"
 #include "structs.hpp"
 #include <curl/curl.h>
@@ -40,7 +41,6 @@ extern int filesExtracted, extractFilesCount;
 extern curl_off_t downloadTotal;
 extern curl_off_t downloadNow;
 extern curl_off_t downloadSpeed;
-extern CURL *CurlHandle;
 bool ShowQueueProgress = true; // Queue Mode View.
 int queueMenuIdx = 0; // Queue Menu Index.
 
@@ -55,6 +55,18 @@ static const std::vector<Structs::ButtonPos> QueueBoxes = {
 };
 
 extern std::deque<std::unique_ptr<Queue>> queueEntries;
+extern LightLock queueLock;
+
+/*
+	Return the icon of a queue entry. Only the loaded UniStore has its SpriteSheets loaded, so others show no icon.
+
+	const std::unique_ptr<Queue> &entry: Const Reference to the queue entry.
+*/
+static C2D_Image queueIcon(const std::unique_ptr<Queue> &entry) {
+	if (StoreUtils::store && entry->unistoreName == StoreUtils::store->GetUniStoreTitle()) return StoreSheets::Icon(entry->icn);
+
+	return StoreSheets::Icon({ });
+}
 
 void DrawStatus(QueueStatus s) {
 	if (!ShowQueueProgress) {
@@ -101,6 +113,10 @@ void DrawStatus(QueueStatus s) {
 				case QueueStatus::Request:
 					Gui::DrawString(QueueBoxes[0].x + 60, QueueBoxes[0].y + 68, 0.4f, UIThemes->TextColor(), Lang::get("OP_WAITING"), 120, 0, font);
 					break;
+
+				case QueueStatus::Deferred:
+					Gui::DrawString(QueueBoxes[0].x + 60, QueueBoxes[0].y + 68, 0.4f, UIThemes->TextColor(), Lang::get("OP_DEFERRED"), 120, 0, font);
+					break;
 			}
 		}
 
@@ -136,9 +152,6 @@ void DrawStatus(QueueStatus s) {
 			break;
 
 		case QueueStatus::Downloading:
-			if (CurlHandle) curl_easy_getinfo(CurlHandle, CURLINFO_SPEED_DOWNLOAD_T, &downloadSpeed);
-			else downloadSpeed = 0;
-
 			if (downloadTotal < 1.0f) downloadTotal = 1.0f;
 			if (downloadTotal < downloadNow) downloadTotal = downloadNow;
 
@@ -173,6 +186,11 @@ void DrawStatus(QueueStatus s) {
 			snprintf(str, sizeof(str), Lang::get("OP_WAITING").c_str());
 			snprintf(str2, sizeof(str2), Lang::get("ACTION_REQUIRED").c_str());
 			break;
+
+		case QueueStatus::Deferred:
+			snprintf(str, sizeof(str), Lang::get("OP_DEFERRED").c_str());
+			snprintf(str2, sizeof(str2), Lang::get("CONNECT_WIFI").c_str());
+			break;
 	}
 
 	/* Draw Handle. */
@@ -221,6 +239,11 @@ void DrawStatus(QueueStatus s) {
 			Gui::Draw_Rect(QueueBoxes[0].x + 60, QueueBoxes[0].y + 30, 182, 30, UIThemes->ProgressbarOut());
 			Gui::DrawStringCentered(QueueBoxes[0].x + 151 - 160, QueueBoxes[0].y + 32, 0.8f, UIThemes->TextColor(), str2, 180, 0, font);
 			break;
+
+		case QueueStatus::Deferred:
+			Gui::DrawString(QueueBoxes[0].x + 10, QueueBoxes[0].y + 5, 0.4f, UIThemes->TextColor(), str, 230, 0, font);
+			Gui::DrawString(QueueBoxes[0].x + 60, QueueBoxes[0].y + 68, 0.4f, UIThemes->TextColor(), str2, 120, 0, font);
+			break;
 	}
 }
 
@@ -229,10 +252,11 @@ void StoreUtils::DrawQueueMenu(const int queueIndex) {
 	Gui::Draw_Rect(40, 25, 280, 1, UIThemes->EntryOutline());
 	Gui::DrawStringCentered(17, 2, 0.6, UIThemes->TextColor(), Lang::get("QUEUE"), 273, 0, font);
 
+	LightLock_Lock(&queueLock); // The queue thread may finish or swap entries meanwhile.
 	if (!queueEntries.empty()) {
 		Gui::Draw_Rect(QueueBoxes[0].x, QueueBoxes[0].y, QueueBoxes[0].w, QueueBoxes[0].h, UIThemes->MarkSelected());
 
-		const C2D_Image tempImg = queueEntries[0]->icn;
+		const C2D_Image tempImg = queueIcon(queueEntries[0]);
 		const uint8_t offsetW = (48 - tempImg.subtex->width) / 2; // Center W.
 		const uint8_t offsetH = (48 - tempImg.subtex->height) / 2; // Center H.
 		C2D_DrawImageAt(tempImg, QueueBoxes[0].x + 5 + offsetW, QueueBoxes[0].y + 21 + offsetH, 0.5f);
@@ -244,7 +268,7 @@ void StoreUtils::DrawQueueMenu(const int queueIndex) {
 		if ((1 + queueMenuIdx) < (int)queueEntries.size()) {
 			Gui::Draw_Rect(QueueBoxes[1].x, QueueBoxes[1].y, QueueBoxes[1].w, QueueBoxes[1].h, UIThemes->MarkUnselected());
 
-			const C2D_Image tempImg2 = queueEntries[1 + queueMenuIdx]->icn;
+			const C2D_Image tempImg2 = queueIcon(queueEntries[1 + queueMenuIdx]);
 			const uint8_t offsetW2 = (48 - tempImg2.subtex->width) / 2; // Center W.
 			const uint8_t offsetH2 = (48 - tempImg2.subtex->height) / 2; // Center H.
 			C2D_DrawImageAt(tempImg2, QueueBoxes[1].x + 5 + offsetW2, QueueBoxes[1].y + 21 + offsetH2, 0.5f);
@@ -257,17 +281,22 @@ void StoreUtils::DrawQueueMenu(const int queueIndex) {
 			GFX::DrawIcon(sprites_cancel_idx, QueueBoxes[3].x, QueueBoxes[3].y, UIThemes->TextColor());
 		}
 	}
+
+	LightLock_Unlock(&queueLock);
 }
 
 void StoreUtils::QueueMenuHandle(int &queueIndex, int &storeMode) {
+	LightLock_Lock(&queueLock);
 	if (!queueEntries.empty()) {
 		if ((1 + queueMenuIdx) > (int)queueEntries.size() - 1) queueMenuIdx = std::max<int>((int)(queueEntries.size() - 1) - 1, 0); // Ensure this really doesn't go below 0.
 	}
+	LightLock_Unlock(&queueLock);
 
 	if (hDown & KEY_TOUCH) {
 		/* Current Queue Cancel. */
 		if (QueueSystem::RequestNeeded == NO_REQUEST && touching(touch, QueueBoxes[2])) { // Needs to be above the 0 one, otherwise the callback won't be accepted.
 			QueueSystem::CancelCallback = true;
+			QueueSystem::Wakeup();
 
 		} else if (touching(touch, QueueBoxes[0])) {
 			if (QueueSystem::RequestNeeded != NO_REQUEST) { // -1 means no request.
@@ -293,14 +322,18 @@ void StoreUtils::QueueMenuHandle(int &queueIndex, int &storeMode) {
 
 			/* Remove from Queue. */
 		} else if (touching(touch, QueueBoxes[3])) { // Remove Queue entries.
-			if (queueEntries.size() > 1) queueEntries.erase(queueEntries.begin() + 1 + queueMenuIdx);
+			LightLock_Lock(&queueLock);
+			if ((1 + queueMenuIdx) < (int)queueEntries.size()) queueEntries.erase(queueEntries.begin() + 1 + queueMenuIdx);
+			LightLock_Unlock(&queueLock);
 		}
 	}
 
 	if (hDown & KEY_DOWN) {
+		LightLock_Lock(&queueLock);
 		if (!queueEntries.empty()) {
 			if ((1 + queueMenuIdx) < (int)queueEntries.size() - 1) queueMenuIdx++;
 		}
+		LightLock_Unlock(&queueLock);
 	}
 
 	if (hDown & KEY_UP) {
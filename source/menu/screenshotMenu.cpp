@@ -26,11 +26,11 @@
 
 #include "animation.hpp"
 #include "common.hpp"
+#include "screenshot.hpp"
 #include "storeUtils.hpp"
 #include "structs.hpp"
 
 extern bool touching(touchPosition touch, Structs::ButtonPos button);
-extern bool checkWifiStatus();
 
 /*
 	Draw the Screenshot menu.
@@ -141,11 +141,9 @@ void StoreUtils::ScreenshotMenu(C2D_Image &img, int &sIndex, bool &sFetch, int &
 	}
 
 	if ((hDown & KEY_RIGHT) || (hDown & KEY_R)) {
-		if (checkWifiStatus()) {
-			if (sIndex < screenshotSize - 1) {
-				sIndex++;
-				sFetch = true;
-			}
+		if (sIndex < screenshotSize - 1) {
+			sIndex++;
+			sFetch = true;
 		}
 	}
 
@@ -154,11 +152,9 @@ void StoreUtils::ScreenshotMenu(C2D_Image &img, int &sIndex, bool &sFetch, int &
 	if (hDown & KEY_UP && zoom < 2) zoom++;
 
 	if ((hDown & KEY_LEFT) || (hDown & KEY_L)) {
-		if (checkWifiStatus()) {
-			if (sIndex > 0) {
-				sIndex--;
-				sFetch = true;
-			}
+		if (sIndex > 0) {
+			sIndex--;
+			sFetch = true;
 		}
 	}
 }
\ No newline at end of file
@@ -34,13 +34,15 @@
 extern bool exiting, QueueRuns;
 extern bool touching(touchPosition touch, Structs::ButtonPos button);
 static const std::vector<Structs::ButtonPos> mainButtons = {
-	{ 45, 32, 271, 22 },
-	{ 45, 62, 271, 22 },
-	{ 45, 92, 271, 22 },
-	{ 45, 122, 271, 22 },
-	{ 45, 152, 271, 22 },
-	{ 45, 182, 271, 22 },
-	{ 45, 212, 271, 22 }
+	{ 45, 28, 271, 21 },
+	{ 45, 51, 271, 21 },
+	{ 45, 74, 271, 21 },
+	{ 45, 97, 271, 21 },
+	{ 45, 120, 271, 21 },
+	{ 45, 143, 271, 21 },
+	{ 45, 166, 271, 21 },
+	{ 45, 189, 271, 21 },
+	{ 45, 212, 271, 21 }
 };
 
 static const std::vector<Structs::ButtonPos> langButtons = {
@@ -77,12 +79,24 @@ static const std::vector<Structs::ButtonPos> dirIcons = {
 	{ 288, 210, 24, 24 }
 };
 
+static const std::vector<Structs::ButtonPos> downloadButtons = {
+	{ 41, 34, 280, 24 },
+	{ 41, 64, 280, 24 },
+	{ 41, 94, 280, 24 },
+	{ 41, 124, 280, 24 },
+	{ 41, 154, 280, 24 }
+};
+
 static const Structs::ButtonPos back = { 45, 0, 24, 24 }; // Back arrow for directory.
 static const Structs::ButtonPos Theme = { 40, 196, 280, 24 }; // Themes.
 
 
-static const std::vector<std::string> mainStrings = { "LANGUAGE", "SELECT_UNISTORE", "AUTO_UPDATE_SETTINGS_BTN", "GUI_SETTINGS_BTN", "DIRECTORY_SETTINGS_BTN", "CREDITS", "EXIT_APP" };
+static const std::vector<std::string> mainStrings = { "LANGUAGE", "SELECT_UNISTORE", "AUTO_UPDATE_SETTINGS_BTN", "GUI_SETTINGS_BTN", "DIRECTORY_SETTINGS_BTN", "DOWNLOAD_SETTINGS_BTN", "DIAGNOSTICS_BTN", "CREDITS", "EXIT_APP" };
 static const std::vector<std::string> dirStrings = { "CHANGE_3DSX_PATH", "3DSX_IN_FOLDER", "CHANGE_NDS_PATH", "CHANGE_ARCHIVE_PATH", "CHANGE_SHORTCUT_PATH", "CHANGE_FIRM_PATH" };
+static const std::vector<std::string> downloadStrings = { "DOWNLOAD_CACHE", "CACHE_QUOTA", "PREFETCH", "PREFETCH_SCREENSHOTS", "BUFFER_CEILING" };
+static const std::vector<std::string> downloadDescs = { "DOWNLOAD_CACHE_DESC", "CACHE_QUOTA_DESC", "PREFETCH_DESC", "PREFETCH_SCREENSHOTS_DESC", "BUFFER_CEILING_DESC" };
+static const std::vector<int> cacheQuotas = { 64, 128, 256, 512, 1024 }; // MiB.
+static const std::vector<int> bufferCeilings = { 1024, 2048, 4096, 8192, 16384 }; // KiB.
 extern std::vector<std::pair<std::string, std::string>> Themes;
 
 /* Note: Украïнська is spelled using a latin i with dieresis to work in the system font */
@@ -90,6 +104,21 @@ static const std::vector<std::string> languages = { "Bruh", "Dansk", "Deutsch",
 static const std::string langsTemp[] = { "br", "da", "de", "en", "es", "fr", "it", /* "lt", */ "hu", /* "nl", */ "pl", "pt", "pt-BR", "tr", "ru", "uk", /* "he", */ "zh-CN", "zh-TW", "jp", "ko" };
 static const std::pair<int, int> langSprites[] = { {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, /* {-1, 0}, */ {-1, 0}, /* {-1, 0}, */ {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, /* {-1, 0}, */ {sprites_zh_CN_idx, 54}, {sprites_zh_TW_idx, 55}, {sprites_jp_idx, 31}, {sprites_ko_idx, 30} };
 
+/*
+	Return the next step of a selector, wrapping around to the first one.
+	Values from the config file, which aren't a step, continue at the next larger one.
+
+	const std::vector<int> &steps: Const Reference to the ascending steps.
+	int value: The current value.
+*/
+static int nextStep(const std::vector<int> &steps, int value) {
+	for (int step : steps) {
+		if (step > value) return step;
+	}
+
+	return steps[0];
+}
+
 /*
 	Main Settings.
 
@@ -100,7 +129,7 @@ static void DrawSettingsMain(int selection) {
 	Gui::Draw_Rect(40, 25, 280, 1, UIThemes->EntryOutline());
 	Gui::DrawStringCentered(20, 2, 0.6, UIThemes->TextColor(), Lang::get("SETTINGS"), 280, 0, font);
 
-	for (int i = 0; i < 7; i++) {
+	for (int i = 0; i < (int)mainStrings.size(); i++) {
 		if (i == selection) Gui::Draw_Rect(mainButtons[i].x, mainButtons[i].y, mainButtons[i].w, mainButtons[i].h, UIThemes->MarkSelected());
 		Gui::DrawStringCentered(20, mainButtons[i].y + 4, 0.45f, UIThemes->TextColor(), Lang::get(mainStrings[i]), 255, 0, font);
 	}
@@ -173,6 +202,33 @@ static void DrawAutoUpdate(int selection) {
 	Gui::DrawString(47, 151, 0.4f, UIThemes->TextColor(), Lang::get("AUTO_UPDATE_UU_DESC"), 265, 0, font, C2D_WordWrap);
 }
 
+/*
+	Draw the Download Settings.
+
+	int selection: The Settings Selection.
+*/
+static void DrawDownloadSettings(int selection) {
+	Gui::Draw_Rect(40, 0, 280, 25, UIThemes->EntryBar());
+	Gui::Draw_Rect(40, 25, 280, 1, UIThemes->EntryOutline());
+	GFX::DrawIcon(sprites_arrow_idx, back.x, back.y, UIThemes->TextColor());
+
+	Gui::DrawStringCentered(20, 2, 0.6, UIThemes->TextColor(), Lang::get("DOWNLOAD_SETTINGS"), 248, 0, font);
+
+	for (int i = 0; i < (int)downloadButtons.size(); i++) {
+		Gui::Draw_Rect(downloadButtons[i].x, downloadButtons[i].y, downloadButtons[i].w, downloadButtons[i].h, (selection == i ? UIThemes->MarkSelected() : UIThemes->MarkUnselected()));
+		Gui::DrawString(downloadButtons[i].x + 4, downloadButtons[i].y + 4, 0.5f, UIThemes->TextColor(), Lang::get(downloadStrings[i]), 210, 0, font);
+	}
+
+	GFX::DrawToggle(288, downloadButtons[0].y, config->downloadCache());
+	Gui::DrawString(312, downloadButtons[1].y + 4, 0.5f, UIThemes->TextColor(), std::to_string(config->cacheQuota()) + " MiB", 80, 0, font, C2D_AlignRight);
+	GFX::DrawToggle(288, downloadButtons[2].y, config->prefetch());
+	GFX::DrawToggle(288, downloadButtons[3].y, config->prefetchScreenshots());
+	Gui::DrawString(312, downloadButtons[4].y + 4, 0.5f, UIThemes->TextColor(), StringUtils::formatBytes((u64)std::max(config->bufferCeiling(), 0) * 1024), 80, 0, font, C2D_AlignRight);
+
+	/* The description of the selected option. */
+	Gui::DrawString(47, 190, 0.4f, UIThemes->TextColor(), Lang::get(downloadDescs[selection]), 265, 0, font, C2D_WordWrap);
+}
+
 /*
 	Draw the GUI Settings.
 
@@ -209,6 +265,8 @@ static void DrawGUISettings(int selection) {
 	- Change the Language.
 	- Access the UniStore Manage Handle.
 	- Enable UniStore auto update on boot.
+	- Change the download options.
+	- Show the telemetry of the last transfers.
 	- Show the Credits.
 	- Exit Universal-Updater.
 
@@ -224,7 +282,7 @@ static void SettingsHandleMain(int &page, bool &dspSettings, int &storeMode, int
 	}
 
 	if (hRepeat & KEY_DOWN) {
-		if (selection < 6) selection++;
+		if (selection < (int)mainStrings.size() - 1) selection++;
 		else selection = 0;
 	}
 
@@ -268,10 +326,17 @@ static void SettingsHandleMain(int &page, bool &dspSettings, int &storeMode, int
 			selection = 0;
 			page = 1;
 
- 		} else if (touching(touch, mainButtons[5])) {
-			Overlays::ShowCredits();
+		} else if (touching(touch, mainButtons[5])) {
+			selection = 0;
+			page = 5;
 
 		} else if (touching(touch, mainButtons[6])) {
+			Overlays::ShowDiagnostics();
+
+		} else if (touching(touch, mainButtons[7])) {
+			Overlays::ShowCredits();
+
+		} else if (touching(touch, mainButtons[8])) {
 			if (!QueueRuns) exiting = true;
 		}
 	}
@@ -308,10 +373,19 @@ static void SettingsHandleMain(int &page, bool &dspSettings, int &storeMode, int
 				break;
 
 			case 5:
-				Overlays::ShowCredits();
+				selection = 0;
+				page = 5;
 				break;
 
 			case 6:
+				Overlays::ShowDiagnostics();
+				break;
+
+			case 7:
+				Overlays::ShowCredits();
+				break;
+
+			case 8:
 				if (!QueueRuns) exiting = true;
 				break;
 		}
@@ -532,6 +606,81 @@ static void GUISettingsLogic(int &page, int &selection) {
 	}
 }
 
+/*
+	Change a Download Setting.
+
+	int option: The option to change.
+*/
+static void ChangeDownloadSetting(int option) {
+	switch(option) {
+		case 0:
+			config->downloadCache(!config->downloadCache());
+			break;
+
+		case 1:
+			config->cacheQuota(nextStep(cacheQuotas, config->cacheQuota()));
+			break;
+
+		case 2:
+			config->prefetch(!config->prefetch());
+			break;
+
+		case 3:
+			config->prefetchScreenshots(!config->prefetchScreenshots());
+			break;
+
+		case 4:
+			config->bufferCeiling(nextStep(bufferCeilings, config->bufferCeiling()));
+			break;
+	}
+}
+
+/*
+	Logic of the Download Settings.
+
+	Here you can..
+
+	- Enable / Disable the cache of downloaded files.
+	- Change the size limit of that cache.
+	- Enable / Disable preparing the downloads and screenshots of the selected entry.
+	- Change the memory limit for the buffers of all running downloads.
+
+	int &page: Reference to the page.
+	int &selection: Reference to the Selection.
+*/
+static void DownloadSettingsLogic(int &page, int &selection) {
+	if (hDown & KEY_B) {
+		page = 0;
+		selection = 5;
+	}
+
+	if (hRepeat & KEY_DOWN) {
+		if (selection < (int)downloadStrings.size() - 1) selection++;
+	}
+
+	if (hRepeat & KEY_UP) {
+		if (selection > 0) selection--;
+	}
+
+	if (hDown & KEY_TOUCH) {
+		if (touching(touch, back)) {
+			page = 0;
+			selection = 5;
+
+		} else {
+			for (int i = 0; i < (int)downloadButtons.size(); i++) {
+				if (touching(touch, downloadButtons[i])) {
+					selection = i;
+					ChangeDownloadSetting(i);
+					break;
+				}
+			}
+		}
+	}
+
+	if (hDown & KEY_A) ChangeDownloadSetting(selection);
+}
+
 /*
 	Logic of the Language Settings.
 
@@ -576,7 +725,7 @@ static void LanguageLogic(int &page, int &selection, int &sPos) {
 		/* Check if language needs a custom font. */
 		if (l == "uk") {
 			if (access("sdmc:/3ds/Universal-Updater/font.bcfnt", F_OK) != 0) {
-				ScriptUtils::downloadFile("https://github.com/Universal-Team/extras/raw/master/files/universal-updater.bcfnt", "sdmc:/3ds/Universal-Updater/font.bcfnt", Lang::get("DOWNLOADING_COMPATIBLE_FONT"), true);
+				ScriptUtils::downloadFile(GITHUB_URL "/Universal-Team/extras/raw/master/files/universal-updater.bcfnt", "sdmc:/3ds/Universal-Updater/font.bcfnt", Lang::get("DOWNLOADING_COMPATIBLE_FONT"), true);
 				Init::UnloadFont();
 			}
 
@@ -610,7 +759,7 @@ static void LanguageLogic(int &page, int &selection, int &sPos) {
 					/* Check if language needs a custom font. */
 					if (l == "uk") {
 						if (access("sdmc:/3ds/Universal-Updater/font.bcfnt", F_OK) != 0) {
-							ScriptUtils::downloadFile("https://github.com/Universal-Team/extras/raw/master/files/universal-updater.bcfnt", "sdmc:/3ds/Universal-Updater/font.bcfnt", Lang::get("DOWNLOADING_COMPATIBLE_FONT"), true);
+							ScriptUtils::downloadFile(GITHUB_URL "/Universal-Team/extras/raw/master/files/universal-updater.bcfnt", "sdmc:/3ds/Universal-Updater/font.bcfnt", Lang::get("DOWNLOADING_COMPATIBLE_FONT"), true);
 							Init::UnloadFont();
 						}
 
@@ -641,7 +790,7 @@ static void LanguageLogic(int &page, int &selection, int &sPos) {
 
 		if (touching(touch, langButtons[6])) {
 			/* Download Font. */
-			ScriptUtils::downloadFile("https://github.com/Universal-Team/extras/raw/master/files/universal-updater.bcfnt", "sdmc:/3ds/Universal-Updater/font.bcfnt", Lang::get("DOWNLOADING_COMPATIBLE_FONT"), true);
+			ScriptUtils::downloadFile(GITHUB_URL "/Universal-Team/extras/raw/master/files/universal-updater.bcfnt", "sdmc:/3ds/Universal-Updater/font.bcfnt", Lang::get("DOWNLOADING_COMPATIBLE_FONT"), true);
 			config->customfont(true);
 			Init::UnloadFont();
 			Init::LoadFont();
@@ -679,6 +828,10 @@ void StoreUtils::DrawSettings(int page, int selection, int sPos) {
 		case 4:
 			DrawLanguageSettings(selection, sPos);
 			break;
+
+		case 5:
+			DrawDownloadSettings(selection);
+			break;
 	}
 }
 
@@ -712,5 +865,9 @@ void StoreUtils::SettingsHandle(int &page, bool &dspSettings, int &storeMode, in
 		case 4:
 			LanguageLogic(page, selection, sPos);
 			break;
+
+		case 5:
+			DownloadSettingsLogic(page, selection);
+			break;
 	}
 }
\ No newline at end of file
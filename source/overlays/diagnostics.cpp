@@ -0,0 +1,133 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "animation.hpp"
+#include "common.hpp"
+#include "overlay.hpp"
+#include "stringutils.hpp"
+#include "telemetry.hpp"
+
+static const std::vector<Structs::ButtonPos> mainButtons = {
+	{ 10, 6, 300, 22 },
+	{ 10, 36, 300, 22 },
+	{ 10, 66, 300, 22 },
+	{ 10, 96, 300, 22 },
+	{ 10, 126, 300, 22 },
+	{ 10, 156, 300, 22 },
+	{ 10, 186, 300, 22 }
+};
+
+/*
+	Return the file name of an URL.
+
+	const std::string &URL: Const Reference to the URL.
+*/
+static std::string getName(const std::string &URL) {
+	const size_t slash = URL.find_last_of('/');
+	return (slash == std::string::npos || slash + 1 == URL.size()) ? URL : URL.substr(slash + 1);
+}
+
+/*
+	Draw the stats of a transfer.
+
+	const TransferStats &stats: Const Reference to the stats.
+*/
+static void DrawStats(const TransferStats &stats) {
+	char line[128];
+	Gui::DrawStringCentered(0, 30, 0.5f, UIThemes->TextColor(), getName(stats.URL), 390, 0, font);
+
+	snprintf(line, sizeof(line), "HTTP %ld | curl %d | %ld redirects | %lu retries", stats.Status, stats.Result, stats.Redirects, stats.Retries);
+	Gui::DrawString(10, 55, 0.45f, UIThemes->TextColor(), line, 380, 0, font);
+
+	snprintf(line, sizeof(line), "DNS %lu ms | Connect %lu ms | TLS %lu ms", stats.DNS, stats.Connect, stats.TLS);
+	Gui::DrawString(10, 80, 0.45f, UIThemes->TextColor(), line, 380, 0, font);
+
+	snprintf(line, sizeof(line), "First byte %lu ms | Total %lu ms", stats.TTFB, stats.Total);
+	Gui::DrawString(10, 100, 0.45f, UIThemes->TextColor(), line, 380, 0, font);
+
+	snprintf(line, sizeof(line), "Average %s/s | Peak %s/s", StringUtils::formatBytes(stats.AvgSpeed).c_str(), StringUtils::formatBytes(stats.PeakSpeed).c_str());
+	Gui::DrawString(10, 125, 0.45f, UIThemes->TextColor(), line, 380, 0, font);
+
+	snprintf(line, sizeof(line), "Received %s | Written %s", StringUtils::formatBytes(stats.Bytes).c_str(), StringUtils::formatBytes(stats.Written).c_str());
+	Gui::DrawString(10, 145, 0.45f, UIThemes->TextColor(), line, 380, 0, font);
+
+	snprintf(line, sizeof(line), "SD card stalls %lu | %llu ms", stats.Stalls, stats.StallTime);
+	Gui::DrawString(10, 170, 0.45f, UIThemes->TextColor(), line, 380, 0, font);
+}
+
+/* Show the telemetry of the last transfers. */
+void Overlays::ShowDiagnostics() {
+	const std::vector<TransferStats> history = Telemetry::History();
+	bool doOut = false;
+	int selection = 0, sPos = 0;
+
+	while(!doOut) {
+		Gui::clearTextBufs();
+		C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+		C2D_TargetClear(Top, TRANSPARENT);
+		C2D_TargetClear(Bottom, TRANSPARENT);
+
+		GFX::DrawTop();
+		Gui::DrawStringCentered(0, 1, 0.7f, UIThemes->TextColor(), Lang::get("DIAGNOSTICS"), 395, 0, font);
+
+		if (history.empty()) Gui::DrawStringCentered(0, 100, 0.5f, UIThemes->TextColor(), Lang::get("NO_TRANSFERS"), 390, 0, font);
+		else DrawStats(history[selection]);
+
+		Gui::Draw_Rect(0, 215, 400, 25, UIThemes->BarColor());
+		Gui::Draw_Rect(0, 214, 400, 1, UIThemes->BarOutline());
+		Gui::DrawStringCentered(0, 218, 0.6f, UIThemes->TextColor(), TELEMETRY_LOG_PATH, 390, 0, font);
+
+		Animation::QueueEntryDone();
+		GFX::DrawBottom();
+
+		for (int i = 0; i < 7 && sPos + i < (int)history.size(); i++) {
+			if (sPos + i == selection) Gui::Draw_Rect(mainButtons[i].x, mainButtons[i].y, mainButtons[i].w, mainButtons[i].h, UIThemes->MarkSelected());
+			Gui::DrawStringCentered(10 - 160 + (300 / 2), mainButtons[i].y + 4, 0.45f, UIThemes->TextColor(), getName(history[sPos + i].URL), 295, 0, font);
+		}
+
+		C3D_FrameEnd(0);
+		hidScanInput();
+		u32 hRepeat = hidKeysDownRepeat();
+		Animation::HandleQueueEntryDone();
+
+		if (!history.empty()) {
+			if (hRepeat & KEY_DOWN) {
+				if (selection < (int)history.size() - 1) selection++;
+				else selection = 0;
+			}
+
+			if (hRepeat & KEY_UP) {
+				if (selection > 0) selection--;
+				else selection = history.size() - 1;
+			}
+
+			if (selection < sPos) sPos = selection;
+			else if (selection > sPos + 7 - 1) sPos = selection - 7 + 1;
+		}
+
+		if ((hidKeysDown() & KEY_START) || (hidKeysDown() & KEY_B)) doOut = true;
+	}
+}
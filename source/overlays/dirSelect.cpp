@@ -28,6 +28,7 @@
 #include "common.hpp"
 #include "fileBrowse.hpp"
 #include "overlay.hpp"
+#include "storeSheets.hpp"
 #include "storeUtils.hpp"
 #include <unistd.h>
 
@@ -67,11 +68,11 @@ std::string Overlays::SelectDir(const std::string &oldDir, const std::string &ms
 		C2D_TargetClear(Top, TRANSPARENT);
 		C2D_TargetClear(Bottom, TRANSPARENT);
 
-		if (StoreUtils::store && config->usebg() && StoreUtils::store->customBG()) {
+		if (StoreUtils::store && config->usebg() && StoreSheets::HasBG()) {
 			Gui::ScreenDraw(Top);
 			Gui::Draw_Rect(0, 0, 400, 25, UIThemes->BarColor());
 			Gui::Draw_Rect(0, 25, 400, 1, UIThemes->BarOutline());
-			C2D_DrawImageAt(StoreUtils::store->GetStoreImg(), 0, 26, 0.5f, nullptr);
+			C2D_DrawImageAt(StoreSheets::BG(), 0, 26, 0.5f, nullptr);
 
 		} else {
 			GFX::DrawTop();
@@ -33,6 +33,7 @@
 #include "overlay.hpp"
 #include "qrcode.hpp"
 #include "scriptUtils.hpp"
+#include "storeSheets.hpp"
 #include "storeUtils.hpp"
 #include <unistd.h>
 
@@ -124,19 +125,7 @@ static bool DownloadStore() {
 				const std::vector<std::string> locs = storeJson["storeInfo"]["sheetURL"].get<std::vector<std::string>>();
 				const std::vector<std::string> sht = storeJson["storeInfo"]["sheet"].get<std::vector<std::string>>();
 
-				if (locs.size() == sht.size()) {
-					for (int i = 0; i < (int)sht.size(); i++) {
-						if (!(sht[i].find("/") != std::string::npos)) {
-							char msg[150];
-							snprintf(msg, sizeof(msg), Lang::get("DOWNLOADING_SPRITE_SHEET2").c_str(), i + 1, sht.size());
-							Msg::DisplayMsg(msg);
-							DownloadSpriteSheet(locs[i], sht[i]);
-
-						} else {
-							Msg::waitMsg(Lang::get("SHEET_SLASH"));
-						}
-					}
-				}
+				if (locs.size() == sht.size()) DownloadSpriteSheets(locs, sht, Lang::get("DOWNLOADING_SPRITE_SHEET2"));
 			}
 
 		} else if (storeJson["storeInfo"].contains("sheetURL") && storeJson["storeInfo"]["sheetURL"].is_string()) {
@@ -180,19 +169,7 @@ static bool UpdateStore(const std::string &URL) {
 				const std::vector<std::string> locs = storeJson["storeInfo"]["sheetURL"].get<std::vector<std::string>>();
 				const std::vector<std::string> sht = storeJson["storeInfo"]["sheet"].get<std::vector<std::string>>();
 
-				if (locs.size() == sht.size()) {
-					for (int i = 0; i < (int)sht.size(); i++) {
-						if (!(sht[i].find("/") != std::string::npos)) {
-							char msg[150];
-							snprintf(msg, sizeof(msg), Lang::get("DOWNLOADING_SPRITE_SHEET2").c_str(), i + 1, sht.size());
-							Msg::DisplayMsg(msg);
-							DownloadSpriteSheet(locs[i], sht[i]);
-
-						} else {
-							Msg::waitMsg(Lang::get("SHEET_SLASH"));
-						}
-					}
-				}
+				if (locs.size() == sht.size()) DownloadSpriteSheets(locs, sht, Lang::get("DOWNLOADING_SPRITE_SHEET2"));
 			}
 
 		} else if (storeJson["storeInfo"].contains("sheetURL") && storeJson["storeInfo"]["sheetURL"].is_string()) {
@@ -235,11 +212,11 @@ void Overlays::SelectStore() {
 		C2D_TargetClear(Top, TRANSPARENT);
 		C2D_TargetClear(Bottom, TRANSPARENT);
 
-		if (StoreUtils::store && config->usebg() && StoreUtils::store->customBG()) {
+		if (StoreUtils::store && config->usebg() && StoreSheets::HasBG()) {
 			Gui::ScreenDraw(Top);
 			Gui::Draw_Rect(0, 0, 400, 25, UIThemes->BarColor());
 			Gui::Draw_Rect(0, 25, 400, 1, UIThemes->BarOutline());
-			C2D_DrawImageAt(StoreUtils::store->GetStoreImg(), 0, 26, 0.5f, nullptr);
+			C2D_DrawImageAt(StoreSheets::BG(), 0, 26, 0.5f, nullptr);
 
 		} else {
 			GFX::DrawTop();
@@ -316,7 +293,7 @@ void Overlays::SelectStore() {
 						else if (info[selection].Version > _UNISTORE_VERSION) Msg::waitMsg(Lang::get("UNISTORE_TOO_NEW"));
 						else {
 							config->lastStore(info[selection].FileName);
-							StoreUtils::store = std::make_unique<Store>(_STORE_PATH + info[selection].FileName, info[selection].FileName);
+							StoreUtils::LoadStore(_STORE_PATH + info[selection].FileName, info[selection].FileName);
 							StoreUtils::ResetAll();
 							StoreUtils::SortEntries(false, SortType::LAST_UPDATED);
 							doOut = true;
@@ -338,7 +315,7 @@ void Overlays::SelectStore() {
 								else if (info[i + sPos].Version > _UNISTORE_VERSION) Msg::waitMsg(Lang::get("UNISTORE_TOO_NEW"));
 								else {
 									config->lastStore(info[i + sPos].FileName);
-									StoreUtils::store = std::make_unique<Store>(_STORE_PATH + info[i + sPos].FileName, info[i + sPos].FileName);
+									StoreUtils::LoadStore(_STORE_PATH + info[i + sPos].FileName, info[i + sPos].FileName);
 									StoreUtils::ResetAll();
 									StoreUtils::SortEntries(false, SortType::LAST_UPDATED);
 									doOut = true;
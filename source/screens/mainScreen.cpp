@@ -29,6 +29,7 @@
 #include "fileBrowse.hpp"
 #include "mainScreen.hpp"
 #include "queueSystem.hpp"
+#include "scheduler.hpp"
 #include "screenshot.hpp"
 #include "storeUtils.hpp"
 #include <unistd.h>
@@ -75,8 +76,8 @@ MainScreen::MainScreen() {
 		if (access("sdmc:/3ds/Universal-Updater/stores/universal-db.unistore", F_OK) != 0) {
 			if (checkWifiStatus()) {
 				std::string tmp = ""; // Just a temp.
-				DownloadUniStore("https://db.universal-team.net/unistore/universal-db.unistore", -1, tmp, true, true);
-				DownloadSpriteSheet("https://db.universal-team.net/unistore/universal-db.t3x", "universal-db.t3x");
+				DownloadUniStore(UNIVERSAL_DB_URL "/unistore/universal-db.unistore", -1, tmp, true, true);
+				DownloadSpriteSheet(UNIVERSAL_DB_URL "/unistore/universal-db.t3x", "universal-db.t3x");
 
 			} else {
 				notConnectedMsg();
@@ -88,8 +89,8 @@ MainScreen::MainScreen() {
 			if (info.Version != 3 && info.Version != _UNISTORE_VERSION) {
 				if (checkWifiStatus()) {
 					std::string tmp = ""; // Just a temp.
-					DownloadUniStore("https://db.universal-team.net/unistore/universal-db.unistore", -1, tmp, true, true);
-					DownloadSpriteSheet("https://db.universal-team.net/unistore/universal-db.t3x", "universal-db.t3x");
+					DownloadUniStore(UNIVERSAL_DB_URL "/unistore/universal-db.unistore", -1, tmp, true, true);
+					DownloadSpriteSheet(UNIVERSAL_DB_URL "/unistore/universal-db.t3x", "universal-db.t3x");
 
 				} else {
 					notConnectedMsg();
@@ -98,7 +99,7 @@ MainScreen::MainScreen() {
 		}
 	}
 
-	StoreUtils::store = std::make_unique<Store>(_STORE_PATH + config->lastStore(), config->lastStore());
+	StoreUtils::LoadStore(_STORE_PATH + config->lastStore(), config->lastStore());
 	StoreUtils::ResetAll();
 	StoreUtils::SortEntries(false, SortType::LAST_UPDATED);
 	DisplayChangelog();
@@ -230,6 +231,21 @@ void MainScreen::Logic(u32 hDown, u32 hHeld, touchPosition touch) {
 
 		StoreUtils::SideMenuHandle(storeMode, this->fetchDown, this->lastMode);
 
+		/* Prepare the downloads of the entry the user stays on or opens the download list of. */
+		if (StoreUtils::store && StoreUtils::store->GetValid() && StoreUtils::store->GetEntry() < (int)StoreUtils::entries.size()) {
+			const StoreEntry *entry = StoreUtils::entries[StoreUtils::store->GetEntry()].get();
+
+			if (entry != this->selectedEntry) {
+				this->selectedEntry = entry;
+				this->selectedAt = osGetTime();
+			}
+
+			if (entry != this->prefetchedEntry && (this->fetchDown || osGetTime() - this->selectedAt >= PREFETCH_DELAY)) {
+				this->prefetchedEntry = entry;
+				StoreUtils::Prefetch(StoreUtils::entries[StoreUtils::store->GetEntry()]);
+			}
+		}
+
 		/* Fetch Download list. */
 		if (this->fetchDown) {
 			this->installs.clear();
@@ -24,9 +24,12 @@
 *         reasonable ways as different from the original version.
 */
 
-#include "common.hpp"
+#include "config.hpp"
 #include "fileBrowse.hpp"
+#include "lang.hpp"
 #include "meta.hpp"
+#include "platform.hpp"
+#include "storeDefs.hpp"
 #include <unistd.h>
 
 /*
@@ -34,23 +37,30 @@
 
 	Includes MetaData file creation, if non existent.
 */
-Meta::Meta() {
-	if (access(_META_PATH, F_OK) != 0) {
-		FILE *temp = fopen(_META_PATH, "w");
+Meta::Meta() : Meta(_META_PATH) {
+	if (config->metadata()) this->ImportMetadata();
+}
+
+/*
+	Load the Meta from another file, which also gets written on destructor.
+
+	const std::string &file: Const Reference to the MetaData file.
+*/
+Meta::Meta(const std::string &file) : file(file) {
+	if (access(this->file.c_str(), F_OK) != 0) {
+		FILE *temp = fopen(this->file.c_str(), "w");
 		char tmp[2] = { '{', '}' };
 		fwrite(tmp, sizeof(tmp), 1, temp);
 		fclose(temp);
 	}
 
-	FILE *temp = fopen(_META_PATH, "rt");
+	FILE *temp = fopen(this->file.c_str(), "rt");
 	if (temp) {
 		this->metadataJson = nlohmann::json::parse(temp, nullptr, false);
 		fclose(temp);
 	}
 	if (this->metadataJson.is_discarded())
 		this->metadataJson = { };
-
-	if (config->metadata()) this->ImportMetadata();
 }
 
 /*
@@ -62,7 +72,7 @@ void Meta::ImportMetadata() {
 		return; // Not found.
 	}
 
-	Msg::DisplayMsg(Lang::get("FETCHING_METADATA"));
+	Platform::DisplayMsg(Lang::get("FETCHING_METADATA"));
 
 	nlohmann::json oldJson;
 	FILE *old = fopen("sdmc:/3ds/Universal-Updater/updates.json", "rt");
@@ -160,7 +170,7 @@ std::vector<std::string> Meta::GetInstalled(const std::string &unistoreName, con
 	Write to file.. called on destructor.
 */
 void Meta::SaveCall() {
-	FILE *file = fopen(_META_PATH, "wb");
+	FILE *file = fopen(this->file.c_str(), "wb");
 	const std::string dump = this->metadataJson.dump(1, '\t');
 	fwrite(dump.c_str(), 1, dump.size(), file);
 	fclose(file);
@@ -24,25 +24,18 @@
 *         reasonable ways as different from the original version.
 */
 
-#include "common.hpp"
-#include "download.hpp"
-#include "gui.hpp"
-#include "scriptUtils.hpp"
+#include "lang.hpp"
+#include "platform.hpp"
 #include "store.hpp"
-#include <unistd.h>
-
-extern C2D_SpriteSheet sprites;
-extern bool checkWifiStatus();
-static bool firstStart = true;
+#include <3ds.h>
 
 /*
-	Initialize a Store.
+	Initialize a Store. This only loads the file; StoreUtils::LoadStore updates it and loads its SpriteSheets as well.
 
 	const std::string &file: The UniStore file.
 	const std::string &file2: The UniStore file.. without full path.
-	bool ARGMode: If Argument mode.
 */
-Store::Store(const std::string &file, const std::string &file2, bool ARGMode) {
+Store::Store(const std::string &file, const std::string &file2) {
 	if (file.length() > 4) {
 		if(*(u32*)(file.c_str() + file.length() - 4) == (0xE0DED0E << 3 | (2 + 1))) {
 			this->valid = false;
@@ -51,172 +44,32 @@ Store::Store(const std::string &file, const std::string &file2, bool ARGMode) {
 	}
 
 	this->fileName = file2;
-
-	if (!ARGMode) {
-		this->update(file);
-		this->SetC2DBGImage();
-
-	} else {
-		this->LoadFromFile(file);
-	}
+	this->LoadFromFile(file);
 };
 
 /*
-	Update an UniStore, including SpriteSheet, if revision increased.
-
-	const std::string &file: Const Reference to the fileName.
+	Return the SpriteSheet files of the UniStore. Empty for one, which isn't a plain filename.
 */
-void Store::update(const std::string &file) {
-	bool doSheet = false;
-	this->LoadFromFile(file);
-
-	int rev = -1;
-
-	/* Only do this, if valid. */
-	if (this->valid) {
-		if (this->storeJson["storeInfo"].contains("revision") && this->storeJson["storeInfo"]["revision"].is_number()) {
-			rev = this->storeJson["storeInfo"]["revision"];
-		}
-
-		/* First start exceptions. */
-		if (firstStart) {
-			firstStart = false;
-
-			if (!config->autoupdate()) {
-				this->loadSheets();
-				return;
-			}
-		}
+std::vector<std::string> Store::GetSheets() const {
+	if (!this->valid) return { };
+	std::vector<std::string> sheetLocs;
 
-		if (this->storeJson.contains("storeInfo")) {
-			/* Checking... */
-			if (checkWifiStatus()) { // Only do, if WiFi available.
-				if (this->storeJson["storeInfo"].contains("url") && this->storeJson["storeInfo"]["url"].is_string()) {
-					if (this->storeJson["storeInfo"].contains("file") && this->storeJson["storeInfo"]["file"].is_string()) {
-
-						const std::string fl = this->storeJson["storeInfo"]["file"];
-						if (!(fl.find("/") != std::string::npos)) {
-							const std::string URL = this->storeJson["storeInfo"]["url"];
-
-							if (URL != "") {
-								std::string tmp = "";
-								doSheet = DownloadUniStore(URL, rev, tmp);
-							}
-
-						} else {
-							Msg::waitMsg(Lang::get("FILE_SLASH"));
-						}
-					}
-				}
-
-				if (doSheet) {
-					/* SpriteSheet Array. */
-					if (this->storeJson["storeInfo"].contains("sheetURL") && this->storeJson["storeInfo"]["sheetURL"].is_array()) {
-						if (this->storeJson["storeInfo"].contains("sheet") && this->storeJson["storeInfo"]["sheet"].is_array()) {
-							const std::vector<std::string> locs = this->storeJson["storeInfo"]["sheetURL"].get<std::vector<std::string>>();
-							const std::vector<std::string> sht = this->storeJson["storeInfo"]["sheet"].get<std::vector<std::string>>();
-
-							if (locs.size() == sht.size()) {
-								for (int i = 0; i < (int)sht.size(); i++) {
-									if (!(sht[i].find("/") != std::string::npos)) {
-										char msg[150];
-										snprintf(msg, sizeof(msg), Lang::get("UPDATING_SPRITE_SHEET2").c_str(), i + 1, sht.size());
-										Msg::DisplayMsg(msg);
-										DownloadSpriteSheet(locs[i], sht[i]);
-
-									} else {
-										Msg::waitMsg(Lang::get("SHEET_SLASH"));
-										i++;
-									}
-								}
-							}
-						}
-
-						/* Single SpriteSheet (No array). */
-					} else if (this->storeJson["storeInfo"].contains("sheetURL") && this->storeJson["storeInfo"]["sheetURL"].is_string()) {
-						if (this->storeJson["storeInfo"].contains("sheet") && this->storeJson["storeInfo"]["sheet"].is_string()) {
-							const std::string fl = this->storeJson["storeInfo"]["sheetURL"];
-							const std::string fl2 = this->storeJson["storeInfo"]["sheet"];
-
-							if (!(fl2.find("/") != std::string::npos)) {
-								Msg::DisplayMsg(Lang::get("UPDATING_SPRITE_SHEET"));
-								DownloadSpriteSheet(fl, fl2);
-
-							} else {
-								Msg::waitMsg(Lang::get("SHEET_SLASH"));
-							}
-						}
-					}
-				}
-			}
+	if (this->storeJson["storeInfo"].contains("sheet")) {
+		if (this->storeJson["storeInfo"]["sheet"].is_array()) {
+			sheetLocs = this->storeJson["storeInfo"]["sheet"].get<std::vector<std::string>>();
 
-			this->LoadFromFile(file);
-			this->loadSheets();
+		} else if (this->storeJson["storeInfo"]["sheet"].is_string()) {
+			sheetLocs.push_back(this->storeJson["storeInfo"]["sheet"]);
 		}
 	}
-}
-
-/*
-	Unload all SpriteSheets on Destructor.
-*/
-Store::~Store() { this->unloadSheets(); };
 
-/*
-	Unload all SpriteSheets.
-*/
-void Store::unloadSheets() {
-	if (this->valid) {
-		if (this->sheets.size() > 0) {
-			for (int i = 0; i < (int)this->sheets.size(); i++) {
-				if (this->sheets[i]) C2D_SpriteSheetFree(this->sheets[i]);
-			}
-		}
-
-		this->sheets.clear();
+	for (std::string &sheet : sheetLocs) {
+		if (sheet.find("/") != std::string::npos) sheet = "";
 	}
-}
 
-/*
-	Load all SpriteSheets.
-*/
-void Store::loadSheets() {
-	if (this->valid) {
-		if (this->storeJson["storeInfo"].contains("sheet")) {
-			this->unloadSheets();
-
-			std::vector<std::string> sheetLocs = { "" };
-
-			if (this->storeJson["storeInfo"]["sheet"].is_array()) {
-				sheetLocs = this->storeJson["storeInfo"]["sheet"].get<std::vector<std::string>>();
-
-			} else if (this->storeJson["storeInfo"]["sheet"].is_string()) {
-				sheetLocs[0] = this->storeJson["storeInfo"]["sheet"];
-
-			} else {
-				return;
-			}
-
-			for (int i = 0; i < (int)sheetLocs.size(); i++) {
-				this->sheets.push_back({ });
-
-				if (sheetLocs[i] != "") {
-					if (sheetLocs[i].find("/") == std::string::npos) {
-						if (access((std::string(_STORE_PATH) + sheetLocs[i]).c_str(), F_OK) == 0) {
-
-							char msg[150];
-							snprintf(msg, sizeof(msg), Lang::get("LOADING_SPRITESHEET").c_str(), i + 1, sheetLocs.size());
-							Msg::DisplayMsg(msg);
-
-							this->sheets[i] = C2D_SpriteSheetLoad((std::string(_STORE_PATH) + sheetLocs[i]).c_str());
-						}
-					}
-				}
-			}
-		}
-	}
+	return sheetLocs;
 }
 
-
 /*
 	Load a UniStore from a file.
 
@@ -237,15 +90,15 @@ void Store::LoadFromFile(const std::string &file) {
 	/* Check, if valid. */
 	if (this->storeJson.contains("storeInfo") && this->storeJson.contains("storeContent")) {
 		if (this->storeJson["storeInfo"].contains("version") && this->storeJson["storeInfo"]["version"].is_number()) {
-			if (this->storeJson["storeInfo"]["version"] < 3) Msg::waitMsg(Lang::get("UNISTORE_TOO_OLD"));
-			else if (this->storeJson["storeInfo"]["version"] > _UNISTORE_VERSION) Msg::waitMsg(Lang::get("UNISTORE_TOO_NEW"));
+			if (this->storeJson["storeInfo"]["version"] < 3) Platform::WaitMsg(Lang::get("UNISTORE_TOO_OLD"));
+			else if (this->storeJson["storeInfo"]["version"] > _UNISTORE_VERSION) Platform::WaitMsg(Lang::get("UNISTORE_TOO_NEW"));
 			else if (this->storeJson["storeInfo"]["version"] == 3 || this->storeJson["storeInfo"]["version"] == _UNISTORE_VERSION) {
 				this->valid = true;
 			}
 		}
 
 	} else {
-		Msg::waitMsg(Lang::get("UNISTORE_INVALID_ERROR"));
+		Platform::WaitMsg(Lang::get("UNISTORE_INVALID_ERROR"));
 	}
 }
 
@@ -405,67 +258,46 @@ std::string Store::GetLicenseEntry(int index) const {
 }
 
 /*
-	Return a C2D_Image of an index.
+	Return where the icon of an index is on the SpriteSheets.
 
 	int index: The index.
 */
-C2D_Image Store::GetIconEntry(int index) const {
-	if (!this->valid) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
-	if (this->sheets.empty()) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
-	int iconIndex = -1, sheetIndex = 0;
-
-	if (index > (int)this->storeJson["storeContent"].size() - 1) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
+StoreImage Store::GetIconEntry(int index) const {
+	StoreImage icon;
+	if (!this->valid) return icon;
+	if (index > (int)this->storeJson["storeContent"].size() - 1) return icon;
 
 	if (this->storeJson["storeContent"][index]["info"].contains("icon_index") && this->storeJson["storeContent"][index]["info"]["icon_index"].is_number()) {
-		iconIndex = this->storeJson["storeContent"][index]["info"]["icon_index"];
+		icon.Index = this->storeJson["storeContent"][index]["info"]["icon_index"];
 	}
 
 	if (this->storeJson["storeContent"][index]["info"].contains("sheet_index") && this->storeJson["storeContent"][index]["info"]["sheet_index"].is_number()) {
-		sheetIndex = this->storeJson["storeContent"][index]["info"]["sheet_index"];
+		icon.Sheet = this->storeJson["storeContent"][index]["info"]["sheet_index"];
 	}
 
-	if (iconIndex == -1) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
-
-	if (sheetIndex > (int)this->sheets.size()) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
-	if (!this->sheets[sheetIndex]) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
-
-	if (iconIndex > (int)C2D_SpriteSheetCount(this->sheets[sheetIndex])-1) return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
-
-	C2D_Image temp = C2D_SpriteSheetGetImage(this->sheets[sheetIndex], iconIndex);
-	if (temp.subtex->width < 49 && temp.subtex->height < 49) return temp; // up to 48x48 is valid.
-
-	return C2D_SpriteSheetGetImage(sprites, sprites_noIcon_idx);
+	return icon;
 }
 
 /*
-	Set's the custom BG to the storeBG variable.
+	Return where the custom BG of the UniStore is on the SpriteSheets.
 */
-void Store::SetC2DBGImage() {
-	if (!this->valid) return;
-	if (this->sheets.empty()) return;
-	int index = -1, sheetIndex = -1;
+StoreImage Store::GetBGEntry() const {
+	StoreImage bg;
+	if (!this->valid) return bg;
 
 	if (this->storeJson["storeInfo"].contains("bg_index") && this->storeJson["storeInfo"]["bg_index"].is_number()) {
-		index = this->storeJson["storeInfo"]["bg_index"];
+		bg.Index = this->storeJson["storeInfo"]["bg_index"];
 	}
 
+	/* Unlike the icons, the BG has no default sheet. */
 	if (this->storeJson["storeInfo"].contains("bg_sheet") && this->storeJson["storeInfo"]["bg_sheet"].is_number()) {
-		sheetIndex = this->storeJson["storeInfo"]["bg_sheet"];
-	}
-
-	if (index == -1 || sheetIndex == -1) return;
-
-	if (sheetIndex > (int)this->sheets.size()) return;
-	if (!this->sheets[sheetIndex]) return;
-
-	if (index > (int)C2D_SpriteSheetCount(this->sheets[sheetIndex])-1) return;
+		bg.Sheet = this->storeJson["storeInfo"]["bg_sheet"];
 
-	C2D_Image temp = C2D_SpriteSheetGetImage(this->sheets[sheetIndex], index);
-
-	if (temp.subtex->width == 400 && temp.subtex->height == 214) {
-		this->hasCustomBG = true;
-		this->storeBG = temp; // Must be 400x214.
+	} else {
+		bg.Index = -1;
 	}
+
+	return bg;
 }
 
 /*
@@ -0,0 +1,129 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "common.hpp"
+#include "download.hpp"
+#include "storeSheets.hpp"
+#include "storeUtils.hpp"
+
+static bool firstStart = true;
+
+/*
+	Update an UniStore, including SpriteSheet, if revision increased.
+
+	const std::unique_ptr<Store> &store: Const Reference to the loaded UniStore.
+	Returns true, if it has to be loaded again.
+*/
+static bool updateStore(const std::unique_ptr<Store> &store) {
+	bool doSheet = false;
+	nlohmann::json &storeJson = store->GetJson();
+
+	int rev = -1;
+	if (storeJson["storeInfo"].contains("revision") && storeJson["storeInfo"]["revision"].is_number()) {
+		rev = storeJson["storeInfo"]["revision"];
+	}
+
+	/* First start exceptions. */
+	if (firstStart) {
+		firstStart = false;
+		if (!config->autoupdate()) return false;
+	}
+
+	if (!storeJson.contains("storeInfo")) return false;
+
+	/* Checking... */
+	if (checkWifiStatus()) { // Only do, if WiFi available.
+		if (storeJson["storeInfo"].contains("url") && storeJson["storeInfo"]["url"].is_string()) {
+			if (storeJson["storeInfo"].contains("file") && storeJson["storeInfo"]["file"].is_string()) {
+
+				const std::string fl = storeJson["storeInfo"]["file"];
+				if (!(fl.find("/") != std::string::npos)) {
+					const std::string URL = storeJson["storeInfo"]["url"];
+
+					if (URL != "") {
+						std::string tmp = "";
+						std::vector<std::string> mirrors;
+
+						/* Other places, which serve the same UniStore, in case the URL is down. */
+						if (storeJson["storeInfo"].contains("mirrors") && storeJson["storeInfo"]["mirrors"].is_array()) {
+							for (const auto &mirror : storeJson["storeInfo"]["mirrors"]) {
+								if (mirror.is_string()) mirrors.push_back(mirror);
+							}
+						}
+
+						doSheet = DownloadUniStore(URL, rev, tmp, false, false, mirrors);
+					}
+
+				} else {
+					Msg::waitMsg(Lang::get("FILE_SLASH"));
+				}
+			}
+		}
+
+		if (doSheet) {
+			/* SpriteSheet Array. */
+			if (storeJson["storeInfo"].contains("sheetURL") && storeJson["storeInfo"]["sheetURL"].is_array()) {
+				if (storeJson["storeInfo"].contains("sheet") && storeJson["storeInfo"]["sheet"].is_array()) {
+					const std::vector<std::string> locs = storeJson["storeInfo"]["sheetURL"].get<std::vector<std::string>>();
+					const std::vector<std::string> sht = storeJson["storeInfo"]["sheet"].get<std::vector<std::string>>();
+
+					if (locs.size() == sht.size()) DownloadSpriteSheets(locs, sht, Lang::get("UPDATING_SPRITE_SHEET2"));
+				}
+
+				/* Single SpriteSheet (No array). */
+			} else if (storeJson["storeInfo"].contains("sheetURL") && storeJson["storeInfo"]["sheetURL"].is_string()) {
+				if (storeJson["storeInfo"].contains("sheet") && storeJson["storeInfo"]["sheet"].is_string()) {
+					const std::string fl = storeJson["storeInfo"]["sheetURL"];
+					const std::string fl2 = storeJson["storeInfo"]["sheet"];
+
+					if (!(fl2.find("/") != std::string::npos)) {
+						Msg::DisplayMsg(Lang::get("UPDATING_SPRITE_SHEET"));
+						DownloadSpriteSheet(fl, fl2);
+
+					} else {
+						Msg::waitMsg(Lang::get("SHEET_SLASH"));
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+	Load an UniStore as the current one: Update it, if its revision increased, and load its SpriteSheets.
+
+	const std::string &file: Const Reference to the UniStore file.
+	const std::string &fileName: Const Reference to the UniStore file.. without full path.
+*/
+void StoreUtils::LoadStore(const std::string &file, const std::string &fileName) {
+	StoreSheets::Unload(); // The old UniStore's images go with it.
+	StoreUtils::store = std::make_unique<Store>(file, fileName);
+
+	if (StoreUtils::store->GetValid() && updateStore(StoreUtils::store)) StoreUtils::store->LoadFromFile(file);
+	StoreSheets::Load(StoreUtils::store);
+}
@@ -24,9 +24,10 @@
 *         reasonable ways as different from the original version.
 */
 
-#include "common.hpp"
 #include "queueSystem.hpp"
 #include "storeUtils.hpp"
+#include <algorithm>
+#include <strings.h>
 
 std::unique_ptr<Meta> StoreUtils::meta = nullptr;
 std::unique_ptr<Store> StoreUtils::store = nullptr;
@@ -186,13 +187,19 @@ void StoreUtils::RefreshUpdateAVL() {
 	}
 }
 
-void StoreUtils::AddToQueue(int index, const std::string &entry, const std::string &entryName, const std::string &lUpdated) {
-	if (!StoreUtils::store || !StoreUtils::store->GetValid()) return;
+/*
+	Return the script of a download entry, or null, if there is no valid one.
+
+	int index: The index of the store entry.
+	const std::string &entry: Const Reference to the name of the download entry.
+*/
+nlohmann::json StoreUtils::GetScript(int index, const std::string &entry) {
+	if (!StoreUtils::store || !StoreUtils::store->GetValid()) return nullptr;
 
 	/* Check first for proper JSON. */
-	if (!StoreUtils::store->GetJson().contains("storeContent")) return;
-	if ((int)StoreUtils::store->GetJson()["storeContent"].size() < index) return;
-	if (!StoreUtils::store->GetJson()["storeContent"][index].contains(entry)) return;
+	if (!StoreUtils::store->GetJson().contains("storeContent")) return nullptr;
+	if ((int)StoreUtils::store->GetJson()["storeContent"].size() < index) return nullptr;
+	if (!StoreUtils::store->GetJson()["storeContent"][index].contains(entry)) return nullptr;
 
 	nlohmann::json Script = nullptr;
 
@@ -203,13 +210,36 @@ void StoreUtils::AddToQueue(int index, const std::string &entry, const std::stri
 	} else if (StoreUtils::store->GetJson()["storeContent"][index][entry].type() == nlohmann::json::value_t::object) {
 		if (StoreUtils::store->GetJson()["storeContent"][index][entry].contains("script") && StoreUtils::store->GetJson()["storeContent"][index][entry]["script"].is_array()) {
 			Script = StoreUtils::store->GetJson()["storeContent"][index][entry]["script"];
-
-		} else {
-			return;
 		}
 	}
 
-	QueueSystem::AddToQueue(Script, StoreUtils::store->GetIconEntry(index), entry, StoreUtils::store->GetUniStoreTitle(), entryName, lUpdated); // Here we add this to the Queue at the end.
+	return Script;
+}
+
+/*
+	Return the bytes, the downloads of a script need on the SD card, 0 if unknown.
+	It is the sum of the numeric "size" fields of its download steps; the "size" string of the download list is for display only.
+
+	const nlohmann::json &script: Const Reference to the script.
+*/
+static u64 scriptSize(const nlohmann::json &script) {
+	u64 size = 0;
+
+	for (const auto &step : script) {
+		if (!step.is_object() || !step.contains("type") || !step["type"].is_string()) continue;
+		if (step["type"] != "downloadFile" && step["type"] != "downloadRelease") continue;
+
+		if (step.contains("size") && step["size"].is_number_unsigned()) size += step["size"].get<u64>();
+	}
+
+	return size;
+}
+
+void StoreUtils::AddToQueue(int index, const std::string &entry, const std::string &entryName, const std::string &lUpdated) {
+	const nlohmann::json Script = StoreUtils::GetScript(index, entry);
+	if (Script.is_null()) return;
+
+	QueueSystem::AddToQueue(Script, StoreUtils::store->GetIconEntry(index), entry, StoreUtils::store->GetUniStoreTitle(), entryName, lUpdated, scriptSize(Script)); // Here we add this to the Queue at the end.
 }
 
 /*
@@ -137,10 +137,15 @@ static int frame = 0; // 0 - 7.
 static int advanceFrame = 0; // Only animate every 4 frames.
 extern bool QueueRuns;
 extern std::deque<std::unique_ptr<Queue>> queueEntries;
+extern LightLock queueLock;
 
 void Animation::DrawQueue(int x, int y) {
+	LightLock_Lock(&queueLock);
+	const size_t count = queueEntries.size();
+	LightLock_Unlock(&queueLock);
+
 	GFX::DrawIcon(sprites_queue0_idx + frame, x, y);
-	Gui::DrawStringCentered(x + 20 - 160, y + 11, 0.6f, UIThemes->SideBarIconColor(), QueueSystem::Wait ? "!" : std::to_string(queueEntries.size()), 0, 0, font);
+	Gui::DrawStringCentered(x + 20 - 160, y + 11, 0.6f, UIThemes->SideBarIconColor(), QueueSystem::Wait ? "!" : std::to_string(count), 0, 0, font);
 }
 void Animation::QueueAnimHandle() {
 	if (QueueRuns) {
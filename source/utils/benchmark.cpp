@@ -0,0 +1,245 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifdef BENCHMARK
+
+#include "benchmark.hpp"
+#include "common.hpp"
+#include "queueSystem.hpp"
+#include "storeUtils.hpp"
+
+#include <algorithm>
+#include <malloc.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCHMARK_MEMORY_FACTOR 8 // Rough heap usage of a loaded UniStore and its entries, compared to the file size.
+
+/*
+	Allocation tracking. The Makefile wraps these, when building with BENCHMARK=1.
+
+	Every allocation and free then also takes the lock and calls malloc_usable_size, so the times of allocation heavy operations
+	include that and are only comparable with other BENCHMARK builds. The host benchmark ('make bench' in host) times the same operations without it.
+*/
+extern "C" {
+	void *__real_malloc(size_t size);
+	void *__real_calloc(size_t count, size_t size);
+	void *__real_realloc(void *ptr, size_t size);
+	void *__real_memalign(size_t align, size_t size);
+	void __real_free(void *ptr);
+}
+
+static LightLock trackLock = 1; // Unlocked.
+static u32 allocCount = 0;
+static u64 allocBytes = 0;
+static s64 heapUsed = 0, heapPeak = 0;
+
+/*
+	Track a change of the heap.
+
+	size_t freed: The size, which got freed.
+	void *ptr: The new allocation, or nullptr.
+*/
+static void track(size_t freed, void *ptr) {
+	const size_t size = ptr ? malloc_usable_size(ptr) : 0;
+
+	LightLock_Lock(&trackLock);
+	heapUsed += (s64)size - (s64)freed;
+	if (heapUsed > heapPeak) heapPeak = heapUsed;
+
+	if (ptr) {
+		allocCount++;
+		allocBytes += size;
+	}
+
+	LightLock_Unlock(&trackLock);
+}
+
+extern "C" void *__wrap_malloc(size_t size) {
+	void *ptr = __real_malloc(size);
+	if (ptr) track(0, ptr);
+	return ptr;
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t size) {
+	void *ptr = __real_calloc(count, size);
+	if (ptr) track(0, ptr);
+	return ptr;
+}
+
+extern "C" void *__wrap_memalign(size_t align, size_t size) {
+	void *ptr = __real_memalign(align, size);
+	if (ptr) track(0, ptr);
+	return ptr;
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size) {
+	const size_t old = ptr ? malloc_usable_size(ptr) : 0;
+	void *res = __real_realloc(ptr, size);
+
+	if (res || size == 0) track(old, res); // realloc(ptr, 0) frees.
+	return res;
+}
+
+extern "C" void __wrap_free(void *ptr) {
+	if (ptr) track(malloc_usable_size(ptr), nullptr);
+	__real_free(ptr);
+}
+
+/* Room left on the heap; what malloc has free, plus what it can still take with sbrk. */
+extern "C" char *fake_heap_end;
+
+static u64 heapFree() {
+	return (u64)(fake_heap_end - (char *)sbrk(0)) + mallinfo().fordblks;
+}
+
+struct Sample {
+	u64 start;
+	u32 allocs;
+	u64 bytes;
+	s64 base;
+};
+
+static void begin(Sample &sample) {
+	LightLock_Lock(&trackLock);
+	sample.allocs = allocCount;
+	sample.bytes = allocBytes;
+	sample.base = heapUsed;
+	heapPeak = heapUsed;
+	LightLock_Unlock(&trackLock);
+
+	sample.start = svcGetSystemTick();
+}
+
+/*
+	Append a result to BENCHMARK_LOG_PATH.
+
+	const char *op: The operation.
+	int entries: The amount of entries of the UniStore.
+	const nlohmann::json &result: Const Reference to the measured fields.
+*/
+static void writeLog(const char *op, int entries, const nlohmann::json &result) {
+	FILE *log = fopen(BENCHMARK_LOG_PATH, "a");
+	if (!log) return;
+
+	Benchmark::Write(log, C_V, op, entries, result);
+	fclose(log);
+}
+
+/*
+	Log the time, the allocations, the allocated bytes and the peak heap usage since begin.
+
+	const Sample &sample: Const Reference to the sample from begin.
+	const char *op: The operation.
+	int entries: The amount of entries of the UniStore.
+*/
+static void finish(const Sample &sample, const char *op, int entries) {
+	const u64 ticks = svcGetSystemTick() - sample.start;
+
+	LightLock_Lock(&trackLock);
+	const u32 allocs = allocCount - sample.allocs;
+	const u64 bytes = allocBytes - sample.bytes;
+	const s64 peak = heapPeak - sample.base;
+	LightLock_Unlock(&trackLock);
+
+	writeLog(op, entries, { { "us", ticks * 1000000 / SYSCLOCK_ARM11 }, { "allocs", allocs }, { "bytes", bytes }, { "peak", peak } });
+}
+
+/*
+	Generate the UniStores and measure the store handling on each of them.
+	The results get appended to BENCHMARK_LOG_PATH.
+*/
+void Benchmark::Run() {
+	mkdir(BENCHMARK_PATH, 0777);
+
+	for (const int entries : Benchmark::Sizes) {
+		const std::string name = "benchmark-" + std::to_string(entries) + ".unistore";
+		const std::string file = BENCHMARK_PATH + name;
+		const std::string metaFile = BENCHMARK_PATH "meta-" + std::to_string(entries) + ".json";
+
+		Msg::DisplayMsg("Benchmark: Generating a UniStore with " + std::to_string(entries) + " entries...");
+		Benchmark::Generate(entries, file, metaFile);
+
+		struct stat st;
+		if (stat(file.c_str(), &st) != 0) continue;
+
+		/* Without exceptions, running out of memory while parsing would abort; so skip, what won't fit. */
+		if ((u64)st.st_size * BENCHMARK_MEMORY_FACTOR > heapFree()) {
+			writeLog("all", entries, { { "skipped", "memory" } });
+			continue;
+		}
+
+		Msg::DisplayMsg("Benchmark: Measuring " + std::to_string(entries) + " entries...");
+		StoreUtils::meta = std::make_unique<Meta>(metaFile);
+
+		Sample sample;
+		begin(sample);
+		StoreUtils::store = std::make_unique<Store>(file, name); // Only loads the file, without updating it or loading SpriteSheets.
+		finish(sample, "LoadFromFile", entries);
+
+		if (StoreUtils::store->GetValid()) {
+			begin(sample);
+			StoreUtils::ResetAll();
+			finish(sample, "ResetAll", entries);
+
+			begin(sample);
+			StoreUtils::RefreshUpdateAVL();
+			finish(sample, "RefreshUpdateAVL", entries);
+
+			for (const auto &sort : Benchmark::Sorts) {
+				begin(sample);
+				StoreUtils::SortEntries(true, sort.type);
+				finish(sample, sort.op, entries);
+			}
+
+			for (const auto &search : Benchmark::Searches) {
+				StoreUtils::ResetAll();
+				StoreUtils::RefreshUpdateAVL();
+
+				begin(sample);
+				StoreUtils::search(search.query, search.title, search.author, search.category, search.console, search.marks, search.updateAvl, search.isAND);
+				finish(sample, search.op, entries);
+			}
+
+			StoreUtils::ResetAll();
+
+			/* Only fill the queue, without starting it. */
+			QueueSystem::Wait = true;
+			begin(sample);
+			StoreUtils::AddAllToQueue();
+			finish(sample, "AddAllToQueue", entries);
+			QueueSystem::ClearQueue();
+			QueueSystem::Wait = false;
+		}
+
+		StoreUtils::entries.clear();
+		StoreUtils::store = nullptr;
+		StoreUtils::meta = nullptr;
+	}
+}
+
+#endif
@@ -0,0 +1,282 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#ifdef BENCHMARK
+
+/*
+	The UniStore generator of the benchmark. Kept apart from the measuring, so the host build can use it as well.
+*/
+
+#include "benchmark.hpp"
+#include "downloadDefs.hpp"
+#include "json.hpp"
+#include "meta.hpp"
+#include "storeDefs.hpp"
+
+#include <3ds.h>
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCHMARK_SEED 0x2A6F1D35 // The same seed on every run, so every version measures the same UniStores.
+
+static const char *words[] = {
+	"Super", "Pocket", "Retro", "Tiny", "Mega", "Dark", "Star", "Pixel", "Quest", "Craft",
+	"Launcher", "Manager", "Checker", "Explorer", "Player", "Editor", "Dumper", "Loader", "Tools", "Kart",
+	"Puzzle", "Dungeon", "Rocket", "Shadow", "Crystal", "Turbo", "Hyper", "Mini", "Forest", "Ocean"
+};
+
+static const char *lorem[] = {
+	"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do",
+	"eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua", "enim"
+};
+
+static const char *categories[] = { "utility", "game", "emulator", "theme", "app", "firm", "save-tool" };
+static const char *consoles[] = { "3DS", "DS", "GBA", "NES", "SNES" };
+static const char *licenses[] = { "GPL-3.0", "MIT", "Apache-2.0", "BSD-2-Clause", "Unlicense" };
+
+#define ARRAY_SIZE(arr) (int)(sizeof(arr) / sizeof(arr[0]))
+
+/*
+	A xorshift, so the generated UniStores don't depend on the rand() of the libc.
+*/
+static u32 rngState = BENCHMARK_SEED;
+
+static int rnd(int max) {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % max;
+}
+
+/*
+	A date in the format of the UniStores, like "2021-01-10 at 18:31 (UTC)".
+
+	int day: The day, counted from 2016-01-01, with 28 days per month.
+*/
+static std::string makeDate(int day) {
+	char date[32];
+	snprintf(date, sizeof(date), "%04d-%02d-%02d at %02d:%02d (UTC)", 2016 + day / 336, (day / 28) % 12 + 1, day % 28 + 1, rnd(24), rnd(60));
+	return date;
+}
+
+static std::string makeSentence(int minWords, int maxWords) {
+	std::string sentence = "";
+	const int count = minWords + rnd(maxWords - minWords + 1);
+
+	for (int i = 0; i < count; i++) {
+		if (i > 0) sentence += " ";
+		sentence += lorem[rnd(ARRAY_SIZE(lorem))];
+	}
+
+	sentence[0] = toupper(sentence[0]);
+	return sentence + ".";
+}
+
+/* A category or console field; sometimes a string instead of an array, like in older UniStores. */
+static nlohmann::json makeList(const char **items, int count) {
+	const int first = rnd(count);
+	if (rnd(5) == 0) return items[first];
+
+	nlohmann::json list = nlohmann::json::array();
+	list.push_back(items[first]);
+
+	const int extra = rnd(3);
+	for (int i = 1; i <= extra; i++) list.push_back(items[(first + i) % count]);
+
+	return list;
+}
+
+/*
+	The script of a download entry.
+
+	int kind: 0 = 3DSX, 1 = CIA, 2 = NDS, 3 = Nightly archive.
+	const std::string &slug: Const Reference to the file name of the entry.
+	const std::string &repo: Const Reference to the GitHub repository of the entry.
+*/
+static nlohmann::json makeScript(int kind, const std::string &slug, const std::string &repo) {
+	nlohmann::json script = nlohmann::json::array();
+
+	switch(kind) {
+		case 0:
+			script.push_back({ { "type", "downloadRelease" }, { "repo", repo }, { "file", slug + ".*\\.3dsx" }, { "output", "%3DSX%/" + slug + ".3dsx" }, { "includePrereleases", rnd(4) == 0 } });
+			break;
+
+		case 1:
+			script.push_back({ { "type", "downloadRelease" }, { "repo", repo }, { "file", slug + ".*\\.cia" }, { "output", "sdmc:/" + slug + ".cia" } });
+			script.push_back({ { "type", "installCia" }, { "file", "sdmc:/" + slug + ".cia" } });
+			script.push_back({ { "type", "deleteFile" }, { "file", "sdmc:/" + slug + ".cia" } });
+			break;
+
+		case 2:
+			script.push_back({ { "type", "downloadFile" }, { "file", GITHUB_URL "/" + repo + "/releases/download/v1.0/" + slug + ".nds" }, { "output", "%NDS%/" + slug + ".nds" }, { "size", (u32)(0x4000 + rnd(0x400000)) } });
+			break;
+
+		case 3:
+			script.push_back({ { "type", "downloadFile" }, { "file", GITHUB_URL "/" + repo + "/archive/refs/heads/main.zip" }, { "output", "sdmc:/" + slug + ".zip" } });
+			script.push_back({ { "type", "extractFile" }, { "file", "sdmc:/" + slug + ".zip" }, { "input", slug + "-main/" }, { "output", "%3DSX%/" + slug + "/" } });
+			script.push_back({ { "type", "deleteFile" }, { "file", "sdmc:/" + slug + ".zip" } });
+			break;
+	}
+
+	return script;
+}
+
+/*
+	Generate a UniStore with its MetaData.
+	Both get written entry by entry, so even big ones don't need to fit into the memory.
+
+	int entries: The amount of entries.
+	const std::string &file: Const Reference to the UniStore file.
+	const std::string &metaFile: Const Reference to the MetaData file.
+*/
+void Benchmark::Generate(int entries, const std::string &file, const std::string &metaFile) {
+	static const char *downloadNames[] = { ".3dsx", ".cia", ".nds", "-nightly.zip" };
+
+	FILE *store = fopen(file.c_str(), "w");
+	FILE *meta = fopen(metaFile.c_str(), "w");
+
+	if (!store || !meta) {
+		if (store) fclose(store);
+		if (meta) fclose(meta);
+		return;
+	}
+
+	rngState = BENCHMARK_SEED;
+	const std::string title = "Benchmark " + std::to_string(entries);
+
+	const nlohmann::json storeInfo = {
+		{ "title", title },
+		{ "author", "Universal-Team" },
+		{ "description", "A generated UniStore with " + std::to_string(entries) + " entries." },
+		{ "file", "benchmark-" + std::to_string(entries) + ".unistore" },
+		{ "version", _UNISTORE_VERSION },
+		{ "revision", 1 }
+	};
+
+	fprintf(store, "{\"storeInfo\":%s,\"storeContent\":[", storeInfo.dump().c_str());
+	fprintf(meta, "{%s:{", nlohmann::json(title).dump().c_str());
+	bool firstMeta = true;
+
+	for (int i = 0; i < entries; i++) {
+		const std::string entryTitle = std::string(words[rnd(ARRAY_SIZE(words))]) + " " + words[rnd(ARRAY_SIZE(words))] + " " + std::to_string(i);
+		const int authorIndex = rnd(200);
+		const std::string author = std::string(words[authorIndex % ARRAY_SIZE(words)]) + words[(authorIndex / ARRAY_SIZE(words)) % ARRAY_SIZE(words)] + std::to_string(authorIndex);
+
+		std::string slug = entryTitle;
+		for (char &c : slug) c = c == ' ' ? '-' : tolower(c);
+
+		const std::string repo = author + "/" + slug;
+		const int day = rnd(2000);
+
+		nlohmann::json entry;
+		entry["info"] = {
+			{ "title", entryTitle },
+			{ "author", author },
+			{ "description", makeSentence(4, 12) + " " + makeSentence(6, 20) },
+			{ "category", makeList(categories, ARRAY_SIZE(categories)) },
+			{ "console", makeList(consoles, ARRAY_SIZE(consoles)) },
+			{ "version", "v" + std::to_string(rnd(5)) + "." + std::to_string(rnd(10)) + "." + std::to_string(rnd(10)) },
+			{ "last_updated", makeDate(day) },
+			{ "license", licenses[rnd(ARRAY_SIZE(licenses))] },
+			{ "icon_index", i % 256 },
+			{ "sheet_index", i / 256 }
+		};
+
+		const int screenshots = rnd(5);
+		if (screenshots > 0) {
+			entry["info"]["screenshots"] = nlohmann::json::array();
+
+			for (int shot = 0; shot < screenshots; shot++) {
+				entry["info"]["screenshots"].push_back({ { "description", makeSentence(2, 5) }, { "url", UNIVERSAL_DB_URL "/assets/images/screenshots/" + slug + "/" + std::to_string(shot) + ".png" } });
+			}
+		}
+
+		if (rnd(2) == 0) entry["info"]["releasenotes"] = makeSentence(10, 40);
+
+		/* One to three downloads; some in the old format, as plain script without a size. */
+		const int firstKind = rnd(ARRAY_SIZE(downloadNames)), downloads = 1 + rnd(3);
+		std::string firstDownload = "";
+
+		for (int download = 0; download < downloads; download++) {
+			const int kind = (firstKind + download) % ARRAY_SIZE(downloadNames);
+			const std::string name = slug + downloadNames[kind];
+			if (download == 0) firstDownload = name;
+
+			if (rnd(4) == 0) {
+				entry[name] = makeScript(kind, slug, repo);
+
+			} else {
+				char size[16];
+				snprintf(size, sizeof(size), "%d.%d %s", 1 + rnd(999), rnd(10), rnd(3) == 0 ? "MiB" : "KiB");
+				entry[name] = { { "size", size }, { "script", makeScript(kind, slug, repo) } };
+			}
+		}
+
+		fprintf(store, "%s%s", i > 0 ? "," : "", entry.dump().c_str());
+
+		/* Installed entries; some with an update available, some marked. */
+		if (rnd(5) < 2) {
+			nlohmann::json metaEntry = {
+				{ "updated", rnd(3) == 0 ? makeDate(std::max(day - 1 - rnd(200), 0)) : entry["info"]["last_updated"].get<std::string>() },
+				{ "installed", nlohmann::json::array({ firstDownload }) }
+			};
+
+			if (rnd(4) == 0) metaEntry["marks"] = 1 + rnd(SPADE * 2 - 1);
+
+			fprintf(meta, "%s%s:%s", firstMeta ? "" : ",", nlohmann::json(entryTitle).dump().c_str(), metaEntry.dump().c_str());
+			firstMeta = false;
+		}
+	}
+
+	fprintf(store, "]}");
+	fprintf(meta, "}}");
+	fclose(store);
+	fclose(meta);
+}
+
+/*
+	Append a result to a log as one line of JSON, so the logs of different versions can be compared line by line or loaded as a whole.
+	Every line has the time, the version, the operation and the amount of entries, followed by the measured fields.
+
+	FILE *log: The log.
+	const char *version: The version, which got measured.
+	const char *op: The operation.
+	int entries: The amount of entries of the UniStore.
+	const nlohmann::json &result: Const Reference to the measured fields.
+*/
+void Benchmark::Write(FILE *log, const char *version, const char *op, int entries, const nlohmann::json &result) {
+	const time_t now = time(nullptr);
+	char timeStr[32];
+	strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	nlohmann::json line = { { "time", timeStr }, { "version", version }, { "op", op }, { "entries", entries } };
+	line.update(result);
+	fprintf(log, "%s\n", line.dump().c_str());
+}
+
+#endif
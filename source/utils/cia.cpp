@@ -25,6 +25,7 @@
 */
 
 #include "cia.hpp"
+#include "ciaStream.hpp"
 #include "files.hpp"
 
 Result Title::Launch(u64 titleId, FS_MediaType mediaType) {
@@ -82,16 +83,7 @@ Result Title::DeletePrevious(u64 titleid, FS_MediaType media) {
 	return 0;
 }
 
-static FS_MediaType getTitleDestination(u64 titleId) {
-	u16 platform = (u16) ((titleId >> 48) & 0xFFFF);
-	u16 category = (u16) ((titleId >> 32) & 0xFFFF);
-	u8 variation = (u8) (titleId & 0xFF);
-
-	//     DSiWare                3DS                    DSiWare, System, DLP         Application           System Title
-	return platform == 0x0003 || (platform == 0x0004 && ((category & 0x8011) != 0 || (category == 0x0000 && variation == 0x02))) ? MEDIATYPE_NAND : MEDIATYPE_SD;
-}
-
-u32 installSize = 0, installOffset = 0;
+extern u32 installSize, installOffset;
 
 Result Title::Install(const char *ciaPath, bool updatingSelf) {
 	u32 bytes_read = 0, bytes_written;
@@ -113,7 +105,7 @@ Result Title::Install(const char *ciaPath, bool updatingSelf) {
 		return ret;
 	}
 
-	media = getTitleDestination(info.titleID);
+	media = CiaStream::Destination(info.titleID);
 
 	if (!updatingSelf) {
 		ret = Title::DeletePrevious(info.titleID, media);
@@ -127,7 +119,7 @@ Result Title::Install(const char *ciaPath, bool updatingSelf) {
 		return ret;
 	}
 
-	if (getAvailableSpace() >= size) {
+	if (FreeSpace::Available() >= size) {
 		ret = AM_StartCiaInstall(media, &ciaHandle);
 		if (R_FAILED(ret)) {
 			printf("Error in:\nAM_StartCiaInstall\n");
@@ -159,6 +151,8 @@ Result Title::Install(const char *ciaPath, bool updatingSelf) {
 		}
 	}
 
+	FreeSpace::Sync(); // AM wrote the title, which isn't tracked.
+
 	ret = FSFILE_Close(fileHandle);
 	if (R_FAILED(ret)) {
 		printf("Error in:\nFSFILE_Close\n");
@@ -170,4 +164,36 @@ Result Title::Install(const char *ciaPath, bool updatingSelf) {
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+/*
+	Install a CIA, while it gets downloaded.
+	The previous title gets deleted first, like Title::Install does, unless Universal-Updater updates itself.
+	If that can't work out, staged gets set and the caller should install it the staged way, which can continue a broken download.
+
+	ArchiveStream &stream: Reference to the stream of the CIA.
+	bool updatingSelf: If Universal-Updater updates itself.
+	bool &staged: Reference to the fallback state.
+*/
+Result Title::InstallStream(ArchiveStream &stream, bool updatingSelf, bool &staged) {
+	const CiaInstaller installer = {
+		updatingSelf ? nullptr : Title::DeletePrevious,
+		AM_StartCiaInstall,
+		[](Handle handle, u64 offset, const void *data, u32 size) {
+			u32 bytes_written = 0;
+			return FSFILE_Write(handle, &bytes_written, offset, data, size, FS_WRITE_FLUSH);
+		},
+		AM_FinishCiaInstall,
+		AM_CancelCIAInstall
+	};
+
+	u64 titleID = 0;
+	Result ret = CiaStream::Install(stream, installer, titleID, staged);
+	if (R_FAILED(ret)) return ret;
+
+	if (updatingSelf) {
+		if (R_FAILED(ret = Title::Launch(titleID, MEDIATYPE_SD))) return ret;
+	}
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+*   This file is part of Universal-Updater
+*   Copyright (C) 2019-2021 Universal-Team
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+*       * Requiring preservation of specified reasonable legal notices or
+*         author attributions in that material or in the Appropriate Legal
+*         Notices displayed by works containing it.
+*       * Prohibiting misrepresentation of the origin of that material,
+*         or requiring that modified versions of such material be marked in
+*         reasonable ways as different from the original version.
+*/
+
+#include "ciaStream.hpp"
+#include "files.hpp"
+
+u32 installSize = 0, installOffset = 0; // The progress of the running install.
+
+/*
+	Return, where a title gets installed to.
+
+	u64 titleId: The title ID.
+*/
+FS_MediaType CiaStream::Destination(u64 titleId) {
+	u16 platform = (u16) ((titleId >> 48) & 0xFFFF);
+	u16 category = (u16) ((titleId >> 32) & 0xFFFF);
+	u8 variation = (u8) (titleId & 0xFF);
+
+	//     DSiWare                3DS                    DSiWare, System, DLP         Application           System Title
+	return platform == 0x0003 || (platform == 0x0004 && ((category & 0x8011) != 0 || (category == 0x0000 && variation == 0x02))) ? MEDIATYPE_NAND : MEDIATYPE_SD;
+}
+
+#define CIA_ALIGN(x) (((x) + 0x3F) & ~0x3F)
+
+static u32 readBE32(const u8 *data) { return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]; };
+
+/*
+	Get the title ID from the start of a CIA.
+	Returns 0, if more data is needed. Sets invalid, if it isn't a CIA.
+
+	const std::vector<u8> &data: Const Reference to the start of the CIA.
+	bool &invalid: Reference to the invalid state.
+*/
+u64 CiaStream::TitleID(const std::vector<u8> &data, bool &invalid) {
+	if (data.size() < 0x20) return 0;
+
+	/* The header is little endian, the TMD behind the certificates and the ticket big endian. */
+	const u32 headerSize = *(const u32 *)&data[0x00], certSize = *(const u32 *)&data[0x08], ticketSize = *(const u32 *)&data[0x0C];
+	const size_t tmdOffset = CIA_ALIGN(headerSize) + CIA_ALIGN(certSize) + CIA_ALIGN(ticketSize);
+	if (data.size() < tmdOffset + 4) return 0;
+
+	size_t signatureSize = 0;
+	switch(readBE32(&data[tmdOffset])) {
+		case 0x10000: // RSA-4096.
+		case 0x10003:
+			signatureSize = 0x200 + 0x3C;
+			break;
+
+		case 0x10001: // RSA-2048.
+		case 0x10004:
+			signatureSize = 0x100 + 0x3C;
+			break;
+
+		case 0x10002: // ECDSA.
+		case 0x10005:
+			signatureSize = 0x3C + 0x40;
+			break;
+
+		default:
+			invalid = true;
+			return 0;
+	}
+
+	const size_t titleIDOffset = tmdOffset + 4 + signatureSize + 0x4C;
+	if (data.size() < titleIDOffset + 8) return 0;
+
+	return ((u64)readBE32(&data[titleIDOffset]) << 32) | readBE32(&data[titleIDOffset + 4]);
+}
+
+/*
+	Get the size of a CIA from its header, which is the end of its last section.
+	Returns 0, if more data is needed.
+
+	const std::vector<u8> &data: Const Reference to the start of the CIA.
+*/
+u64 CiaStream::Size(const std::vector<u8> &data) {
+	if (data.size() < 0x20) return 0;
+
+	const u32 headerSize = *(const u32 *)&data[0x00], certSize = *(const u32 *)&data[0x08], ticketSize = *(const u32 *)&data[0x0C];
+	const u32 tmdSize = *(const u32 *)&data[0x10], metaSize = *(const u32 *)&data[0x14];
+	const u64 contentSize = *(const u64 *)&data[0x18];
+
+	const u64 size = (u64)CIA_ALIGN(headerSize) + CIA_ALIGN(certSize) + CIA_ALIGN(ticketSize) + CIA_ALIGN(tmdSize) + contentSize;
+	return metaSize > 0 ? CIA_ALIGN(size) + metaSize : size;
+}
+
+/*
+	Install a CIA through the installer, while it gets downloaded.
+	The size comes from the header of the CIA, so it doesn't depend on the Content-Length of the server.
+	The previous title gets deleted first through installer.DeletePrevious, if set, like the file based install does.
+	If it failed, because of the download or the installer refused it, staged gets set,
+	as storing the whole CIA first may still work.
+
+	ArchiveStream &stream: Reference to the stream of the CIA.
+	const CiaInstaller &installer: Const Reference to where the CIA goes.
+	u64 &titleID: Reference to the title ID, once it is known.
+	bool &staged: Reference to the fallback state.
+*/
+Result CiaStream::Install(ArchiveStream &stream, const CiaInstaller &installer, u64 &titleID, bool &staged) {
+	installSize = 0, installOffset = 0;
+	titleID = 0;
+	staged = false;
+	std::vector<u8> header;
+	bool invalid = false;
+	const void *buffer = nullptr;
+	ssize_t size = 0;
+
+	/* Collect the start, until the title ID is known. */
+	while (titleID == 0) {
+		size = stream.Read(&buffer);
+		if (size <= 0) {
+			staged = size < 0;
+			return -1;
+		}
+
+		header.insert(header.end(), (const u8 *)buffer, (const u8 *)buffer + size);
+		titleID = CiaStream::TitleID(header, invalid);
+		if (invalid) {
+			printf("Error in:\ngetCiaTitleID\n");
+			return -1;
+		}
+	}
+
+	/* The title ID lies behind the header, so the size is known by now. */
+	const u64 ciaSize = CiaStream::Size(header);
+	const FS_MediaType media = CiaStream::Destination(titleID);
+
+	if (installer.DeletePrevious) {
+		Result ret = installer.DeletePrevious(titleID, media);
+		if (R_FAILED(ret)) return ret;
+		FreeSpace::Sync(); // AM freed the old title, which isn't tracked.
+	}
+
+	/* The title needs about as much space as the CIA. Only the SD card is tracked. */
+	u64 reservation = 0;
+	if (media == MEDIATYPE_SD && !FreeSpace::Reserve(ciaSize, reservation)) {
+		printf("Error in:\nFreeSpace::Reserve\n");
+		return -1;
+	}
+
+	installSize = ciaSize;
+
+	Handle ciaHandle;
+	Result ret = installer.Start(media, &ciaHandle);
+	if (R_FAILED(ret)) {
+		printf("Error in:\nAM_StartCiaInstall\n");
+		FreeSpace::Release(reservation);
+		return ret;
+	}
+
+	ret = installer.Write(ciaHandle, 0, header.data(), header.size());
+	installOffset = header.size();
+
+	while (R_SUCCEEDED(ret) && (size = stream.Read(&buffer)) > 0) {
+		ret = installer.Write(ciaHandle, installOffset, buffer, size);
+		installOffset += size;
+	}
+
+	/* Never finish an incomplete title. Trailing padding behind the last section is fine. */
+	if (R_FAILED(ret) || size < 0 || installOffset < installSize) {
+		printf("Error in:\nFSFILE_Write\n");
+		installer.Cancel(ciaHandle);
+		FreeSpace::Release(reservation);
+
+		staged = R_SUCCEEDED(ret); // Only the download broke.
+		return R_FAILED(ret) ? ret : -1;
+	}
+
+	ret = installer.Finish(ciaHandle);
+	FreeSpace::Release(reservation);
+	FreeSpace::Sync(); // AM wrote the title, which isn't tracked.
+
+	/* E.g. a newer version is installed. The staged install deletes it first, once the whole CIA is there. */
+	if (R_FAILED(ret)) {
+		printf("Error in:\nAM_FinishCiaInstall\n");
+		staged = true;
+		return ret;
+	}
+
+	return 0;
+}
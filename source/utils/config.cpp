@@ -151,6 +151,11 @@ Config::Config() {
 	}
 
 	if (this->json.contains("Prompt")) this->prompt(this->getBool("Prompt"));
+	if (this->json.contains("DownloadCache")) this->downloadCache(this->getBool("DownloadCache"));
+	if (this->json.contains("CacheQuota")) this->cacheQuota(this->getInt("CacheQuota"));
+	if (this->json.contains("Prefetch")) this->prefetch(this->getBool("Prefetch"));
+	if (this->json.contains("PrefetchScreenshots")) this->prefetchScreenshots(this->getBool("PrefetchScreenshots"));
+	if (this->json.contains("BufferCeiling")) this->bufferCeiling(this->getInt("BufferCeiling"));
 
 	this->changesMade = false; // No changes made yet.
 }
@@ -179,6 +184,11 @@ void Config::save() {
 		this->setBool("Display_Changelog", this->changelog());
 		this->setString("Active_Theme", this->theme());
 		this->setBool("Prompt", this->prompt());
+		this->setBool("DownloadCache", this->downloadCache());
+		this->setInt("CacheQuota", this->cacheQuota());
+		this->setBool("Prefetch", this->prefetch());
+		this->setBool("PrefetchScreenshots", this->prefetchScreenshots());
+		this->setInt("BufferCeiling", this->bufferCeiling());
 
 		/* Write changes to file. */
 		const std::string dump = this->json.dump(1, '\t');
@@ -25,7 +25,10 @@
 */
 
 #include "animation.hpp"
+#include "common.hpp"
 #include "download.hpp"
+#include "downloadCache.hpp"
+#include "downloadEngine.hpp"
 #include "files.hpp"
 #include "json.hpp"
 #include "lang.hpp"
@@ -35,405 +38,18 @@
 #include "stringutils.hpp"
 
 #include <3ds.h>
+#include <algorithm>
 #include <curl/curl.h>
 #include <dirent.h>
 #include <malloc.h>
+#include <map>
 #include <regex>
 #include <string>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <vector>
 
-#define USER_AGENT APP_TITLE "-" VERSION_STRING
-
-static char *result_buf = nullptr;
-static size_t result_sz = 0;
-static size_t result_written = 0;
-
-#define TIME_IN_US 1
-#define TIMETYPE curl_off_t
-#define TIMEOPT CURLINFO_TOTAL_TIME_T
-#define MINIMAL_PROGRESS_FUNCTIONALITY_INTERVAL	3000000
-
-curl_off_t downloadTotal = 1; // Dont initialize with 0 to avoid division by zero later.
-curl_off_t downloadNow = 0;
-curl_off_t downloadSpeed = 0;
-
-static FILE *downfile = nullptr;
-static size_t file_buffer_pos = 0;
-static size_t file_toCommit_size = 0;
-static char *g_buffers[2] = { nullptr };
-static u8 g_index = 0;
-static Thread fsCommitThread;
-static LightEvent readyToCommit;
-static LightEvent waitCommit;
-static bool killThread = false;
-static bool writeError = false;
-#define FILE_ALLOC_SIZE 0x60000
-CURL *CurlHandle = nullptr;
-
-static int curlProgress(CURL *hnd,
-					curl_off_t dltotal, curl_off_t dlnow,
-					curl_off_t ultotal, curl_off_t ulnow)
-{
-	downloadTotal = dltotal;
-	downloadNow = dlnow;
-
-	return 0;
-}
-
-bool filecommit() {
-	if (!downfile) return false;
-	fseek(downfile, 0, SEEK_END);
-	u32 byteswritten = fwrite(g_buffers[!g_index], 1, file_toCommit_size, downfile);
-	if (byteswritten != file_toCommit_size) return false;
-	file_toCommit_size = 0;
-	return true;
-}
-
-static void commitToFileThreadFunc(void *args) {
-	LightEvent_Signal(&waitCommit);
-
-	while (true) {
-		LightEvent_Wait(&readyToCommit);
-		LightEvent_Clear(&readyToCommit);
-		if (killThread) threadExit(0);
-		writeError = !filecommit();
-		LightEvent_Signal(&waitCommit);
-	}
-}
-
-static size_t file_handle_data(char *ptr, size_t size, size_t nmemb, void *userdata) {
-	if (getAvailableSpace() < (u64)downloadTotal) return 0; // Out of space.
-	if (writeError) return 0;
-	if (QueueSystem::CancelCallback) return 0;
-
-	(void)userdata;
-	const size_t bsz = size * nmemb;
-	size_t tofill = 0;
-
-
-	if (!g_buffers[g_index]) {
-		LightEvent_Init(&waitCommit, RESET_STICKY);
-		LightEvent_Init(&readyToCommit, RESET_STICKY);
-
-		s32 prio = 0;
-		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-		fsCommitThread = threadCreate(commitToFileThreadFunc, NULL, 0x1000, prio - 1, -2, true);
-
-		g_buffers[0] = (char*)memalign(0x1000, FILE_ALLOC_SIZE);
-		g_buffers[1] = (char*)memalign(0x1000, FILE_ALLOC_SIZE);
-
-		if (!fsCommitThread || !g_buffers[0] || !g_buffers[1]) return 0;
-	}
-
-	if (file_buffer_pos + bsz >= FILE_ALLOC_SIZE) {
-		tofill = FILE_ALLOC_SIZE - file_buffer_pos;
-		memcpy(g_buffers[g_index] + file_buffer_pos, ptr, tofill);
-
-		LightEvent_Wait(&waitCommit);
-		LightEvent_Clear(&waitCommit);
-		file_toCommit_size = file_buffer_pos + tofill;
-		file_buffer_pos = 0;
-		svcFlushProcessDataCache(CUR_PROCESS_HANDLE, (u32)g_buffers[g_index], file_toCommit_size);
-		g_index = !g_index;
-		LightEvent_Signal(&readyToCommit);
-	}
-
-	memcpy(g_buffers[g_index] + file_buffer_pos, ptr + tofill, bsz - tofill);
-	file_buffer_pos += bsz - tofill;
-	return bsz;
-}
-
-/*
-	Download a file.
-
-	const std::string &url: The download URL.
-	const std::string &path: Where to place the file.
-*/
-Result downloadToFile(const std::string &url, const std::string &path) {
-	if (!checkWifiStatus()) return -1; // NO WIFI.
-
-	bool needToDelete = false;
-	downloadTotal = 1;
-	downloadNow = 0;
-	downloadSpeed = 0;
-
-	CURLcode curlResult;
-	Result retcode = 0;
-	int res;
-
-	printf("Downloading from:\n%s\nto:\n%s\n", url.c_str(), path.c_str());
-
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) {
-		retcode = -1;
-		goto exit;
-	}
-
-	res = socInit((u32 *)socubuf, 0x100000);
-	if (R_FAILED(res)) {
-		retcode = res;
-		goto exit;
-	}
-
-	/* make directories. */
-	for (char *slashpos = strchr(path.c_str() + 1, '/'); slashpos != NULL; slashpos = strchr(slashpos + 1, '/')) {
-		char bak = *(slashpos);
-		*(slashpos) = '\0';
-
-		mkdir(path.c_str(), 0777);
-
-		*(slashpos) = bak;
-	}
-
-	downfile = fopen(path.c_str(), "wb");
-	if (!downfile) {
-		retcode = -2;
-		goto exit;
-	}
-
-	CurlHandle = curl_easy_init();
-	curl_easy_setopt(CurlHandle, CURLOPT_BUFFERSIZE, FILE_ALLOC_SIZE);
-	curl_easy_setopt(CurlHandle, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(CurlHandle, CURLOPT_NOPROGRESS, 0L);
-	curl_easy_setopt(CurlHandle, CURLOPT_USERAGENT, USER_AGENT);
-	curl_easy_setopt(CurlHandle, CURLOPT_FOLLOWLOCATION, 1L);
-	curl_easy_setopt(CurlHandle, CURLOPT_FAILONERROR, 1L);
-	curl_easy_setopt(CurlHandle, CURLOPT_ACCEPT_ENCODING, "gzip");
-	curl_easy_setopt(CurlHandle, CURLOPT_MAXREDIRS, 50L);
-	curl_easy_setopt(CurlHandle, CURLOPT_XFERINFOFUNCTION, curlProgress);
-	curl_easy_setopt(CurlHandle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
-	curl_easy_setopt(CurlHandle, CURLOPT_WRITEFUNCTION, file_handle_data);
-	curl_easy_setopt(CurlHandle, CURLOPT_SSL_VERIFYPEER, 0L);
-	curl_easy_setopt(CurlHandle, CURLOPT_VERBOSE, 1L);
-	curl_easy_setopt(CurlHandle, CURLOPT_STDERR, stdout);
-
-	curlResult = curl_easy_perform(CurlHandle);
-	curl_easy_cleanup(CurlHandle);
-	CurlHandle = nullptr;
-
-	if (curlResult != CURLE_OK) {
-		retcode = -curlResult;
-		needToDelete = true;
-		goto exit;
-	}
-
-	LightEvent_Wait(&waitCommit);
-	LightEvent_Clear(&waitCommit);
-
-	file_toCommit_size = file_buffer_pos;
-	svcFlushProcessDataCache(CUR_PROCESS_HANDLE, (u32)g_buffers[g_index], file_toCommit_size);
-	g_index = !g_index;
-
-	if (!filecommit()) {
-		retcode = -3;
-		needToDelete = true;
-		goto exit;
-	}
-
-	fflush(downfile);
-
-exit:
-	if (fsCommitThread) {
-		killThread = true;
-		LightEvent_Signal(&readyToCommit);
-		threadJoin(fsCommitThread, U64_MAX);
-		killThread = false;
-		fsCommitThread = nullptr;
-	}
-
-	socExit();
-
-	if (socubuf) free(socubuf);
-
-	if (downfile) {
-		fclose(downfile);
-		downfile = nullptr;
-	}
-
-	if (g_buffers[0]) {
-		free(g_buffers[0]);
-		g_buffers[0] = nullptr;
-	}
-
-	if (g_buffers[1]) {
-		free(g_buffers[1]);
-		g_buffers[1] = nullptr;
-	}
-
-	g_index = 0;
-	file_buffer_pos = 0;
-	file_toCommit_size = 0;
-	writeError = false;
-
-	if (needToDelete) {
-		if (access(path.c_str(), F_OK) == 0) deleteFile(path.c_str()); // Delete file, cause not fully downloaded.
-	}
-
-	if (QueueSystem::CancelCallback) return 0;
-	return retcode;
-}
-
-/*
-	following function is from
-	https://github.com/angelsl/libctrfgh/blob/master/curl_test/src/main.c
-*/
-static size_t handle_data(char *ptr, size_t size, size_t nmemb, void *userdata) {
-	(void)userdata;
-	const size_t bsz = size*nmemb;
-
-	if (result_sz == 0 || !result_buf) {
-		result_sz = 0x1000;
-		result_buf = (char *)malloc(result_sz);
-	}
-
-	bool need_realloc = false;
-	while (result_written + bsz > result_sz) {
-		result_sz <<= 1;
-		need_realloc = true;
-	}
-
-	if (need_realloc) {
-		char *new_buf = (char *)realloc(result_buf, result_sz);
-		if (!new_buf) return 0;
-
-		result_buf = new_buf;
-	}
-
-	if (!result_buf) return 0;
-
-	memcpy(result_buf + result_written, ptr, bsz);
-	result_written += bsz;
-	return bsz;
-}
-
-/*
-	This + Above is Used for No File Write and instead into RAM.
-*/
-static Result setupContext(CURL *hnd, const char *url) {
-	curl_easy_setopt(hnd, CURLOPT_BUFFERSIZE, 102400L);
-	curl_easy_setopt(hnd, CURLOPT_URL, url);
-	curl_easy_setopt(hnd, CURLOPT_NOPROGRESS, 0L);
-	curl_easy_setopt(hnd, CURLOPT_USERAGENT, USER_AGENT);
-	curl_easy_setopt(hnd, CURLOPT_FOLLOWLOCATION, 1L);
-	curl_easy_setopt(hnd, CURLOPT_MAXREDIRS, 50L);
-	curl_easy_setopt(hnd, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
-	curl_easy_setopt(hnd, CURLOPT_WRITEFUNCTION, handle_data);
-	curl_easy_setopt(hnd, CURLOPT_SSL_VERIFYPEER, 0L);
-	curl_easy_setopt(hnd, CURLOPT_VERBOSE, 1L);
-	curl_easy_setopt(hnd, CURLOPT_STDERR, stdout);
-
-	return 0;
-}
-
-/*
-	Download a file of a GitHub Release.
-
-	const std::string &url: Const Reference to the URL. (https://github.com/Owner/Repo)
-	const std::string &asset: Const Reference to the Asset. (File.filetype)
-	const std::string &path: Const Reference, where to store. (sdmc:/File.filetype)
-	bool includePrereleases: If including Pre-Releases.
-*/
-Result downloadFromRelease(const std::string &url, const std::string &asset, const std::string &path, bool includePrereleases) {
-	Result ret = 0;
-	CURL *hnd;
-
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) {
-		return -1;
-	}
-
-	ret = socInit((u32*)socubuf, 0x100000);
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return ret;
-	}
-
-	std::regex parseUrl("github\\.com\\/(.+)\\/(.+)");
-	std::smatch result;
-	regex_search(url, result, parseUrl);
-
-	std::string repoOwner = result[1].str(), repoName = result[2].str();
-
-	std::stringstream apiurlStream;
-	apiurlStream << "https://api.github.com/repos/" << repoOwner << "/" << repoName << (includePrereleases ? "/releases" : "/releases/latest");
-	std::string apiurl = apiurlStream.str();
-
-	printf("Downloading latest release from repo:\n%s\nby:\n%s\n", repoName.c_str(), repoOwner.c_str());
-	printf("Crafted API url:\n%s\n", apiurl.c_str());
-
-	hnd = curl_easy_init();
-
-	ret = setupContext(hnd, apiurl.c_str());
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = NULL;
-		result_sz = 0;
-		result_written = 0;
-		return ret;
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
-		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return -1;
-	}
-
-	printf("Looking for asset with matching name:\n%s\n", asset.c_str());
-	std::string assetUrl;
-
-	if (nlohmann::json::accept(result_buf)) {
-		nlohmann::json parsedAPI = nlohmann::json::parse(result_buf);
-
-		if (parsedAPI.size() == 0) ret = -2; // All were prereleases and those are being ignored.
-
-		if (ret != -2) {
-			if (includePrereleases) parsedAPI = parsedAPI[0];
-
-			if (parsedAPI["assets"].is_array()) {
-				for (auto jsonAsset : parsedAPI["assets"]) {
-					if (jsonAsset.is_object() && jsonAsset["name"].is_string() && jsonAsset["browser_download_url"].is_string()) {
-						std::string assetName = jsonAsset["name"];
-
-						if (ScriptUtils::matchPattern(asset, assetName)) {
-							assetUrl = jsonAsset["browser_download_url"];
-							break;
-						}
-					}
-				}
-			}
-		}
-
-	} else {
-		ret = -3;
-	}
-
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
-
-	if (assetUrl.empty() || ret != 0) ret = DL_ERROR_GIT;
-	else ret = downloadToFile(assetUrl, path);
-
-	return ret;
-}
-
 /*
 	Check Wi-Fi status.
 	@return True if Wi-Fi is connected; false if not.
@@ -468,73 +84,27 @@ void notConnectedMsg(void) { Msg::waitMsg(Lang::get("CONNECT_WIFI")); }
 */
 bool IsUpdateAvailable(const std::string &URL, int revCurrent) {
 	Msg::DisplayMsg(Lang::get("CHECK_UNISTORE_UPDATES"));
-	Result ret = 0;
-
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return false;
-
-	ret = socInit((u32 *)socubuf, 0x100000);
-
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return false;
-	}
-
-	CURL *hnd = curl_easy_init();
 
-	ret = setupContext(hnd, URL.c_str());
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return false;
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
+	DownloadContext ctx(URL);
+	ctx.conditional = true;
+	if (ctx.Perform() != 0) {
 		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
 		return false;
 	}
 
-	if (nlohmann::json::accept(result_buf)) {
-		nlohmann::json parsedAPI = nlohmann::json::parse(result_buf);
+	if (ctx.NotModified()) return false; // Unchanged since it got downloaded.
+
+	if (nlohmann::json::accept(ctx.data.begin(), ctx.data.end())) {
+		nlohmann::json parsedAPI = nlohmann::json::parse(ctx.data.begin(), ctx.data.end());
 
 		if (parsedAPI.contains("storeInfo") && parsedAPI.contains("storeContent")) {
 			if (parsedAPI["storeInfo"].contains("revision") && parsedAPI["storeInfo"]["revision"].is_number()) {
 				const int rev = parsedAPI["storeInfo"]["revision"];
-				socExit();
-				free(result_buf);
-				free(socubuf);
-				result_buf = nullptr;
-				result_sz = 0;
-				result_written = 0;
-
 				return rev > revCurrent;
 			}
 		}
 	}
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
-
 	return false;
 }
 
@@ -546,8 +116,9 @@ bool IsUpdateAvailable(const std::string &URL, int revCurrent) {
 	std::string &fl: Output for the filepath.
 	bool isDownload: If download or updating.
 	bool isUDB: If Universal-DB download or not.
+	const std::vector<std::string> &mirrors: Const Reference to the mirrors of the UniStore.
 */
-bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, bool isDownload, bool isUDB) {
+bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, bool isDownload, bool isUDB, const std::vector<std::string> &mirrors) {
 	if (isUDB) Msg::DisplayMsg(Lang::get("DOWNLOADING_UNIVERSAL_DB"));
 	else {
 		if (currentRev > -1) Msg::DisplayMsg(Lang::get("CHECK_UNISTORE_UPDATES"));
@@ -558,51 +129,19 @@ bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, b
 		if(*(u32*)(URL.c_str() + URL.length() - 4) == (2408617868 ^ (0xF << 8 | 4294963455))) return false;
 	}
 
-	Result ret = 0;
-
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return false;
-
-	ret = socInit((u32 *)socubuf, 0x100000);
-
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return false;
-	}
-
-	CURL *hnd = curl_easy_init();
-
-	ret = setupContext(hnd, URL.c_str());
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return false;
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
+	DownloadContext ctx(URL);
+	ctx.conditional = currentRev > -1; // Only updates have a local copy to compare with.
+	ctx.mirrors = mirrors;
+	if (ctx.Perform() != 0) {
 		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
 		return false;
 	}
 
-	if (getAvailableSpace() >= result_written) {
-		if (nlohmann::json::accept(result_buf)) {
-			nlohmann::json parsedAPI = nlohmann::json::parse(result_buf);
+	if (ctx.NotModified()) return false; // Unchanged since it got downloaded.
+
+	if (FreeSpace::Available() >= ctx.data.size()) {
+		if (nlohmann::json::accept(ctx.data.begin(), ctx.data.end())) {
+			nlohmann::json parsedAPI = nlohmann::json::parse(ctx.data.begin(), ctx.data.end());
 
 			if (parsedAPI.contains("storeInfo") && parsedAPI.contains("storeContent")) {
 				/* Ensure, version == _UNISTORE_VERSION. */
@@ -622,15 +161,9 @@ bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, b
 										if (!(fl.find("/") != std::string::npos)) {
 
 											FILE *out = fopen((std::string(_STORE_PATH) + fl).c_str(), "w");
-											fwrite(result_buf, sizeof(char), result_written, out);
+											fwrite(ctx.data.data(), sizeof(char), ctx.data.size(), out);
 											fclose(out);
-
-											socExit();
-											free(result_buf);
-											free(socubuf);
-											result_buf = nullptr;
-											result_sz = 0;
-											result_written = 0;
+											ctx.SaveValidators(std::string(_STORE_PATH) + fl);
 
 											return true;
 
@@ -649,15 +182,9 @@ bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, b
 								if (!(fl.find("/") != std::string::npos)) {
 
 									FILE *out = fopen((std::string(_STORE_PATH) + fl).c_str(), "w");
-									fwrite(result_buf, sizeof(char), result_written, out);
+									fwrite(ctx.data.data(), sizeof(char), ctx.data.size(), out);
 									fclose(out);
-
-									socExit();
-									free(result_buf);
-									free(socubuf);
-									result_buf = nullptr;
-									result_sz = 0;
-									result_written = 0;
+									ctx.SaveValidators(std::string(_STORE_PATH) + fl);
 
 									return true;
 
@@ -682,96 +209,90 @@ bool DownloadUniStore(const std::string &URL, int currentRev, std::string &fl, b
 		}
 	}
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
-
 	return false;
 }
 
 /*
-	Download a SpriteSheet.
+	Validate a downloaded SpriteSheet and write it to the store path.
 
-	const std::string &URL: Const Reference to the SpriteSheet URL.
-	const std::string &file: Const Reference to the filepath.
+	DownloadContext &ctx: Reference to the finished download.
+	const std::string &file: Const Reference to the filename.
 */
-bool DownloadSpriteSheet(const std::string &URL, const std::string &file) {
-	if (file.find("/") != std::string::npos) return false;
-	Result ret = 0;
+static bool saveSpriteSheet(DownloadContext &ctx, const std::string &file) {
+	if (ctx.NotModified()) return true; // The local SpriteSheet is still up to date.
+	if (FreeSpace::Available() < ctx.data.size()) return false;
 
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return false;
+	C2D_SpriteSheet sheet = C2D_SpriteSheetLoadFromMem(ctx.data.data(), ctx.data.size());
+	if (!sheet) return false;
 
-	ret = socInit((u32 *)socubuf, 0x100000);
+	bool valid = C2D_SpriteSheetCount(sheet) > 0;
+	C2D_SpriteSheetFree(sheet);
 
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return false;
+	if (valid) {
+		const std::string path = std::string(_STORE_PATH) + file;
+		FILE *out = fopen(path.c_str(), "w");
+		if (!out) return false;
+
+		fwrite(ctx.data.data(), sizeof(char), ctx.data.size(), out);
+		fclose(out);
+		ctx.SaveValidators(path);
 	}
 
-	CURL *hnd = curl_easy_init();
+	return valid;
+}
 
-	ret = setupContext(hnd, URL.c_str());
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return false;
-	}
+/*
+	Download a SpriteSheet.
 
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
+	const std::string &URL: Const Reference to the SpriteSheet URL.
+	const std::string &file: Const Reference to the filepath.
+*/
+bool DownloadSpriteSheet(const std::string &URL, const std::string &file) {
+	if (file.find("/") != std::string::npos) return false;
 
-	if (cres != CURLE_OK) {
+	DownloadContext ctx(URL);
+	ctx.conditional = true;
+	if (ctx.Perform() != 0) {
 		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
 		return false;
 	}
 
-	if (getAvailableSpace() >= result_written) {
-		C2D_SpriteSheet sheet = C2D_SpriteSheetLoadFromMem(result_buf, result_written);
-
-		if (sheet) {
-			if (C2D_SpriteSheetCount(sheet) > 0) {
-				FILE *out = fopen((std::string(_STORE_PATH) + file).c_str(), "w");
-				fwrite(result_buf, sizeof(char), result_written, out);
-				fclose(out);
+	return saveSpriteSheet(ctx, file);
+}
 
-				socExit();
-				free(result_buf);
-				free(socubuf);
-				result_buf = nullptr;
-				result_sz = 0;
-				result_written = 0;
+/*
+	Download multiple SpriteSheets at once through the DownloadEngine.
 
-				C2D_SpriteSheetFree(sheet);
-				return true;
-			}
+	const std::vector<std::string> &URLs: Const Reference to the SpriteSheet URLs.
+	const std::vector<std::string> &files: Const Reference to the filepaths.
+	const std::string &msg: Const Reference to the progress message. (Takes the current and total count)
+*/
+void DownloadSpriteSheets(const std::vector<std::string> &URLs, const std::vector<std::string> &files, const std::string &msg) {
+	std::vector<std::shared_ptr<DownloadContext>> transfers;
+
+	for (int i = 0; i < (int)files.size() && i < (int)URLs.size(); i++) {
+		if (files[i].find("/") != std::string::npos) {
+			Msg::waitMsg(Lang::get("SHEET_SLASH"));
+			transfers.push_back(nullptr);
+
+		} else {
+			std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(URLs[i]);
+			ctx->conditional = true;
+			transfers.push_back(DownloadEngine::Add(ctx));
 		}
 	}
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
+	/* The SpriteSheets download in parallel, but get handled in order. */
+	for (int i = 0; i < (int)transfers.size(); i++) {
+		if (!transfers[i]) continue;
 
-	return false;
+		char message[150];
+		snprintf(message, sizeof(message), msg.c_str(), i + 1, transfers.size());
+		Msg::DisplayMsg(message);
+
+		if (DownloadEngine::Wait(transfers[i])) saveSpriteSheet(*transfers[i], files[i]);
+		transfers[i] = nullptr; // Free the data already.
+	}
 }
 
 /*
@@ -781,62 +302,20 @@ UUUpdate IsUUUpdateAvailable() {
 	if (!checkWifiStatus()) return { false, "", "" };
 
 	Msg::DisplayMsg(Lang::get("CHECK_UU_UPDATES"));
-	Result ret = 0;
-
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return { false, "", "" };
-
-	ret = socInit((u32 *)socubuf, 0x100000);
-
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return { false, "", "" };
-	}
-
-	CURL *hnd = curl_easy_init();
 
-	ret = setupContext(hnd, "https://api.github.com/repos/Universal-Team/Universal-Updater/releases/latest");
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return { false, "", "" };
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
+	DownloadContext ctx(GITHUB_API_URL "/repos/Universal-Team/Universal-Updater/releases/latest");
+	if (ctx.Perform() != 0) {
 		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
 		return { false, "", "" };
 	}
 
-	if (nlohmann::json::accept(result_buf)) {
-		nlohmann::json parsedAPI = nlohmann::json::parse(result_buf);
+	if (nlohmann::json::accept(ctx.data.begin(), ctx.data.end())) {
+		nlohmann::json parsedAPI = nlohmann::json::parse(ctx.data.begin(), ctx.data.end());
 
 		if (parsedAPI.contains("tag_name") && parsedAPI["tag_name"].is_string()) {
 			UUUpdate update = { false, "", "" };
 			update.Version = parsedAPI["tag_name"];
 
-			socExit();
-			free(result_buf);
-			free(socubuf);
-			result_buf = nullptr;
-			result_sz = 0;
-			result_written = 0;
-
 			if (parsedAPI["body"].is_string()) update.Notes = parsedAPI["body"];
 			update.Notes.erase(remove(update.Notes.begin(), update.Notes.end(), '\r'), update.Notes.end()); // Remove the CRLF \r's.
 			update.Available = strcasecmp(StringUtils::lower_case(update.Version).c_str(), StringUtils::lower_case(C_V).c_str()) > 0;
@@ -844,13 +323,6 @@ UUUpdate IsUUUpdateAvailable() {
 		}
 	}
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
-
 	return { false, "", "" };
 }
 
@@ -940,126 +412,33 @@ std::vector<StoreList> FetchStores() {
 	Msg::DisplayMsg(Lang::get("FETCHING_RECOMMENDED_UNISTORES"));
 	std::vector<StoreList> stores = { };
 
-	Result ret = 0;
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return stores;
-
-	ret = socInit((u32 *)socubuf, 0x100000);
-
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return stores;
-	}
-
-	CURL *hnd = curl_easy_init();
-
-	ret = setupContext(hnd, "https://github.com/Universal-Team/Universal-Updater/raw/master/resources/UniStores.json");
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return stores;
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
+	DownloadContext ctx(GITHUB_URL "/Universal-Team/Universal-Updater/raw/master/resources/UniStores.json");
+	if (ctx.Perform() != 0) {
 		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
 		return stores;
 	}
 
-	if (nlohmann::json::accept(result_buf)) {
-		nlohmann::json parsedAPI = nlohmann::json::parse(result_buf);
+	if (nlohmann::json::accept(ctx.data.begin(), ctx.data.end())) {
+		nlohmann::json parsedAPI = nlohmann::json::parse(ctx.data.begin(), ctx.data.end());
 
 		for(auto it = parsedAPI.begin(); it != parsedAPI.end(); ++it) {
 			stores.push_back( fetch(it.key(), parsedAPI) );
 		}
 	}
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
-
 	return stores;
 }
 
-C2D_Image FetchScreenshot(const std::string &URL) {
-	if (URL == "") return { };
-
-	C2D_Image img = { };
-
-	Result ret = 0;
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return img;
-
-	ret = socInit((u32 *)socubuf, 0x100000);
-
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return img;
-	}
-
-	CURL *hnd = curl_easy_init();
-
-	ret = setupContext(hnd, URL.c_str());
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return img;
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
-		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return img;
-	}
-
-	std::vector<u8> buffer;
-	for (int i = 0; i < (int)result_written; i++) {
-		buffer.push_back( result_buf[i] );
-	}
-
-	img = Screenshot::ConvertFromBuffer(buffer);
+/*
+	Fetch a screenshot.
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
+	const std::string &URL: Const Reference to the URL of the screenshot.
+*/
+C2D_Image FetchScreenshot(const std::string &URL) {
+	std::vector<u8> data;
+	if (!FetchScreenshotData(URL, data)) return { };
 
-	return img;
+	return Screenshot::ConvertFromBuffer(data);
 }
 
 /*
@@ -1068,71 +447,21 @@ C2D_Image FetchScreenshot(const std::string &URL) {
 std::string GetChangelog() {
 	if (!checkWifiStatus()) return "";
 
-	Result ret = 0;
-
-	void *socubuf = memalign(0x1000, 0x100000);
-	if (!socubuf) return "";
-
-	ret = socInit((u32 *)socubuf, 0x100000);
-
-	if (R_FAILED(ret)) {
-		free(socubuf);
-		return "";
-	}
-
-	CURL *hnd = curl_easy_init();
-
-	ret = setupContext(hnd, "https://api.github.com/repos/Universal-Team/Universal-Updater/releases/latest");
-	if (ret != 0) {
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
-		return "";
-	}
-
-	CURLcode cres = curl_easy_perform(hnd);
-	curl_easy_cleanup(hnd);
-	char *newbuf = (char *)realloc(result_buf, result_written + 1);
-	result_buf = newbuf;
-	result_buf[result_written] = 0; // nullbyte to end it as a proper C style string.
-
-	if (cres != CURLE_OK) {
+	DownloadContext ctx(GITHUB_API_URL "/repos/Universal-Team/Universal-Updater/releases/latest");
+	if (ctx.Perform() != 0) {
 		printf("Error in:\ncurl\n");
-		socExit();
-		free(result_buf);
-		free(socubuf);
-		result_buf = nullptr;
-		result_sz = 0;
-		result_written = 0;
 		return "";
 	}
 
-	if (nlohmann::json::accept(result_buf)) {
-		nlohmann::json parsedAPI = nlohmann::json::parse(result_buf);
+	if (nlohmann::json::accept(ctx.data.begin(), ctx.data.end())) {
+		nlohmann::json parsedAPI = nlohmann::json::parse(ctx.data.begin(), ctx.data.end());
 
 		if (parsedAPI.contains("body") && parsedAPI["body"].is_string()) {
-			socExit();
-			free(result_buf);
-			free(socubuf);
-			result_buf = nullptr;
-			result_sz = 0;
-			result_written = 0;
-
 			std::string notes = parsedAPI["body"];
 			notes.erase(remove(notes.begin(), notes.end(), '\r'), notes.end()); // Remove the CRLF \r's.
 			return notes;
 		}
 	}
 
-	socExit();
-	free(result_buf);
-	free(socubuf);
-	result_buf = nullptr;
-	result_sz = 0;
-	result_written = 0;
-
 	return "";
 }
\ No newline at end of file
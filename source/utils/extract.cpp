@@ -24,13 +24,15 @@
 *         reasonable ways as different from the original version.
 */
 
+#include "bufferPool.hpp"
 #include "extract.hpp"
 #include "files.hpp"
 #include "queueSystem.hpp"
-#include "scriptUtils.hpp"
 #include <archive.hpp>
+#include <algorithm>
 #include <archive_entry.hpp>
 #include <regex>
+#include <unistd.h>
 
 int filesExtracted = 0, extractFilesCount = 0;
 std::string extractingFile = "";
@@ -63,20 +65,17 @@ Result getExtractedSize(const std::string &archivePath, const std::string &wante
 	return EXTRACT_ERROR_NONE;
 }
 
-Result extractArchive(const std::string &archivePath, const std::string &wantedFile, const std::string &outputPath) {
-	if (getAvailableSpace() < extractSize) return -1; // Out of space.
+/*
+	Extract all wanted entries of an opened archive.
 
-	archive *a = archive_read_new();
+	archive *a: The opened archive.
+	const std::string &wantedFile: Const Reference to the regex of the wanted entries.
+	const std::string &outputPath: Const Reference to the output path.
+	u64 &reservation: Reference to the space reservation of the extraction.
+*/
+static Result extractEntries(archive *a, const std::string &wantedFile, const std::string &outputPath, u64 &reservation) {
 	archive_entry *entry;
 
-	archive_read_support_format_all(a);
-
-	if (archive_read_open_filename(a, archivePath.c_str(), 0x4000) != ARCHIVE_OK) {
-		archive_read_close(a);
-		archive_read_free(a);
-		return EXTRACT_ERROR_OPENFILE;
-	}
-
 	while(archive_read_next_header(a, &entry) == ARCHIVE_OK) {
 		std::smatch match;
 		std::string entryName(archive_entry_pathname(entry));
@@ -85,7 +84,7 @@ Result extractArchive(const std::string &archivePath, const std::string &wantedF
 			filesExtracted++;
 
 			/* Make directories. */
-			for (char *slashpos = strchr(extractingFile.c_str() + 1, '/'); slashpos != NULL; slashpos = strchr(slashpos + 1, '/')) {
+			for (char *slashpos = strchr(&extractingFile[1], '/'); slashpos != NULL; slashpos = strchr(slashpos + 1, '/')) {
 				char bak = *(slashpos);
 				*(slashpos) = '\0';
 
@@ -100,60 +99,115 @@ Result extractArchive(const std::string &archivePath, const std::string &wantedF
 				continue;
 			}
 
-			uint sizeLeft = archive_entry_size(entry);
+			/* Streamed zips may only know the size of an entry after its data. */
+			const bool sizeKnown = archive_entry_size_is_set(entry);
+			const u64 entrySize = sizeKnown ? archive_entry_size(entry) : 0;
+			if (reservation < entrySize && !FreeSpace::Reserve(entrySize - reservation, reservation)) return EXTRACT_ERROR_WRITEFILE; // Out of space.
 
 			FILE *file = fopen(extractingFile.c_str(), "wb");
-			if (!file) {
-				archive_read_close(a);
-				archive_read_free(a);
-				return EXTRACT_ERROR_WRITEFILE;
-			}
+			if (!file) return EXTRACT_ERROR_WRITEFILE;
+
+			/* Allocate the whole file at once, so the filesystem doesn't extend it with every chunk. */
+			if (entrySize > 0) ftruncate(fileno(file), entrySize);
 
 			u8 *buf = new u8[0x30000];
 			if (!buf) {
 				fclose(file);
-				archive_read_close(a);
-				archive_read_free(a);
 				return EXTRACT_ERROR_ALLOC;
 			}
 
-			while(sizeLeft > 0) {
-				u64 toRead = std::min(0x30000u, sizeLeft);
-				ssize_t size = archive_read_data(a, buf, toRead);
+			while(1) {
+				ssize_t size = archive_read_data(a, buf, 0x30000);
+				if (size == 0) break; // End of the entry.
 
 				/* Archive error, stop extracting. */
 				if (size < 0) {
 					fclose(file);
 					delete[] buf;
-					archive_read_close(a);
-					archive_read_free(a);
 					return EXTRACT_ERROR_ARCHIVE;
 				}
 
-				ssize_t written = fwrite(buf, 1, size, file);
-
 				/* Failed to write, likely out of space. */
-				if (written != size) {
+				if ((!sizeKnown && FreeSpace::Available() < (u64)size) || (ssize_t)fwrite(buf, 1, size, file) != size) {
 					fclose(file);
 					delete[] buf;
-					archive_read_close(a);
-					archive_read_free(a);
 					return EXTRACT_ERROR_WRITEFILE;
 				}
 
-				sizeLeft -= size;
+				FreeSpace::Commit(size, reservation);
 				writeOffset += size;
 			}
 
 			fclose(file);
 			delete[] buf;
 
-			if (QueueSystem::CancelCallback) goto exit; // Cancel Extraction.
+			if (QueueSystem::CancelCallback) break; // Cancel Extraction.
 		}
 	}
 
-	exit:
-		archive_read_close(a);
-		archive_read_free(a);
-		return EXTRACT_ERROR_NONE;
-}
\ No newline at end of file
+	return EXTRACT_ERROR_NONE;
+}
+
+Result extractArchive(const std::string &archivePath, const std::string &wantedFile, const std::string &outputPath) {
+	u64 reservation = 0;
+	if (!FreeSpace::Reserve(extractSize, reservation)) return -1; // Out of space.
+
+	archive *a = archive_read_new();
+	archive_read_support_format_all(a);
+
+	Result ret = EXTRACT_ERROR_OPENFILE;
+	if (archive_read_open_filename(a, archivePath.c_str(), 0x4000) == ARCHIVE_OK) ret = extractEntries(a, wantedFile, outputPath, reservation);
+
+	archive_read_close(a);
+	archive_read_free(a);
+	FreeSpace::Release(reservation);
+	return ret;
+}
+
+/*
+	If the archive can be extracted while it gets downloaded.
+	That's not possible for 7z, which has its directory at the end.
+
+	const std::string &archivePath: Const Reference to the path of the archive.
+*/
+bool isStreamableArchive(const std::string &archivePath) {
+	std::string path = archivePath;
+	std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+
+	for (const char *extension : { ".zip", ".tar", ".tar.gz", ".tgz", ".tar.bz2", ".tar.xz" }) {
+		const size_t length = strlen(extension);
+		if (path.size() >= length && path.compare(path.size() - length, length, extension) == 0) return true;
+	}
+
+	return false;
+}
+
+/* The libarchive read callback. */
+static la_ssize_t readStream(archive *a, void *userdata, const void **buffer) {
+	return ((ArchiveStream *)userdata)->Read(buffer);
+}
+
+/*
+	Extract an archive, while it gets downloaded.
+
+	ArchiveStream &stream: Reference to the stream of the archive.
+	const std::string &wantedFile: Const Reference to the regex of the wanted entries.
+	const std::string &outputPath: Const Reference to the output path.
+*/
+Result extractStream(ArchiveStream &stream, const std::string &wantedFile, const std::string &outputPath) {
+	u64 reservation = 0;
+	extractSize = 0, writeOffset = 0, filesExtracted = 0, extractFilesCount = 0;
+
+	archive *a = archive_read_new();
+	archive_read_support_format_zip_streamable(a);
+	archive_read_support_format_tar(a);
+	archive_read_support_filter_all(a);
+
+	Result ret = EXTRACT_ERROR_OPENFILE;
+	if (archive_read_open(a, &stream, nullptr, readStream, nullptr) == ARCHIVE_OK) ret = extractEntries(a, wantedFile, outputPath, reservation);
+
+	archive_read_close(a);
+	archive_read_free(a);
+	FreeSpace::Release(reservation);
+	return ret;
+}
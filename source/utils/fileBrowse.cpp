@@ -27,7 +27,6 @@
 #include "fileBrowse.hpp"
 #include "files.hpp"
 #include "json.hpp"
-#include "structs.hpp"
 #include <3ds.h>
 #include <cstring>
 #include <functional>
@@ -237,7 +236,8 @@ int fcopy(const char *sourcePath, const char *destinationPath) {
 			return -1;
 		}
 
-		if(getAvailableSpace() < copySize) {
+		u64 reservation = 0;
+		if (!FreeSpace::Reserve(copySize, reservation)) {
 			fclose(sourceFile);
 			return -1;
 		}
@@ -245,6 +245,7 @@ int fcopy(const char *sourcePath, const char *destinationPath) {
 		FILE *destinationFile = fopen(destinationPath, "wb");
 		if (!destinationFile) {
 			fclose(sourceFile);
+			FreeSpace::Release(reservation);
 			return -1;
 		}
 
@@ -256,15 +257,18 @@ int fcopy(const char *sourcePath, const char *destinationPath) {
 			if(written != numr) {
 				fclose(sourceFile);
 				fclose(destinationFile);
+				FreeSpace::Release(reservation);
 
 				return -1;
 			}
 
+			FreeSpace::Commit(written * sizeof(u32), reservation);
 			copyOffset += copyBufSize * sizeof(u32);
 
 			if (copyOffset > copySize) {
 				fclose(sourceFile);
 				fclose(destinationFile);
+				FreeSpace::Release(reservation);
 
 				return 1;
 			}
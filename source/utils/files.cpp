@@ -25,6 +25,7 @@
 */
 
 #include "files.hpp"
+#include <algorithm>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 
@@ -138,4 +139,92 @@ u64 getAvailableSpace() {
 	struct statvfs st;
 	statvfs("sdmc:/", &st);
 	return (u64)st.f_bsize * (u64)st.f_bavail;
+}
+
+#define FREESPACE_SYNC_INTERVAL 10000 // Re-query the filesystem after 10 seconds.
+
+static LightLock spaceLock = 1; // Unlocked.
+static u64 spaceFree = 0, spaceWritten = 0, spaceReserved = 0, lastSync = 0;
+static bool spaceSynced = false;
+
+/* Has to be called with spaceLock held. */
+static void syncLocked() {
+	spaceFree = getAvailableSpace();
+	spaceWritten = 0; // Everything written so far is part of spaceFree now.
+	lastSync = osGetTime();
+	spaceSynced = true;
+}
+
+/* Has to be called with spaceLock held. */
+static u64 availableLocked() {
+	if (!spaceSynced || osGetTime() - lastSync >= FREESPACE_SYNC_INTERVAL) syncLocked();
+
+	const u64 used = spaceWritten + spaceReserved;
+	return spaceFree > used ? spaceFree - used : 0;
+}
+
+/*
+	Query the filesystem for the free space.
+	Call this after operations which aren't tracked, like deletions or title installs.
+*/
+void FreeSpace::Sync() {
+	LightLock_Lock(&spaceLock);
+	syncLocked();
+	LightLock_Unlock(&spaceLock);
+}
+
+/*
+	Return the free space, which isn't reserved or written yet.
+*/
+u64 FreeSpace::Available() {
+	LightLock_Lock(&spaceLock);
+	const u64 available = availableLocked();
+	LightLock_Unlock(&spaceLock);
+	return available;
+}
+
+/*
+	Reserve space for something, which is about to be written.
+
+	u64 size: The size to reserve.
+	u64 &reservation: Reference to the reservation of the caller, which gets increased by size.
+*/
+bool FreeSpace::Reserve(u64 size, u64 &reservation) {
+	LightLock_Lock(&spaceLock);
+	const bool fits = availableLocked() >= size;
+
+	if (fits) {
+		spaceReserved += size;
+		reservation += size;
+	}
+
+	LightLock_Unlock(&spaceLock);
+	return fits;
+}
+
+/*
+	Track written data and take it from the reservation.
+
+	u64 size: The size, which got written.
+	u64 &reservation: Reference to the reservation of the caller.
+*/
+void FreeSpace::Commit(u64 size, u64 &reservation) {
+	LightLock_Lock(&spaceLock);
+	const u64 fromReservation = std::min(size, reservation);
+	reservation -= fromReservation;
+	spaceReserved -= std::min(fromReservation, spaceReserved);
+	spaceWritten += size;
+	LightLock_Unlock(&spaceLock);
+}
+
+/*
+	Give back, what is left of a reservation.
+
+	u64 &reservation: Reference to the reservation of the caller.
+*/
+void FreeSpace::Release(u64 &reservation) {
+	LightLock_Lock(&spaceLock);
+	spaceReserved -= std::min(reservation, spaceReserved);
+	reservation = 0;
+	LightLock_Unlock(&spaceLock);
 }
\ No newline at end of file
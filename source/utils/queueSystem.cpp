@@ -24,14 +24,23 @@
 *         reasonable ways as different from the original version.
 */
 
+#include "common.hpp"
+#include "downloadCache.hpp"
+#include "extract.hpp"
 #include "files.hpp"
 #include "gui.hpp"
 #include "queueSystem.hpp"
 #include "scriptUtils.hpp"
 #include "storeUtils.hpp"
+#include "telemetry.hpp"
+#include <algorithm>
 #include <unistd.h>
 
+#define QUEUE_WIFI_DELAY 2000 // How long to wait for Wi-Fi at first, if all entries need it, in ms...
+#define QUEUE_WIFI_MAX_DELAY 30000 // ...doubled with every check up to this.
+
 std::deque<std::unique_ptr<Queue>> queueEntries;
+LightLock queueLock = 1; // Unlocked. Guards the structure of queueEntries between the queue thread and the UI.
 int QueueSystem::RequestNeeded = -1, QueueSystem::RequestAnswer = -1;
 bool QueueSystem::Wait = false, QueueSystem::Popup = false, QueueSystem::CancelCallback = false;
 std::string QueueSystem::RequestMsg = "", QueueSystem::EndMsg = "";
@@ -39,15 +48,21 @@ int QueueSystem::LastElement = 0;
 
 bool QueueRuns = false;
 static Thread queueThread = nullptr;
+static LightEvent queueWakeup; // Ends the wait for Wi-Fi early.
 
 /*
 	Adds an entry to the queue.
 
 	nlohmann::json obj: The object.
-	C2D_Image icn: The icon.
+	const StoreImage &icn: Const Reference to where the icon is on the SpriteSheets.
+	u64 size: The size the entry needs on the SD card. 0 if unknown.
 */
-void QueueSystem::AddToQueue(nlohmann::json obj, const C2D_Image &icn, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated) {
-	queueEntries.push_back( std::make_unique<Queue>(obj, icn, name, uName, eName, lUpdated) );
+void QueueSystem::AddToQueue(nlohmann::json obj, const StoreImage &icn, const std::string &name, const std::string &uName, const std::string &eName, const std::string &lUpdated, u64 size) {
+	LightLock_Lock(&queueLock);
+	queueEntries.push_back( std::make_unique<Queue>(obj, icn, name, uName, eName, lUpdated, size) );
+	LightLock_Unlock(&queueLock);
+
+	QueueSystem::Wakeup(); // The new entry might not need the network.
 
 	/* If not already running, let it run!! */
 	if (!QueueRuns && !QueueSystem::Wait) {
@@ -62,6 +77,7 @@ void QueueSystem::AddToQueue(nlohmann::json obj, const C2D_Image &icn, const std
 		s32 prio = 0;
 
 		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+		LightEvent_Init(&queueWakeup, RESET_ONESHOT);
 		queueThread = threadCreate((ThreadFunc)QueueSystem::QueueHandle, NULL, 64 * 1024, prio - 1, -2, false);
 		aptSetHomeAllowed(false);
 	}
@@ -72,13 +88,24 @@ void QueueSystem::AddToQueue(nlohmann::json obj, const C2D_Image &icn, const std
 */
 void QueueSystem::ClearQueue() {
 	QueueRuns = false;
-	queueEntries.clear();
+	QueueSystem::Wakeup();
 
 	if (queueThread) {
 		threadJoin(queueThread, U64_MAX);
 		threadFree(queueThread);
 		queueThread = nullptr;
 	}
+
+	LightLock_Lock(&queueLock);
+	queueEntries.clear();
+	LightLock_Unlock(&queueLock);
+}
+
+/*
+	Wake the queue thread, while it waits for Wi-Fi.
+*/
+void QueueSystem::Wakeup() {
+	if (queueThread) LightEvent_Signal(&queueWakeup);
 }
 
 /*
@@ -97,23 +124,177 @@ void QueueSystem::Resume() {
 
 	s32 prio = 0;
 	svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+	LightEvent_Init(&queueWakeup, RESET_ONESHOT);
 	queueThread = threadCreate((ThreadFunc)QueueSystem::QueueHandle, NULL, 64 * 1024, prio - 1, -2, false);
 }
 
+/*
+	Return the optional checksum of a download step.
+
+	const nlohmann::json &step: Const Reference to the step.
+	const std::string &key: Const Reference to the checksum key. (sha256 or crc32)
+*/
+static std::string getChecksum(const nlohmann::json &step, const std::string &key) {
+	if (step.contains(key) && step[key].is_string()) return step[key];
+	return "";
+}
+
+/*
+	Return the optional mirrors of a downloadFile step.
+
+	const nlohmann::json &step: Const Reference to the step.
+*/
+static std::vector<std::string> getMirrors(const nlohmann::json &step) {
+	std::vector<std::string> mirrors;
+
+	if (step.contains("mirrors") && step["mirrors"].is_array()) {
+		for (const auto &mirror : step["mirrors"]) {
+			if (mirror.is_string()) mirrors.push_back(mirror);
+		}
+	}
+
+	return mirrors;
+}
+
+/*
+	If a download step is directly followed by a step of type using the download and deleting it,
+	so the download can be handed to that step on the fly. Not possible for checksums, which need the whole file first,
+	and mirrors, as a retry can't take back, what got handed over already.
+
+	const nlohmann::json &steps: Const Reference to the script.
+	int index: The index of the download step.
+	const std::string &type: Const Reference to the type of the following step. (extractFile or installCia)
+*/
+static bool fuseWithNext(const nlohmann::json &steps, int index, const std::string &type) {
+	if (index + 2 >= (int)steps.size()) return false;
+	if (!checkWifiStatus()) return false; // Cached copies can only be restored as a whole.
+
+	const nlohmann::json &download = steps[index], &next = steps[index + 1], &remove = steps[index + 2];
+	if (getChecksum(download, "sha256") != "" || getChecksum(download, "crc32") != "") return false;
+	if (!getMirrors(download).empty()) return false;
+
+	if (!next.contains("type") || next["type"] != type) return false;
+	if (!next.contains("file") || next["file"] != download["output"]) return false;
+
+	if (type == "extractFile") {
+		if (!isStreamableArchive(download["output"])) return false; // 7z needs to seek.
+		if (!next.contains("input") || !next["input"].is_string()) return false;
+		if (!next.contains("output") || !next["output"].is_string()) return false;
+	}
+
+	if (!remove.contains("type") || remove["type"] != "deleteFile") return false;
+	return remove.contains("file") && remove["file"] == download["output"];
+}
+
+/*
+	Return, if all downloads of a script can be served from the cache, so it can run without Wi-Fi.
+
+	const nlohmann::json &steps: Const Reference to the script.
+*/
+static bool servableOffline(const nlohmann::json &steps) {
+	for (const auto &step : steps) {
+		if (!step.contains("type") || !step["type"].is_string() || !step.contains("file") || !step["file"].is_string()) continue;
+
+		if (step["type"] == "downloadFile") {
+			if (!DownloadCache::Contains(step["file"], getChecksum(step, "sha256"))) return false;
+
+		} else if (step["type"] == "downloadRelease") {
+			if (!step.contains("repo") || !step["repo"].is_string()) continue;
+
+			bool includePrereleases = false;
+			if (step.contains("includePrereleases") && step["includePrereleases"].is_boolean()) includePrereleases = step["includePrereleases"];
+
+			/* Without Wi-Fi, only the release metadata of earlier sessions is used. */
+			std::string assetUrl;
+			if (getReleaseAssetURL(GITHUB_URL "/" + step["repo"].get<std::string>(), step["file"], includePrereleases, assetUrl) != 0) return false;
+			if (!DownloadCache::Contains(assetUrl, getChecksum(step, "sha256"))) return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	Hand a download to the following extractFile or installCia step on the fly, if possible.
+	Returns false, if the steps have to run one after another.
+
+	const std::string &url: Const Reference to the URL of the download.
+	const std::string &output: Const Reference to the output of the download.
+	Queue *entry: The running queue entry.
+	int &i: Reference to the index of the download step. Gets moved to the last fused step.
+	Result &ret: Reference to the result.
+*/
+static bool runFused(const std::string &url, const std::string &output, Queue *entry, int &i, Result &ret) {
+	const nlohmann::json &steps = entry->obj;
+
+	if (fuseWithNext(steps, i, "extractFile")) {
+		const nlohmann::json &extract = steps[i + 1];
+		ret = ScriptUtils::downloadExtractFile(url, output, extract["input"], extract["output"], "", false);
+
+	} else if (fuseWithNext(steps, i, "installCia")) {
+		bool updateSelf = false;
+		if (steps[i + 1].contains("updateSelf") && steps[i + 1]["updateSelf"].is_boolean()) updateSelf = steps[i + 1]["updateSelf"];
+
+		ret = ScriptUtils::downloadInstallFile(url, output, updateSelf, "", false);
+
+	} else return false;
+
+	entry->current += 2;
+	i += 2;
+	return true;
+}
+
 /*
 	The whole handle.
 */
 void QueueSystem::QueueHandle() {
+	u32 wifiDelay = QUEUE_WIFI_DELAY;
+
 	while(QueueRuns) {
 		Result ret = NONE; // No Error as of yet.
 
-		for(int i = QueueSystem::LastElement; ret == NONE && i < queueEntries[0]->total && !QueueSystem::CancelCallback; i++) {
-			queueEntries[0]->current++;
+		/* The entry stays in place, until it is done: the UI only removes the ones behind it. */
+		LightLock_Lock(&queueLock);
+		Queue *entry = queueEntries[0].get();
+		LightLock_Unlock(&queueLock);
+
+		/* Without Wi-Fi, an entry needing the network waits behind the others, instead of failing. */
+		if (QueueSystem::LastElement == 0 && !QueueSystem::CancelCallback && !checkWifiStatus() && !servableOffline(entry->obj)) {
+			entry->status = QueueStatus::Deferred;
+
+			/* Swap with the next waiting entry, instead of rotating, so the positions of the others stay. */
+			LightLock_Lock(&queueLock);
+			size_t next = 1;
+			while (next < queueEntries.size() && queueEntries[next]->status == QueueStatus::Deferred) next++;
+
+			const bool swapped = next < queueEntries.size();
+			if (swapped) queueEntries[0].swap(queueEntries[next]);
+			LightLock_Unlock(&queueLock);
+
+			/* All deferred: there is no notification for Wi-Fi, so check again later, unless a new entry or a cancel comes first. */
+			if (!swapped) {
+				LightEvent_WaitTimeout(&queueWakeup, (s64)wifiDelay * 1000000);
+				wifiDelay = std::min(wifiDelay * 2, (u32)QUEUE_WIFI_MAX_DELAY);
+			}
+
+			continue;
+		}
+
+		wifiDelay = QUEUE_WIFI_DELAY;
+
+		/* A new entry starts, so refresh the free space and reject it up front, if it can't fit. */
+		if (QueueSystem::LastElement == 0) {
+			FreeSpace::Sync();
+			if (entry->size > FreeSpace::Available()) ret = SPACE_ERROR;
+		}
+
+		for(int i = QueueSystem::LastElement; ret == NONE && i < entry->total && !QueueSystem::CancelCallback; i++) {
+			entry->current++;
 
 			std::string type = "";
 
-			if (queueEntries[0]->obj[i].contains("type") && queueEntries[0]->obj[i]["type"].is_string()) {
-				type = queueEntries[0]->obj[i]["type"];
+			if (entry->obj[i].contains("type") && entry->obj[i]["type"].is_string()) {
+				type = entry->obj[i]["type"];
 
 			} else {
 				ret = SYNTAX_ERROR;
@@ -123,10 +304,10 @@ void QueueSystem::QueueHandle() {
 			if (type == "deleteFile") {
 				bool missing = false;
 				std::string file = "";
-				queueEntries[0]->status = QueueStatus::Deleting;
+				entry->status = QueueStatus::Deleting;
 
-				if (queueEntries[0]->obj[i].contains("file") && queueEntries[0]->obj[i]["file"].is_string()) {
-					file = queueEntries[0]->obj[i]["file"];
+				if (entry->obj[i].contains("file") && entry->obj[i]["file"].is_string()) {
+					file = entry->obj[i]["file"];
 				} else missing = true;
 
 				if (!missing) ret = ScriptUtils::removeFile(file, "");
@@ -137,60 +318,88 @@ void QueueSystem::QueueHandle() {
 				bool missing = false;
 				std::string file = "", output = "";
 
-				queueEntries[0]->status = QueueStatus::Downloading;
+				entry->status = QueueStatus::Downloading;
 
-				if (queueEntries[0]->obj[i].contains("file") && queueEntries[0]->obj[i]["file"].is_string()) {
-					file = queueEntries[0]->obj[i]["file"];
+				if (entry->obj[i].contains("file") && entry->obj[i]["file"].is_string()) {
+					file = entry->obj[i]["file"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("output") && queueEntries[0]->obj[i]["output"].is_string()) {
-					output = queueEntries[0]->obj[i]["output"];
+				if (entry->obj[i].contains("output") && entry->obj[i]["output"].is_string()) {
+					output = entry->obj[i]["output"];
 				} else missing = true;
 
-				if (!missing) ret = ScriptUtils::downloadFile(file, output, "", false);
-				else ret = SYNTAX_ERROR;
+				const nlohmann::json &step = entry->obj[i];
+
+				if (missing) ret = SYNTAX_ERROR;
+
+				/* The file only exists to be extracted or installed and deleted, so hand it over right from the network. */
+				else if (!runFused(file, output, entry, i, ret)) {
+					std::vector<FileDownload> files = { { file, output, getChecksum(step, "sha256"), getChecksum(step, "crc32"), getMirrors(step) } };
+
+					/* Directly following downloads don't depend on each other, so fetch them together. */
+					while (i + 1 < entry->total && entry->obj[i + 1].contains("type") && entry->obj[i + 1]["type"] == "downloadFile") {
+						const nlohmann::json &next = entry->obj[i + 1];
+						if (!next.contains("file") || !next["file"].is_string()) break;
+						if (!next.contains("output") || !next["output"].is_string()) break;
+
+						files.push_back({ next["file"], next["output"], getChecksum(next, "sha256"), getChecksum(next, "crc32"), getMirrors(next) });
+						entry->current++;
+						i++;
+					}
+
+					if (files.size() > 1) ret = ScriptUtils::downloadFiles(files, "", false);
+					else ret = ScriptUtils::downloadFile(file, output, "", false, files[0].SHA256, files[0].CRC32, files[0].Mirrors);
+				}
 
 				/* Download from a GitHub Release. */
 			} else if (type == "downloadRelease") {
 				bool missing = false, includePrereleases = false;
 				std::string repo = "", file = "", output = "";
 
-				queueEntries[0]->status = QueueStatus::Downloading;
+				entry->status = QueueStatus::Downloading;
 
-				if (queueEntries[0]->obj[i].contains("repo") && queueEntries[0]->obj[i]["repo"].is_string()) {
-					repo = queueEntries[0]->obj[i]["repo"];
+				if (entry->obj[i].contains("repo") && entry->obj[i]["repo"].is_string()) {
+					repo = entry->obj[i]["repo"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("file") && queueEntries[0]->obj[i]["file"].is_string()) {
-					file = queueEntries[0]->obj[i]["file"];
+				if (entry->obj[i].contains("file") && entry->obj[i]["file"].is_string()) {
+					file = entry->obj[i]["file"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("output") && queueEntries[0]->obj[i]["output"].is_string()) {
-					output = queueEntries[0]->obj[i]["output"];
+				if (entry->obj[i].contains("output") && entry->obj[i]["output"].is_string()) {
+					output = entry->obj[i]["output"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("includePrereleases") && queueEntries[0]->obj[i]["includePrereleases"].is_boolean())
-					includePrereleases = queueEntries[0]->obj[i]["includePrereleases"];
+				if (entry->obj[i].contains("includePrereleases") && entry->obj[i]["includePrereleases"].is_boolean())
+					includePrereleases = entry->obj[i]["includePrereleases"];
 
-				if (!missing) ret = ScriptUtils::downloadRelease(repo, file, output, includePrereleases, "", false);
-				else ret = SYNTAX_ERROR;
+				bool fused = false;
+				if (!missing && (fuseWithNext(entry->obj, i, "extractFile") || fuseWithNext(entry->obj, i, "installCia"))) {
+					std::string assetUrl;
+
+					/* Otherwise the steps run one after another, like without fusing. */
+					if (getReleaseAssetURL(GITHUB_URL "/" + repo, file, includePrereleases, assetUrl) == 0) fused = runFused(assetUrl, output, entry, i, ret);
+				}
+
+				if (missing) ret = SYNTAX_ERROR;
+				else if (!fused) ret = ScriptUtils::downloadRelease(repo, file, output, includePrereleases, "", false, getChecksum(entry->obj[i], "sha256"), getChecksum(entry->obj[i], "crc32"));
 
 				/* Extracting files. */
 			} else if (type == "extractFile") {
 				bool missing = false;
 				std::string file = "", input = "", output = "";
-				queueEntries[0]->status = QueueStatus::Extracting;
+				entry->status = QueueStatus::Extracting;
 
-				if (queueEntries[0]->obj[i].contains("file") && queueEntries[0]->obj[i]["file"].is_string()) {
-					file = queueEntries[0]->obj[i]["file"];
+				if (entry->obj[i].contains("file") && entry->obj[i]["file"].is_string()) {
+					file = entry->obj[i]["file"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("input") && queueEntries[0]->obj[i]["input"].is_string()) {
-					input = queueEntries[0]->obj[i]["input"];
+				if (entry->obj[i].contains("input") && entry->obj[i]["input"].is_string()) {
+					input = entry->obj[i]["input"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("output") && queueEntries[0]->obj[i]["output"].is_string()) {
-					output = queueEntries[0]->obj[i]["output"];
+				if (entry->obj[i].contains("output") && entry->obj[i]["output"].is_string()) {
+					output = entry->obj[i]["output"];
 				} else missing = true;
 
 				if (!missing) ret = ScriptUtils::extractFile(file, input, output, "", false);
@@ -200,14 +409,14 @@ void QueueSystem::QueueHandle() {
 			} else if (type == "installCia") {
 				bool missing = false, updateSelf = false;
 				std::string file = "";
-				queueEntries[0]->status = QueueStatus::Installing;
+				entry->status = QueueStatus::Installing;
 
-				if (queueEntries[0]->obj[i].contains("file") && queueEntries[0]->obj[i]["file"].is_string()) {
-					file = queueEntries[0]->obj[i]["file"];
+				if (entry->obj[i].contains("file") && entry->obj[i]["file"].is_string()) {
+					file = entry->obj[i]["file"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("updateSelf") && queueEntries[0]->obj[i]["updateSelf"].is_boolean()) {
-					updateSelf = queueEntries[0]->obj[i]["updateSelf"];
+				if (entry->obj[i].contains("updateSelf") && entry->obj[i]["updateSelf"].is_boolean()) {
+					updateSelf = entry->obj[i]["updateSelf"];
 				}
 
 				if (!missing) ScriptUtils::installFile(file, updateSelf, "");
@@ -217,8 +426,8 @@ void QueueSystem::QueueHandle() {
 				bool missing = false;
 				std::string directory = "";
 
-				if (queueEntries[0]->obj[i].contains("directory") && queueEntries[0]->obj[i]["directory"].is_string()) {
-					directory = queueEntries[0]->obj[i]["directory"];
+				if (entry->obj[i].contains("directory") && entry->obj[i]["directory"].is_string()) {
+					directory = entry->obj[i]["directory"];
 				} else missing = true;
 
 				if (!missing) makeDirs(directory.c_str());
@@ -228,10 +437,10 @@ void QueueSystem::QueueHandle() {
 			} else if (type == "rmdir") {
 				bool missing = false;
 				std::string directory = "", message = "", promptmsg = "";
-				queueEntries[0]->status = QueueStatus::Request;
+				entry->status = QueueStatus::Request;
 
-				if (queueEntries[0]->obj[i].contains("directory") && queueEntries[0]->obj[i]["directory"].is_string()) {
-					directory = queueEntries[0]->obj[i]["directory"];
+				if (entry->obj[i].contains("directory") && entry->obj[i]["directory"].is_string()) {
+					directory = entry->obj[i]["directory"];
 				} else missing = true;
 
 				promptmsg = Lang::get("DELETE_PROMPT") + "\n" + directory;
@@ -241,7 +450,7 @@ void QueueSystem::QueueHandle() {
 					else {
 						if (QueueSystem::RequestNeeded == RMDIR_REQUEST) {
 							/* There we already did it. :) */
-							queueEntries[0]->status = QueueStatus::Deleting;
+							entry->status = QueueStatus::Deleting;
 							if (QueueSystem::RequestAnswer == 1) removeDirRecursive(directory.c_str());
 							/* Reset. */
 							QueueSystem::RequestNeeded = NO_REQUEST;
@@ -264,20 +473,20 @@ void QueueSystem::QueueHandle() {
 			} else if (type == "promptMessage" || type == "promptMsg") {
 				std::string Message = "";
 				int skipCount = -1;
-				queueEntries[0]->status = QueueStatus::Request;
+				entry->status = QueueStatus::Request;
 
-				if (queueEntries[0]->obj[i].contains("message") && queueEntries[0]->obj[i]["message"].is_string()) {
-					Message = queueEntries[0]->obj[i]["message"];
+				if (entry->obj[i].contains("message") && entry->obj[i]["message"].is_string()) {
+					Message = entry->obj[i]["message"];
 				}
 
-				if (queueEntries[0]->obj[i].contains("count") && queueEntries[0]->obj[i]["count"].is_number()) {
-					skipCount = queueEntries[0]->obj[i]["count"];
+				if (entry->obj[i].contains("count") && entry->obj[i]["count"].is_number()) {
+					skipCount = entry->obj[i]["count"];
 				}
 
 				if (QueueSystem::RequestNeeded == PROMPT_REQUEST) {
 					if ((skipCount > -1) && (QueueSystem::RequestAnswer == SCRIPT_CANCELED)) {
 						i += skipCount; // Skip.
-						queueEntries[0]->current += skipCount;
+						entry->current += skipCount;
 					}
 
 					/* Reset. */
@@ -298,14 +507,14 @@ void QueueSystem::QueueHandle() {
 			} else if (type == "copy") {
 				std::string source = "", destination = "";
 				bool missing = false;
-				queueEntries[0]->status = QueueStatus::Copying;
+				entry->status = QueueStatus::Copying;
 
-				if (queueEntries[0]->obj[i].contains("source") && queueEntries[0]->obj[i]["source"].is_string()) {
-					source = queueEntries[0]->obj[i]["source"];
+				if (entry->obj[i].contains("source") && entry->obj[i]["source"].is_string()) {
+					source = entry->obj[i]["source"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("destination") && queueEntries[0]->obj[i]["destination"].is_string()) {
-					destination = queueEntries[0]->obj[i]["destination"];
+				if (entry->obj[i].contains("destination") && entry->obj[i]["destination"].is_string()) {
+					destination = entry->obj[i]["destination"];
 				} else missing = true;
 
 				if (!missing) ret = ScriptUtils::copyFile(source, destination, "");
@@ -314,14 +523,14 @@ void QueueSystem::QueueHandle() {
 			} else if (type == "move") {
 				std::string oldFile = "", newFile = "";
 				bool missing = false;
-				queueEntries[0]->status = QueueStatus::Moving;
+				entry->status = QueueStatus::Moving;
 
-				if (queueEntries[0]->obj[i].contains("old") && queueEntries[0]->obj[i]["old"].is_string()) {
-					oldFile = queueEntries[0]->obj[i]["old"];
+				if (entry->obj[i].contains("old") && entry->obj[i]["old"].is_string()) {
+					oldFile = entry->obj[i]["old"];
 				} else missing = true;
 
-				if (queueEntries[0]->obj[i].contains("new") && queueEntries[0]->obj[i]["new"].is_string()) {
-					newFile = queueEntries[0]->obj[i]["new"];
+				if (entry->obj[i].contains("new") && entry->obj[i]["new"].is_string()) {
+					newFile = entry->obj[i]["new"];
 				} else missing = true;
 
 				if (!missing) ret = ScriptUtils::renameFile(oldFile, newFile, "");
@@ -330,8 +539,8 @@ void QueueSystem::QueueHandle() {
 			} else if (type == "skip") {
 				int skipCount = -1;
 
-				if (queueEntries[0]->obj[i].contains("count") && queueEntries[0]->obj[i]["count"].is_number()) {
-					skipCount = queueEntries[0]->obj[i]["count"];
+				if (entry->obj[i].contains("count") && entry->obj[i]["count"].is_number()) {
+					skipCount = entry->obj[i]["count"];
 				}
 
 				if (skipCount > 0) i += skipCount; // Skip.
@@ -340,7 +549,7 @@ void QueueSystem::QueueHandle() {
 
 		/* If we expect a prompt, we go to this. */
 		if (ret == PROMPT_RET) {
-			queueEntries[0]->current = QueueSystem::LastElement + 1; // Cause no Zero.
+			entry->current = QueueSystem::LastElement + 1; // Cause no Zero.
 			QueueSystem::Wait = true;
 			QueueRuns = false;
 		}
@@ -348,10 +557,10 @@ void QueueSystem::QueueHandle() {
 		if (!QueueSystem::Wait) {
 			/* Canceled or None is for me -> Done. */
 			if (ret == NONE || ret == SCRIPT_CANCELED) {
-				queueEntries[0]->status = QueueStatus::Done;
+				entry->status = QueueStatus::Done;
 
 			} else { // Else it failed..
-				queueEntries[0]->status = QueueStatus::Failed;
+				entry->status = QueueStatus::Failed;
 			}
 
 			/* Display if failed or succeeded. */
@@ -359,14 +568,14 @@ void QueueSystem::QueueHandle() {
 				char msg[256];
 
 				if (QueueSystem::CancelCallback) {
-					snprintf(msg, sizeof(msg), Lang::get("ACTION_CANCELED").c_str(), queueEntries[0]->name.c_str());
+					snprintf(msg, sizeof(msg), Lang::get("ACTION_CANCELED").c_str(), entry->name.c_str());
 
 				} else {
-					if (queueEntries[0]->status == QueueStatus::Failed) {
-						snprintf(msg, sizeof(msg), Lang::get("ACTION_FAILED").c_str(), queueEntries[0]->name.c_str());
+					if (entry->status == QueueStatus::Failed) {
+						snprintf(msg, sizeof(msg), Lang::get("ACTION_FAILED").c_str(), entry->name.c_str());
 
 					} else {
-						snprintf(msg, sizeof(msg), Lang::get("ACTION_SUCCEEDED").c_str(), queueEntries[0]->name.c_str());
+						snprintf(msg, sizeof(msg), Lang::get("ACTION_SUCCEEDED").c_str(), entry->name.c_str());
 					}
 				}
 
@@ -374,19 +583,23 @@ void QueueSystem::QueueHandle() {
 				QueueSystem::Popup = true;
 			}
 
-			if (queueEntries[0]->status == QueueStatus::Done) { // ONLY update, if successful.
+			if (entry->status == QueueStatus::Done) { // ONLY update, if successful.
 				if (StoreUtils::meta) {
-					StoreUtils::meta->SetUpdated(queueEntries[0]->unistoreName, queueEntries[0]->entryName, queueEntries[0]->lastUpdated);
-					StoreUtils::meta->SetInstalled(queueEntries[0]->unistoreName, queueEntries[0]->entryName, queueEntries[0]->name);
+					StoreUtils::meta->SetUpdated(entry->unistoreName, entry->entryName, entry->lastUpdated);
+					StoreUtils::meta->SetInstalled(entry->unistoreName, entry->entryName, entry->name);
 					StoreUtils::RefreshUpdateAVL();
 				}
 			}
 
 			if (QueueSystem::CancelCallback) QueueSystem::CancelCallback = false; // Reset.
+			Telemetry::Flush(); // The transfers of the entry are done, so log them now.
+			DownloadCache::Settle();
 
+			LightLock_Lock(&queueLock);
 			queueEntries.pop_front();
 			if (QueueSystem::LastElement != 0) QueueSystem::LastElement = 0;
 			if (queueEntries.empty()) QueueRuns = false; // The queue ended.
+			LightLock_Unlock(&queueLock);
 			ret = NONE; // Reset.
 		}
 	}
@@ -60,10 +60,11 @@ C2D_Image Screenshot::Convert(const std::string &filename) {
 }
 
 C2D_Image Screenshot::ConvertFromBuffer(const std::vector<u8> &buffer) {
-	std::vector<u8> ImageBuffer;
-	unsigned width, height;
+	/* The C API hands out the buffer lodepng decodes into, instead of copying it into a vector. */
+	u8 *ImageBuffer = nullptr;
+	unsigned width = 0, height = 0;
 	C2D_Image img;
-	lodepng::decode(ImageBuffer, width, height, buffer);
+	lodepng_decode32(&ImageBuffer, &width, &height, buffer.data(), buffer.size());
 
 	img.tex = new C3D_Tex;
 	img.subtex = new Tex3DS_SubTexture({(u16)width, (u16)height, 0.0f, 1.0f, width / 512.0f, 1.0f - (height / 512.0f)});
@@ -80,12 +81,13 @@ C2D_Image Screenshot::ConvertFromBuffer(const std::vector<u8> &buffer) {
 								((x & 4) << 2) | ((y & 4) << 3))) * 4;
 
 			const u32 srcPos = (y * width + x) * 4;
-			((uint8_t *)img.tex->data)[dstPos + 0] = ImageBuffer.data()[srcPos + 3];
-			((uint8_t *)img.tex->data)[dstPos + 1] = ImageBuffer.data()[srcPos + 2];
-			((uint8_t *)img.tex->data)[dstPos + 2] = ImageBuffer.data()[srcPos + 1];
-			((uint8_t *)img.tex->data)[dstPos + 3] = ImageBuffer.data()[srcPos + 0];
+			((uint8_t *)img.tex->data)[dstPos + 0] = ImageBuffer[srcPos + 3];
+			((uint8_t *)img.tex->data)[dstPos + 1] = ImageBuffer[srcPos + 2];
+			((uint8_t *)img.tex->data)[dstPos + 2] = ImageBuffer[srcPos + 1];
+			((uint8_t *)img.tex->data)[dstPos + 3] = ImageBuffer[srcPos + 0];
 		}
 	}
 
+	free(ImageBuffer);
 	return img;
 }
\ No newline at end of file
@@ -24,24 +24,23 @@
 *         reasonable ways as different from the original version.
 */
 
-#include "animation.hpp"
 #include "cia.hpp"
+#include "config.hpp"
 #include "download.hpp"
+#include "downloadCache.hpp"
+#include "downloadEngine.hpp"
 #include "extract.hpp"
 #include "fileBrowse.hpp"
 #include "files.hpp"
+#include "lang.hpp"
+#include "platform.hpp"
+#include "queueSystem.hpp"
 #include "scriptUtils.hpp"
 #include <regex>
 #include <unistd.h>
 
-extern bool showProgressBar;
-extern ProgressBar progressbarType;
-extern char progressBarMsg[128];
 extern int filesExtracted, extractFilesCount;
 
-extern void downloadFailed();
-static Thread thread;
-
 bool ScriptUtils::matchPattern(const std::string &pattern, const std::string &tested) {
 	std::regex patternRegex(pattern);
 	return regex_match(tested, patternRegex);
@@ -59,8 +58,8 @@ Result ScriptUtils::removeFile(const std::string &file, const std::string &messa
 	Result ret = NONE;
 	if (access(out.c_str(), F_OK) != 0) return DELETE_ERROR;
 
-	if (isARG) Msg::DisplayMsg(message);
-	deleteFile(out.c_str());
+	if (isARG) Platform::DisplayMsg(message);
+	if (!DownloadCache::Adopt(out)) deleteFile(out.c_str()); // A downloaded file moves into the cache instead.
 	return ret;
 }
 
@@ -72,8 +71,8 @@ void ScriptUtils::bootTitle(const std::string &TitleID, bool isNAND, const std::
 
 	const u64 ID = std::stoull(TitleID, 0, 16);
 	if (isARG) {
-		if (Msg::promptMsg(MSG)) {
-			Msg::DisplayMsg(message);
+		if (Platform::PromptMsg(MSG)) {
+			Platform::DisplayMsg(message);
 			Title::Launch(ID, isNAND ? MEDIATYPE_NAND : MEDIATYPE_SD);
 		}
 
@@ -85,7 +84,7 @@ void ScriptUtils::bootTitle(const std::string &TitleID, bool isNAND, const std::
 /* Prompt message. */
 Result ScriptUtils::prompt(const std::string &message) {
 	Result ret = NONE;
-	if (!Msg::promptMsg(message)) ret = SCRIPT_CANCELED;
+	if (!Platform::PromptMsg(message)) ret = SCRIPT_CANCELED;
 
 	return ret;
 }
@@ -108,15 +107,7 @@ Result ScriptUtils::copyFile(const std::string &source, const std::string &desti
 	_dest = std::regex_replace(_dest, std::regex("%NDS%"), config->ndsPath());
 	_dest = std::regex_replace(_dest, std::regex("%FIRM%"), config->firmPath());
 
-	if (isARG) {
-		snprintf(progressBarMsg, sizeof(progressBarMsg), message.c_str());
-		showProgressBar = true;
-		progressbarType = ProgressBar::Copying;
-
-		s32 prio = 0;
-		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-		thread = threadCreate((ThreadFunc)Animation::displayProgressBar, NULL, 64 * 1024, prio - 1, -2, false);
-	}
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Copying);
 
 	/* If destination does not exist, create dirs. */
 	if (access(_dest.c_str(), F_OK) != 0) makeDirs(_dest.c_str());
@@ -125,11 +116,7 @@ Result ScriptUtils::copyFile(const std::string &source, const std::string &desti
 	if (ret == -1) ret = COPY_ERROR;
 	else if (ret == 1) ret = NONE;
 
-	if (isARG) {
-		showProgressBar = false;
-		threadJoin(thread, U64_MAX);
-		threadFree(thread);
-	}
+	if (isARG) Platform::HideProgress();
 
 	return ret;
 }
@@ -152,7 +139,7 @@ Result ScriptUtils::renameFile(const std::string &oldName, const std::string &ne
 	_new = std::regex_replace(_new, std::regex("%NDS%"), config->ndsPath());
 	_new = std::regex_replace(_new, std::regex("%FIRM%"), config->firmPath());
 
-	if (isARG) Msg::DisplayMsg(message);
+	if (isARG) Platform::DisplayMsg(message);
 
 	/* TODO: Kinda avoid that? */
 	makeDirs(_new.c_str());
@@ -161,7 +148,7 @@ Result ScriptUtils::renameFile(const std::string &oldName, const std::string &ne
 }
 
 /* Download from GitHub Release. */
-Result ScriptUtils::downloadRelease(const std::string &repo, const std::string &file, const std::string &output, bool includePrereleases, const std::string &message, bool isARG) {
+Result ScriptUtils::downloadRelease(const std::string &repo, const std::string &file, const std::string &output, bool includePrereleases, const std::string &message, bool isARG, const std::string &sha256, const std::string &crc32) {
 	std::string out;
 	out = std::regex_replace(output, std::regex("%3DSX%/(.*)\\.(.*)"), config->_3dsxPath() + (config->_3dsxInFolder() ? "/$1/$1.$2" : "/$1.$2"));
 	out = std::regex_replace(out, std::regex("%3DSX%"), config->_3dsxPath());
@@ -171,41 +158,25 @@ Result ScriptUtils::downloadRelease(const std::string &repo, const std::string &
 
 	Result ret = NONE;
 
-	if (isARG) {
-		snprintf(progressBarMsg, sizeof(progressBarMsg), message.c_str());
-		showProgressBar = true;
-		progressbarType = ProgressBar::Downloading;
-
-		s32 prio = 0;
-		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-		thread = threadCreate((ThreadFunc)Animation::displayProgressBar, NULL, 64 * 1024, prio - 1, -2, false);
-	}
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Downloading);
 
-	if (downloadFromRelease("https://github.com/" + repo, file, out, includePrereleases) != 0) {
+	if (downloadFromRelease(GITHUB_URL "/" + repo, file, out, includePrereleases, sha256, crc32) != 0) {
 		ret = FAILED_DOWNLOAD;
 
 		if (isARG) {
-			showProgressBar = false;
-
-			downloadFailed();
-
-			threadJoin(thread, U64_MAX);
-			threadFree(thread);
+			Platform::HideProgress();
+			Platform::WaitMsg(Lang::get("DOWNLOAD_FAILED"));
 		}
 		return ret;
 	}
 
-	if (isARG) {
-		showProgressBar = false;
-		threadJoin(thread, U64_MAX);
-		threadFree(thread);
-	}
+	if (isARG) Platform::HideProgress();
 
 	return ret;
 }
 
 /* Download a file. */
-Result ScriptUtils::downloadFile(const std::string &file, const std::string &output, const std::string &message, bool isARG) {
+Result ScriptUtils::downloadFile(const std::string &file, const std::string &output, const std::string &message, bool isARG, const std::string &sha256, const std::string &crc32, const std::vector<std::string> &mirrors) {
 	std::string out;
 	out = std::regex_replace(output, std::regex("%3DSX%/(.*)\\.(.*)"), config->_3dsxPath() + (config->_3dsxInFolder() ? "/$1/$1.$2" : "/$1.$2"));
 	out = std::regex_replace(out, std::regex("%3DSX%"), config->_3dsxPath());
@@ -215,36 +186,56 @@ Result ScriptUtils::downloadFile(const std::string &file, const std::string &out
 
 	Result ret = NONE;
 
-	if (isARG) {
-		snprintf(progressBarMsg, sizeof(progressBarMsg), message.c_str());
-		showProgressBar = true;
-		progressbarType = ProgressBar::Downloading;
-
-		s32 prio = 0;
-		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-		thread = threadCreate((ThreadFunc)Animation::displayProgressBar, NULL, 64 * 1024, prio - 1, -2, false);
-	}
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Downloading);
 
-	if (downloadToFile(file, out) != 0) {
+	if (downloadToFile(file, out, sha256, crc32, mirrors) != 0) {
 		ret = FAILED_DOWNLOAD;
 
 		if (isARG) {
-			showProgressBar = false;
+			Platform::HideProgress();
+			Platform::WaitMsg(Lang::get("DOWNLOAD_FAILED"));
+		}
 
-			downloadFailed();
+		return ret;
+	}
+
+	if (isARG) Platform::HideProgress();
 
-			threadJoin(thread, U64_MAX);
-			threadFree(thread);
+	return ret;
+}
+
+/* Download multiple files at once. */
+Result ScriptUtils::downloadFiles(const std::vector<FileDownload> &files, const std::string &message, bool isARG) {
+	std::vector<FileDownload> downloads;
+
+	for (FileDownload file : files) {
+		std::string out;
+		out = std::regex_replace(file.Output, std::regex("%3DSX%/(.*)\\.(.*)"), config->_3dsxPath() + (config->_3dsxInFolder() ? "/$1/$1.$2" : "/$1.$2"));
+		out = std::regex_replace(out, std::regex("%3DSX%"), config->_3dsxPath());
+		out = std::regex_replace(out, std::regex("%NDS%"), config->ndsPath());
+		out = std::regex_replace(out, std::regex("%ARCHIVE_DEFAULT%"), config->archPath());
+		out = std::regex_replace(out, std::regex("%FIRM%"), config->firmPath());
+
+		file.Output = out;
+		downloads.push_back(file);
+	}
+
+	Result ret = NONE;
+
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Downloading);
+
+	if (downloadToFiles(downloads) != 0) {
+		ret = FAILED_DOWNLOAD;
+
+		if (isARG) {
+			Platform::HideProgress();
+			Platform::WaitMsg(Lang::get("DOWNLOAD_FAILED"));
 		}
 
 		return ret;
 	}
 
-	if (isARG) {
-		showProgressBar = false;
-		threadJoin(thread, U64_MAX);
-		threadFree(thread);
-	}
+	if (isARG) Platform::HideProgress();
 
 	return ret;
 }
@@ -258,23 +249,110 @@ void ScriptUtils::installFile(const std::string &file, bool updatingSelf, const
 	in = std::regex_replace(in, std::regex("%NDS%"), config->ndsPath());
 	in = std::regex_replace(in, std::regex("%FIRM%"), config->firmPath());
 
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Installing);
+
+	Title::Install(in.c_str(), updatingSelf);
+
+	if (isARG) Platform::HideProgress();
+}
+
+/*
+	Download a file and hand it to the consumer, while it gets downloaded.
+
+	const std::string &file: Const Reference to the URL.
+	const std::function<bool(ArchiveStream &)> &consume: Const Reference to the consumer. Returns false on failure.
+	Result consumeError: What to return, if the consumer failed.
+*/
+static Result streamDownload(const std::string &file, const std::function<bool(ArchiveStream &)> &consume, Result consumeError) {
+	ArchiveStream stream;
+	std::shared_ptr<DownloadContext> ctx = std::make_shared<DownloadContext>(file);
+	ctx->reportProgress = true;
+	ctx->priority = TransferPriority::Bulk;
+	ctx->sink = [&stream, raw = ctx.get()](const char *data, size_t size) {
+		if (stream.length < 0) stream.length = raw->length; // The Content-Length, for the consumer to plan with.
+		return stream.Push(data, size);
+	};
+
+	stream.drained = [raw = ctx.get()]() { raw->SinkDrained(); }; // The stream lives longer than the download.
+	ctx->callback = [&stream](DownloadContext &done) { stream.Close(done.state != TransferState::Done); };
+	DownloadEngine::Add(ctx);
+
+	const bool consumed = consume(stream);
+
+	/* Don't let the download wait for a reader, which is gone. */
+	if (consumed && !QueueSystem::CancelCallback) {
+		const void *rest;
+		while (stream.Read(&rest) > 0); // Skip what the consumer didn't need.
+
+	} else {
+		stream.Abort();
+		DownloadEngine::Cancel(ctx);
+	}
+
+	DownloadEngine::Wait(ctx);
+
+	if (QueueSystem::CancelCallback) return NONE;
+	if (ctx->state == TransferState::Failed) return FAILED_DOWNLOAD;
+	return consumed ? NONE : consumeError;
+}
+
+/*
+	Download an archive and extract it on the fly, without storing the archive itself.
+	Replaces downloadFile -> extractFile -> deleteFile of the same archive.
+*/
+Result ScriptUtils::downloadExtractFile(const std::string &file, const std::string &archive, const std::string &input, const std::string &output, const std::string &message, bool isARG) {
+	std::string out;
+	out = std::regex_replace(output, std::regex("%ARCHIVE_DEFAULT%"), config->archPath());
+	out = std::regex_replace(out, std::regex("%3DSX%/(.*)\\.(.*)"), config->_3dsxPath() + (config->_3dsxInFolder() ? "/$1/$1.$2" : "/$1.$2"));
+	out = std::regex_replace(out, std::regex("%3DSX%"), config->_3dsxPath());
+	out = std::regex_replace(out, std::regex("%NDS%"), config->ndsPath());
+	out = std::regex_replace(out, std::regex("%FIRM%"), config->firmPath());
+
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Downloading);
+
+	const Result ret = streamDownload(file, [&input, &out](ArchiveStream &stream) { return extractStream(stream, input, out) == EXTRACT_ERROR_NONE; }, EXTRACT_ERROR);
+
+	/* The script would delete an older copy of the archive as well. */
+	if (ret == NONE) ScriptUtils::removeFile(archive, "");
+
 	if (isARG) {
-		snprintf(progressBarMsg, sizeof(progressBarMsg), message.c_str());
-		showProgressBar = true;
-		progressbarType = ProgressBar::Installing;
+		Platform::HideProgress();
+		if (ret == FAILED_DOWNLOAD) Platform::WaitMsg(Lang::get("DOWNLOAD_FAILED"));
+	}
 
-		s32 prio = 0;
-		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-		thread = threadCreate((ThreadFunc)Animation::displayProgressBar, NULL, 64 * 1024, prio - 1, -2, false);
+	return ret;
+}
+
+/*
+	Download a CIA and install it on the fly, without storing the CIA itself.
+	Replaces downloadFile -> installCia -> deleteFile of the same CIA.
+*/
+Result ScriptUtils::downloadInstallFile(const std::string &file, const std::string &cia, bool updatingSelf, const std::string &message, bool isARG) {
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Downloading);
+
+	/* Like installFile, a failed install doesn't fail the script. */
+	bool staged = false;
+	Result ret = streamDownload(file, [updatingSelf, &staged](ArchiveStream &stream) { return R_SUCCEEDED(Title::InstallStream(stream, updatingSelf, staged)); }, NONE);
+
+	/* The stream couldn't do it, so store the CIA first. That download can continue after a failure. */
+	if (staged && !QueueSystem::CancelCallback) {
+		ret = ScriptUtils::downloadFile(file, cia, "", false);
+
+		if (ret == NONE) {
+			if (isARG) Platform::ShowProgress(message, ProgressBar::Installing); // Only switches the type of the shown bar.
+			ScriptUtils::installFile(cia, updatingSelf, "", false);
+		}
 	}
 
-	Title::Install(in.c_str(), updatingSelf);
+	/* The script would delete an older copy of the CIA as well. */
+	if (ret == NONE) ScriptUtils::removeFile(cia, "");
 
 	if (isARG) {
-		showProgressBar = false;
-		threadJoin(thread, U64_MAX);
-		threadFree(thread);
+		Platform::HideProgress();
+		if (ret == FAILED_DOWNLOAD) Platform::WaitMsg(Lang::get("DOWNLOAD_FAILED"));
 	}
+
+	return ret;
 }
 
 /* Extract files. */
@@ -295,15 +373,7 @@ Result ScriptUtils::extractFile(const std::string &file, const std::string &inpu
 	out = std::regex_replace(out, std::regex("%NDS%"), config->ndsPath());
 	out = std::regex_replace(out, std::regex("%FIRM%"), config->firmPath());
 
-	if (isARG) {
-		snprintf(progressBarMsg, sizeof(progressBarMsg), message.c_str());
-		showProgressBar = true;
-		progressbarType = ProgressBar::Extracting;
-
-		s32 prio = 0;
-		svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
-		thread = threadCreate((ThreadFunc)Animation::displayProgressBar, NULL, 64 * 1024, prio - 1, -2, false);
-	}
+	if (isARG) Platform::ShowProgress(message, ProgressBar::Extracting);
 
 	filesExtracted = 0;
 
@@ -312,11 +382,7 @@ Result ScriptUtils::extractFile(const std::string &file, const std::string &inpu
 		ret = EXTRACT_ERROR;
 	}
 
-	if (isARG) {
-		showProgressBar = false;
-		threadJoin(thread, U64_MAX);
-		threadFree(thread);
-	}
+	if (isARG) Platform::HideProgress();
 
 	return ret;
 }
@@ -327,9 +393,9 @@ Result ScriptUtils::extractFile(const std::string &file, const std::string &inpu
 Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const std::string &entry) {
 	Result ret = NONE; // No Error as of yet.
 
-	if (!storeJson.contains("storeContent")) { Msg::waitMsg(Lang::get("SYNTAX_ERROR")); return SYNTAX_ERROR; };
-	if ((int)storeJson["storeContent"].size() < selection) { Msg::waitMsg(Lang::get("SYNTAX_ERROR")); return SYNTAX_ERROR; };
-	if (!storeJson["storeContent"][selection].contains(entry)) { Msg::waitMsg(Lang::get("SYNTAX_ERROR")); return SYNTAX_ERROR; };
+	if (!storeJson.contains("storeContent")) { Platform::WaitMsg(Lang::get("SYNTAX_ERROR")); return SYNTAX_ERROR; };
+	if ((int)storeJson["storeContent"].size() < selection) { Platform::WaitMsg(Lang::get("SYNTAX_ERROR")); return SYNTAX_ERROR; };
+	if (!storeJson["storeContent"][selection].contains(entry)) { Platform::WaitMsg(Lang::get("SYNTAX_ERROR")); return SYNTAX_ERROR; };
 
 	nlohmann::json Script = nullptr;
 
@@ -342,7 +408,7 @@ Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const
 			Script = storeJson["storeContent"][selection][entry]["script"];
 
 		} else {
-			Msg::waitMsg(Lang::get("SYNTAX_ERROR"));
+			Platform::WaitMsg(Lang::get("SYNTAX_ERROR"));
 			return SYNTAX_ERROR;
 		}
 	}
@@ -378,7 +444,7 @@ Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const
 
 			} else if (type == "downloadFile") {
 				bool missing = false;
-				std::string file = "", output = "", message = "";
+				std::string file = "", output = "", message = "", sha256 = "", crc32 = "";
 
 				if (Script[i].contains("file") && Script[i]["file"].is_string()) {
 					file = Script[i]["file"];
@@ -394,12 +460,22 @@ Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const
 					message = Script[i]["message"];
 				}
 
-				if (!missing) ret = ScriptUtils::downloadFile(file, output, message, true);
+				if (Script[i].contains("sha256") && Script[i]["sha256"].is_string()) sha256 = Script[i]["sha256"];
+				if (Script[i].contains("crc32") && Script[i]["crc32"].is_string()) crc32 = Script[i]["crc32"];
+
+				std::vector<std::string> mirrors;
+				if (Script[i].contains("mirrors") && Script[i]["mirrors"].is_array()) {
+					for (const auto &mirror : Script[i]["mirrors"]) {
+						if (mirror.is_string()) mirrors.push_back(mirror);
+					}
+				}
+
+				if (!missing) ret = ScriptUtils::downloadFile(file, output, message, true, sha256, crc32, mirrors);
 				else ret = SYNTAX_ERROR;
 
 			} else if (type == "downloadRelease") {
 				bool missing = false, includePrereleases = false;
-				std::string repo = "", file = "", output = "", message = "";
+				std::string repo = "", file = "", output = "", message = "", sha256 = "", crc32 = "";
 
 				if (Script[i].contains("repo") && Script[i]["repo"].is_string()) {
 					repo = Script[i]["repo"];
@@ -423,7 +499,10 @@ Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const
 					message = Script[i]["message"];
 				}
 
-				if (!missing) ret = ScriptUtils::downloadRelease(repo, file, output, includePrereleases, message, true);
+				if (Script[i].contains("sha256") && Script[i]["sha256"].is_string()) sha256 = Script[i]["sha256"];
+				if (Script[i].contains("crc32") && Script[i]["crc32"].is_string()) crc32 = Script[i]["crc32"];
+
+				if (!missing) ret = ScriptUtils::downloadRelease(repo, file, output, includePrereleases, message, true, sha256, crc32);
 				else ret = SYNTAX_ERROR;
 
 			} else if (type == "extractFile") {
@@ -497,7 +576,7 @@ Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const
 				if (!missing && directory != "") {
 					if (access(directory.c_str(), F_OK) != 0) ret = DELETE_ERROR;
 					else {
-						if (Msg::promptMsg(promptmsg)) removeDirRecursive(directory.c_str());
+						if (Platform::PromptMsg(promptmsg)) removeDirRecursive(directory.c_str());
 					}
 				}
 
@@ -581,12 +660,12 @@ Result ScriptUtils::runFunctions(nlohmann::json storeJson, int selection, const
 		}
 	}
 
-	if (ret == NONE || ret == SCRIPT_CANCELED) doneMsg();
-	else if (ret == FAILED_DOWNLOAD) Msg::waitMsg(Lang::get("DOWNLOAD_ERROR"));
-	else if (ret == SYNTAX_ERROR) Msg::waitMsg(Lang::get("SYNTAX_ERROR"));
-	else if (ret == COPY_ERROR) Msg::waitMsg(Lang::get("COPY_ERROR"));
-	else if (ret == MOVE_ERROR) Msg::waitMsg(Lang::get("MOVE_ERROR"));
-	else if (ret == DELETE_ERROR) Msg::waitMsg(Lang::get("DELETE_ERROR"));
-	else if (ret == EXTRACT_ERROR) Msg::waitMsg(Lang::get("EXTRACT_ERROR"));
+	if (ret == NONE || ret == SCRIPT_CANCELED) Platform::WaitMsg(Lang::get("DONE"));
+	else if (ret == FAILED_DOWNLOAD) Platform::WaitMsg(Lang::get("DOWNLOAD_ERROR"));
+	else if (ret == SYNTAX_ERROR) Platform::WaitMsg(Lang::get("SYNTAX_ERROR"));
+	else if (ret == COPY_ERROR) Platform::WaitMsg(Lang::get("COPY_ERROR"));
+	else if (ret == MOVE_ERROR) Platform::WaitMsg(Lang::get("MOVE_ERROR"));
+	else if (ret == DELETE_ERROR) Platform::WaitMsg(Lang::get("DELETE_ERROR"));
+	else if (ret == EXTRACT_ERROR) Platform::WaitMsg(Lang::get("EXTRACT_ERROR"));
 	return ret;
 }
\ No newline at end of file
@@ -24,7 +24,6 @@
 *         reasonable ways as different from the original version.
 */
 
-#include "common.hpp"
 #include "stringutils.hpp"
 #include <stdarg.h>
 
@@ -68,8 +67,8 @@ std::string StringUtils::FetchStringsFromVector(const std::vector<std::string> &
 std::string StringUtils::formatBytes(u64 bytes) {
 	char out[32];
 
-	if (bytes == 1)					snprintf(out, sizeof(out), "%lld Byte", bytes);
-	else if (bytes < 1ull << 10)	snprintf(out, sizeof(out), "%lld Bytes", bytes);
+	if (bytes == 1)					snprintf(out, sizeof(out), "%llu Byte", (unsigned long long)bytes);
+	else if (bytes < 1ull << 10)	snprintf(out, sizeof(out), "%llu Bytes", (unsigned long long)bytes);
 	else if (bytes < 1ull << 20)	snprintf(out, sizeof(out), "%.1f KiB", (float)bytes / 1024);
 	else if (bytes < 1ull << 30)	snprintf(out, sizeof(out), "%.1f MiB", (float)bytes / 1024 / 1024);
 	else if (bytes < 1ull << 40)	snprintf(out, sizeof(out), "%.1f GiB", (float)bytes / 1024 / 1024 / 1024);